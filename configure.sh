@@ -9,6 +9,9 @@ brew install flac freetype libogg libvorbis
 # GUI Platform backend dependency.
 brew install sdl2
 
+# Faster (reduced scale) JPEG decoding. Optional, the build falls back to stb_image without it.
+brew install jpeg-turbo
+
 # Create the .mlbc directory in the user's home directory if it doesn't exist.
 mkdir -p "$HOME/.mlbc"
 
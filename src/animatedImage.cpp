@@ -0,0 +1,151 @@
+#include <algorithm>
+#include <iostream>
+#include <glad/glad.h>
+#include "animatedImage.h"
+#include "constants.h"
+#include "texturePool.h"
+
+AnimatedImage::AnimatedImage(const std::string& filepath, size_t decoded_frame_count, size_t texture_count)
+    : m_decoder(filepath), m_decoded_frame_count(std::max<size_t>(decoded_frame_count, 1)) {
+    m_textures.resize(std::max<size_t>(texture_count, 2));
+    for (uint32_t& texture : m_textures) {
+        texture = TexturePool::instance().acquire(m_decoder.getWidth(), m_decoder.getHeight(), 4);
+    }
+    m_worker = std::thread(&AnimatedImage::decode, this);
+}
+
+AnimatedImage::~AnimatedImage() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_frame_taken.notify_all();
+    m_worker.join();
+
+    for (uint32_t texture : m_textures) {
+        TexturePool::instance().release(texture, m_decoder.getWidth(), m_decoder.getHeight(), 4);
+    }
+}
+
+void AnimatedImage::update() {
+
+    // Keep the textures after the one shown filled with the upcoming frames.
+    while (m_uploaded_frames.size() + 1 < m_textures.size()) {
+        Frame frame;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (m_decoded_frames.empty()) {
+                break;
+            }
+            frame = std::move(m_decoded_frames.front());
+            m_decoded_frames.pop_front();
+        }
+
+        glBindTexture(GL_TEXTURE_2D, m_textures[m_next_texture]);
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, m_decoder.getWidth(), m_decoder.getHeight(), GL_RGBA, GL_UNSIGNED_BYTE, frame.pixels.data());
+        glBindTexture(GL_TEXTURE_2D, 0);
+        m_uploaded_frames.push_back(UploadedFrame{m_next_texture, frame.delay_milliseconds});
+        m_next_texture = (m_next_texture + 1) % m_textures.size();
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_free_buffers.push_back(std::move(frame.pixels));
+        }
+        m_frame_taken.notify_one();
+    }
+
+    auto now = std::chrono::steady_clock::now();
+    if (! m_shown_frame) {
+        if (! m_uploaded_frames.empty()) {
+            m_shown_frame = m_uploaded_frames.front();
+            m_uploaded_frames.pop_front();
+            m_shown_since = now;
+        }
+        return;
+    }
+
+    auto delay = std::chrono::milliseconds(m_shown_frame->delay_milliseconds);
+    if (now - m_shown_since >= delay && ! m_uploaded_frames.empty()) {
+        m_shown_frame = m_uploaded_frames.front();
+        m_uploaded_frames.pop_front();
+
+        // Stay on the file's timeline, unless the frame was shown late by more than its delay (e.g. the
+        // window was hidden), in which case the timeline restarts from now rather than fast-forwarding.
+        m_shown_since += delay;
+        if (now - m_shown_since >= delay) {
+            m_shown_since = now;
+        }
+    }
+}
+
+bool AnimatedImage::isAnimated() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_animated;
+}
+
+bool AnimatedImage::hasFrame() const {
+    return m_shown_frame.has_value();
+}
+
+ImTextureID AnimatedImage::getTexture() const {
+    return m_shown_frame ? reinterpret_cast<ImTextureID>(static_cast<uintptr_t>(m_textures[m_shown_frame->texture])) : 0;
+}
+
+int32_t AnimatedImage::getWidth() const {
+    return m_decoder.getWidth();
+}
+
+int32_t AnimatedImage::getHeight() const {
+    return m_decoder.getHeight();
+}
+
+size_t AnimatedImage::getSizeInBytes() const {
+    return m_textures.size() * TexturePool::estimateSizeInBytes(m_decoder.getWidth(), m_decoder.getHeight(), 4);
+}
+
+void AnimatedImage::decode() {
+    const size_t frame_size = static_cast<size_t>(m_decoder.getWidth()) * m_decoder.getHeight() * 4;
+    size_t frame_count = 0;
+
+    while (true) {
+        const uint8_t* pixels;
+        int32_t delay_milliseconds;
+        try {
+            if (! m_decoder.next(pixels, delay_milliseconds)) {
+
+                // A single frame GIF is just an image, which is displayed as such.
+                if (frame_count <= 1) {
+                    return;
+                }
+                m_decoder.rewind();
+                continue;
+            }
+        } catch (const std::runtime_error& re) {
+            std::cerr << re.what() << std::endl;
+            return;
+        }
+        frame_count++;
+
+        // Like browsers, very short delays (usually meaning "unspecified") are played at a default rate.
+        if (delay_milliseconds < ANIMATED_IMAGE_MIN_FRAME_DELAY_MS) {
+            delay_milliseconds = ANIMATED_IMAGE_DEFAULT_FRAME_DELAY_MS;
+        }
+
+        std::unique_lock<std::mutex> lock(m_mutex);
+        if (frame_count == 2) {
+            m_animated = true;
+        }
+        m_frame_taken.wait(lock, [this]() { return m_stop || m_decoded_frames.size() < m_decoded_frame_count; });
+        if (m_stop) {
+            return;
+        }
+
+        std::vector<uint8_t> buffer;
+        if (! m_free_buffers.empty()) {
+            buffer = std::move(m_free_buffers.back());
+            m_free_buffers.pop_back();
+        }
+        buffer.assign(pixels, pixels + frame_size);
+        m_decoded_frames.push_back(Frame{std::move(buffer), delay_milliseconds});
+    }
+}
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <imgui.h>
+
+#include "gifDecoder.h"
+
+/**
+ * @brief Plays an animated GIF, decoding its frames incrementally on a worker thread.
+ *
+ * The worker decodes ahead into a small ring of CPU frames (blocking once it is full), and update()
+ * uploads them into a small ring of textures ahead of the frame being shown, switching frames at the
+ * delays stored in the file. The animation loops. Memory use is bounded by the ring sizes, whatever
+ * the number of frames. Except for the constructor's decoding, everything runs on the OpenGL thread.
+ */
+class AnimatedImage {
+public:
+
+    /**
+     * @param decoded_frame_count Frames decoded ahead in CPU memory.
+     * @param texture_count Textures frames are uploaded into (at least 2: the one shown and the next one).
+     * @throws std::runtime_error if the file can't be read or isn't a GIF.
+     */
+    AnimatedImage(const std::string& filepath, size_t decoded_frame_count, size_t texture_count);
+    ~AnimatedImage();
+
+    // Uploads decoded frames and advances the frame shown according to the frame delays. Call once per frame.
+    void update();
+
+    // Whether the file has more than one frame (only known once its second frame has been decoded).
+    bool isAnimated() const;
+
+    // Whether a frame has been uploaded yet.
+    bool hasFrame() const;
+    ImTextureID getTexture() const;
+
+    int32_t getWidth() const;
+    int32_t getHeight() const;
+
+    size_t getSizeInBytes() const;
+
+    // Disable copying AnimatedImage objects.
+    AnimatedImage(const AnimatedImage&) = delete;
+    AnimatedImage& operator=(const AnimatedImage&) = delete;
+
+private:
+    struct Frame {
+        std::vector<uint8_t>    pixels;
+        int32_t                 delay_milliseconds{ 0 };
+    };
+
+    struct UploadedFrame {
+        size_t                  texture;    // Index into m_textures.
+        int32_t                 delay_milliseconds;
+    };
+
+    // Worker thread: decodes frames into m_decoded_frames until stopped.
+    void decode();
+
+    GifDecoder                                              m_decoder;
+    size_t                                                  m_decoded_frame_count;
+
+    // Shared with the worker.
+    std::deque<Frame>                                       m_decoded_frames;
+    std::vector<std::vector<uint8_t>>                       m_free_buffers;
+    bool                                                    m_animated{ false };
+    bool                                                    m_stop{ false };
+    mutable std::mutex                                      m_mutex;
+    std::condition_variable                                 m_frame_taken;
+    std::thread                                             m_worker;
+
+    std::vector<uint32_t>                                   m_textures;
+    size_t                                                  m_next_texture{ 0 };
+    std::deque<UploadedFrame>                               m_uploaded_frames;
+    std::optional<UploadedFrame>                            m_shown_frame;
+    std::chrono::time_point<std::chrono::steady_clock>      m_shown_since;
+};
@@ -0,0 +1,193 @@
+#include <algorithm>
+#include <iostream>
+#include "audioPlayer.h"
+
+AudioPlayer::AudioPlayer(ThreadPool& thread_pool, size_t preopened_count)
+    : m_thread_pool(thread_pool), m_preopened_count(preopened_count) {}
+
+AudioPlayer::~AudioPlayer() {
+    clear();
+}
+
+void AudioPlayer::update(const std::vector<std::string>& upcoming_filepaths) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_upcoming_filepaths = upcoming_filepaths;
+    reschedule();
+}
+
+bool AudioPlayer::play(const std::string& filepath) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_music) {
+        m_music->stop();
+        m_music = nullptr;
+    }
+    m_current_filepath = filepath;
+
+    // A file that is still being opened is waited on, which is never longer than opening it again.
+    auto it = m_entries.find(filepath);
+    if (it != m_entries.end() && it->second.future.valid()) {
+        try {
+            m_music = it->second.future.get();
+        } catch (const std::exception& e) {
+            std::cerr << e.what() << std::endl;
+        }
+        m_entries.erase(it);
+    } else {
+        m_music = open(filepath);
+    }
+
+    // The window moves forward by one now that this file is no longer upcoming.
+    reschedule();
+
+    if (! m_music) {
+        std::cerr << "error: couldn't open audio file: " << filepath << std::endl;
+        return false;
+    }
+    m_music->setLoop(m_looping);
+    m_music->setVolume(m_volume * 100.0f);
+    m_music->play();
+    return true;
+}
+
+void AudioPlayer::close() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_music) {
+        m_music->stop();
+        m_music = nullptr;
+    }
+}
+
+void AudioPlayer::setPaused(bool paused) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (! m_music) {
+        return;
+    }
+    if (paused) {
+        m_music->pause();
+    } else {
+        m_music->play();
+    }
+}
+
+bool AudioPlayer::isPaused() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return ! m_music || m_music->getStatus() != sf::SoundSource::Playing;
+}
+
+bool AudioPlayer::isOpen() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_music != nullptr;
+}
+
+void AudioPlayer::setLooping(bool looping) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_looping = looping;
+    if (m_music) {
+        m_music->setLoop(looping);
+    }
+}
+
+bool AudioPlayer::isLooping() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_looping;
+}
+
+void AudioPlayer::setVolume(float volume) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_volume = std::clamp(volume, 0.0f, 1.0f);
+    if (m_music) {
+        m_music->setVolume(m_volume * 100.0f);
+    }
+}
+
+float AudioPlayer::getVolume() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_volume;
+}
+
+void AudioPlayer::seek(float seconds) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_music) {
+        m_music->setPlayingOffset(sf::seconds(std::clamp(seconds, 0.0f, m_music->getDuration().asSeconds())));
+    }
+}
+
+float AudioPlayer::getPosition() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_music ? m_music->getPlayingOffset().asSeconds() : 0.0f;
+}
+
+float AudioPlayer::getDuration() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_music ? m_music->getDuration().asSeconds() : 0.0f;
+}
+
+uint32_t AudioPlayer::getChannelCount() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_music ? m_music->getChannelCount() : 0;
+}
+
+uint32_t AudioPlayer::getSampleRate() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_music ? m_music->getSampleRate() : 0;
+}
+
+void AudioPlayer::clear() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_music) {
+        m_music->stop();
+        m_music = nullptr;
+    }
+    for (auto& [filepath, entry] : m_entries) {
+        entry.cancelled->store(true);
+    }
+    m_entries.clear();
+    m_upcoming_filepaths.clear();
+    m_current_filepath = std::nullopt;
+}
+
+std::unique_ptr<sf::Music> AudioPlayer::open(const std::string& filepath) {
+    auto music = std::make_unique<sf::Music>();
+    if (! music->openFromFile(filepath)) {
+        return nullptr;
+    }
+    return music;
+}
+
+void AudioPlayer::reschedule() {
+    std::unordered_map<std::string, Entry> scheduled_entries;
+
+    for (const std::string& filepath : m_upcoming_filepaths) {
+        if (scheduled_entries.size() >= m_preopened_count) {
+            break;
+        }
+        if ((m_current_filepath && filepath == m_current_filepath.value()) || scheduled_entries.contains(filepath)) {
+            continue;
+        }
+
+        // Keep decoders that are open (or being opened) already.
+        auto it = m_entries.find(filepath);
+        if (it != m_entries.end()) {
+            scheduled_entries.emplace(filepath, std::move(it->second));
+            m_entries.erase(it);
+            continue;
+        }
+
+        auto cancelled = std::make_shared<std::atomic<bool>>(false);
+        std::future<std::unique_ptr<sf::Music>> future = m_thread_pool.submit(
+            [filepath, cancelled]() -> std::unique_ptr<sf::Music> {
+                if (cancelled->load()) {
+                    return nullptr;
+                }
+                return open(filepath);
+            }
+        );
+        scheduled_entries.emplace(filepath, Entry{cancelled, std::move(future)});
+    }
+
+    // Whatever is left fell out of the window. Decoders that are open are closed along with their entry.
+    for (auto& [filepath, entry] : m_entries) {
+        entry.cancelled->store(true);
+    }
+    m_entries = std::move(scheduled_entries);
+}
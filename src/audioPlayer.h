@@ -0,0 +1,101 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <SFML/Audio/Music.hpp>
+
+#include "threadPool.h"
+
+/**
+ * @brief Streams the current audio file with sf::Music, keeping decoders open for the upcoming ones.
+ *
+ * Opening a file reads and parses its header (for some formats it also scans the file), so the
+ * first `preopened_count` upcoming files are opened ahead of time on the given thread pool. play()
+ * then only has to start a stream that is already set up. Files that drop out of the upcoming list
+ * are closed. All methods are thread safe.
+ */
+class AudioPlayer {
+public:
+    AudioPlayer(ThreadPool& thread_pool, size_t preopened_count);
+    ~AudioPlayer();
+
+    /**
+     * @brief Replaces the list of upcoming files.
+     *
+     * @param upcoming_filepaths Files in the order they will be played. Only the first
+     * `preopened_count` of them (excluding the current one) are opened ahead of time.
+     */
+    void update(const std::vector<std::string>& upcoming_filepaths);
+
+    /**
+     * @brief Stops the current file and starts playing the given one from its beginning.
+     *
+     * @return Whether the file could be opened. If not, nothing is playing afterwards.
+     */
+    bool play(const std::string& filepath);
+
+    // Stops playback and closes the current file, e.g. before it is moved.
+    void close();
+
+    // Pauses or resumes the current file. Resuming a file that played to its end starts it over.
+    void setPaused(bool paused);
+    bool isPaused() const;
+
+    // Whether a file is open (and either playing or paused).
+    bool isOpen() const;
+
+    void setLooping(bool looping);
+    bool isLooping() const;
+
+    // Volume of the current and following files, from 0 to 1.
+    void setVolume(float volume);
+    float getVolume() const;
+
+    // Position in the current file, in seconds.
+    void seek(float seconds);
+    float getPosition() const;
+    float getDuration() const;
+
+    uint32_t getChannelCount() const;
+    uint32_t getSampleRate() const;
+
+    // Closes every file, the current one included.
+    void clear();
+
+    // Disable copying AudioPlayer objects.
+    AudioPlayer(const AudioPlayer&) = delete;
+    AudioPlayer& operator=(const AudioPlayer&) = delete;
+
+private:
+    struct Entry {
+        std::shared_ptr<std::atomic<bool>>          cancelled;
+        std::future<std::unique_ptr<sf::Music>>     future;
+    };
+
+    // Opens a file, returning nullptr (SFML reports why on stderr) if it isn't a supported audio file.
+    static std::unique_ptr<sf::Music> open(const std::string& filepath);
+
+    // Re-applies the preopened window. Expects m_mutex to be held.
+    void reschedule();
+
+    ThreadPool&                                 m_thread_pool;
+    size_t                                      m_preopened_count;
+
+    std::vector<std::string>                    m_upcoming_filepaths;
+    std::optional<std::string>                  m_current_filepath;
+    std::unordered_map<std::string, Entry>      m_entries;
+
+    std::unique_ptr<sf::Music>                  m_music;
+    bool                                        m_looping{ false };
+    float                                       m_volume{ 1.0f };
+
+    mutable std::mutex                          m_mutex;
+};
@@ -0,0 +1,102 @@
+#include <algorithm>
+#include <filesystem>
+#include <iomanip>
+#include <sstream>
+#include <vector>
+#include "cacheDirectory.h"
+#include "util.h"
+
+CacheDirectory::CacheDirectory(const std::string& directory, const std::string& extension, size_t max_size_in_bytes)
+    : m_directory(directory), m_extension(extension), m_max_size_in_bytes(max_size_in_bytes) {
+    std::error_code ec;
+    std::filesystem::create_directories(directory, ec);
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    prune();
+}
+
+std::string CacheDirectory::getEntryFilepath(uint64_t hash) const {
+    std::stringstream name;
+    name << std::hex << std::setw(16) << std::setfill('0') << hash << m_extension;
+    return joinPaths(m_directory, name.str());
+}
+
+void CacheDirectory::touch(const std::string& entry_filepath) const {
+    std::error_code ec;
+    std::filesystem::last_write_time(entry_filepath, std::filesystem::file_time_type::clock::now(), ec);
+}
+
+bool CacheDirectory::write(const std::string& entry_filepath, const std::function<void(std::ostream&)>& write) const {
+    if (! writeFileAtomically(entry_filepath, write)) {
+        return false;
+    }
+
+    // A rewritten entry is counted twice until the next pruning, which only makes it come a bit early.
+    std::error_code ec;
+    uintmax_t size = std::filesystem::file_size(entry_filepath, ec);
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_size_in_bytes += ec ? 0 : static_cast<size_t>(size);
+    if (m_size_in_bytes > m_max_size_in_bytes) {
+        prune();
+    }
+    return true;
+}
+
+size_t CacheDirectory::getSizeInBytes() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_size_in_bytes;
+}
+
+void CacheDirectory::prune() const {
+    namespace fs = std::filesystem;
+
+    struct Entry {
+        fs::path                path;
+        uintmax_t               size;
+        fs::file_time_type      last_use_time;
+    };
+
+    // Temporary files (see writeFileAtomically()) of writes in progress are recent, so they are left alone.
+    std::vector<Entry> entries;
+    size_t size_in_bytes = 0;
+    std::error_code ec;
+    const fs::file_time_type stale_time = fs::file_time_type::clock::now() - STALE_TEMPORARY_FILE_AGE;
+    for (fs::directory_iterator it(m_directory, ec), end; ! ec && it != end; it.increment(ec)) {
+        std::error_code entry_ec;
+        if (! it->is_regular_file(entry_ec)) {
+            continue;
+        }
+        if (it->path().extension() == ".tmp") {
+            fs::file_time_type last_write_time = it->last_write_time(entry_ec);
+            if (! entry_ec && last_write_time < stale_time) {
+                fs::remove(it->path(), entry_ec);
+            }
+            continue;
+        }
+        if (it->path().extension() != m_extension) {
+            continue;
+        }
+        uintmax_t size = it->file_size(entry_ec);
+        fs::file_time_type last_use_time = it->last_write_time(entry_ec);
+        if (entry_ec) {
+            continue;
+        }
+        entries.push_back({it->path(), size, last_use_time});
+        size_in_bytes += static_cast<size_t>(size);
+    }
+
+    if (size_in_bytes > m_max_size_in_bytes) {
+        std::sort(entries.begin(), entries.end(), [](const Entry& a, const Entry& b) { return a.last_use_time < b.last_use_time; });
+        const size_t pruned_size = static_cast<size_t>(m_max_size_in_bytes * PRUNED_SIZE_RATIO);
+        for (const Entry& entry : entries) {
+            if (size_in_bytes <= pruned_size) {
+                break;
+            }
+            std::error_code remove_ec;
+            if (fs::remove(entry.path, remove_ec)) {
+                size_in_bytes -= static_cast<size_t>(entry.size);
+            }
+        }
+    }
+    m_size_in_bytes = size_in_bytes;
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <ostream>
+#include <string>
+
+/**
+ * @brief A directory of cache entries (one file each, named after a hash) bounded in total size.
+ *
+ * Once the entries grow past `max_size_in_bytes`, the ones used the longest ago are deleted until they
+ * take no more than `PRUNED_SIZE_RATIO` of it, so that the directory isn't pruned again on the next
+ * write. An entry's modification time is its last use: reading one should touch() it. Entries left
+ * behind by files that were moved (e.g. by labeling) or deleted thus age out on their own. Safe to use
+ * from any thread.
+ */
+class CacheDirectory {
+public:
+    static constexpr double PRUNED_SIZE_RATIO = 0.75;
+
+    // Temporary files older than this were left behind by an interrupted write and are deleted when pruning.
+    static constexpr std::chrono::minutes STALE_TEMPORARY_FILE_AGE{ 10 };
+
+    // Creates the directory if needed, and prunes it if it is already over the limit.
+    CacheDirectory(const std::string& directory, const std::string& extension, size_t max_size_in_bytes);
+
+    // Path of the entry for the given hash, whether it exists or not.
+    std::string getEntryFilepath(uint64_t hash) const;
+
+    // Marks the entry as just used.
+    void touch(const std::string& entry_filepath) const;
+
+    // Writes the entry (see writeFileAtomically()), then prunes the directory if it grew past the limit.
+    bool write(const std::string& entry_filepath, const std::function<void(std::ostream&)>& write) const;
+
+    // Total size of the entries, as of the last pruning plus what was written since.
+    size_t getSizeInBytes() const;
+
+    // Disable copying CacheDirectory objects.
+    CacheDirectory(const CacheDirectory&) = delete;
+    CacheDirectory& operator=(const CacheDirectory&) = delete;
+
+private:
+
+    // Deletes stale temporary files, then the least recently used entries until they fit. Expects m_mutex to be held.
+    void prune() const;
+
+    std::string             m_directory;
+    std::string             m_extension;
+    size_t                  m_max_size_in_bytes;
+
+    mutable std::mutex      m_mutex;
+    mutable size_t          m_size_in_bytes{ 0 };
+};
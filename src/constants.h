@@ -19,3 +19,60 @@ const std::string   APPLICATION_UI_ICON_FONT_REGULAR_FILEPATH   = joinPaths(APPL
 const std::string   APPLICATION_UI_ICON_FONT_SOLID_FILEPATH     = joinPaths(APPLICATION_UI_ICON_FONT_DIR, "fa-solid-900.ttf");
 
 const glm::vec2     ERROR_POPUP_DIALOG_WINDOW_SIZE              = {400.0f, 200.0f};
+
+const size_t        IMAGE_DECODE_WORKER_COUNT                   = 2;
+const size_t        IMAGE_PREFETCH_LOOKAHEAD                    = 8;
+const size_t        IMAGE_PREFETCH_MAX_LOOKAHEAD                = 16;
+const size_t        IMAGE_PREFETCH_BYTE_BUDGET                  = 1024ull * 1024ull * 1024ull;
+const size_t        TEXTURE_CACHE_VRAM_BUDGET                   = 512ull * 1024ull * 1024ull;
+const size_t        TEXTURE_UPLOAD_RING_SIZE                    = 3;
+const size_t        TEXTURE_UPLOAD_SLICE_BYTES                  = 4ull * 1024ull * 1024ull;
+const size_t        TEXTURE_UPLOAD_BYTES_PER_FRAME              = 8ull * 1024ull * 1024ull;
+const size_t        TEXTURE_POOL_BYTE_BUDGET                    = 256ull * 1024ull * 1024ull;
+
+const std::string   APPLICATION_CACHE_DIR                       = joinPaths(std::getenv("HOME"), ".mlbc/cache");
+const std::string   THUMBNAIL_PACK_FILEPATH                     = joinPaths(APPLICATION_CACHE_DIR, "thumbnails.pack");
+const size_t        THUMBNAIL_PACK_MAX_SIZE                     = 2048ull * 1024ull * 1024ull;
+const int32_t       THUMBNAIL_SIZE                              = 128;
+const size_t        THUMBNAIL_WORKER_COUNT                      = 2;
+const size_t        THUMBNAIL_MAX_PENDING_COUNT                 = 64;
+const size_t        THUMBNAIL_UPLOADS_PER_FRAME                 = 32;
+const int32_t       THUMBNAIL_ATLAS_PAGE_SIZE                   = 2048;
+const size_t        THUMBNAIL_ATLAS_MAX_PAGE_COUNT              = 4;
+const int32_t       THUMBNAIL_ATLAS_REGROW_DELAY_MS             = 5000;
+const float         THUMBNAIL_GRID_CELL_SIZE                    = 96.0f;
+
+const int32_t       TILED_PREVIEW_TILE_SIZE                     = 512;
+const size_t        TILED_PREVIEW_MAX_TILE_COUNT                = 128;
+const size_t        TILED_PREVIEW_UPLOADS_PER_FRAME             = 4;
+const size_t        TILED_PREVIEW_MIN_PIXEL_COUNT               = 64ull * 1024ull * 1024ull;
+const size_t        PIXEL_ARENA_CACHE_BYTE_BUDGET               = 512ull * 1024ull * 1024ull;
+const size_t        READAHEAD_FILE_COUNT                        = 16;
+const size_t        ANIMATED_IMAGE_DECODED_FRAME_COUNT          = 4;
+const size_t        ANIMATED_IMAGE_TEXTURE_COUNT                = 3;
+const int32_t       ANIMATED_IMAGE_MIN_FRAME_DELAY_MS           = 20;
+const int32_t       ANIMATED_IMAGE_DEFAULT_FRAME_DELAY_MS       = 100;
+
+const size_t        MEMORY_BUDGET_COMPRESSED_BYTES              = 512ull * 1024ull * 1024ull;
+const size_t        MEMORY_BUDGET_DECODED_PIXELS_BYTES          = 2048ull * 1024ull * 1024ull;
+const size_t        MEMORY_BUDGET_GPU_TEXTURES_BYTES            = 1024ull * 1024ull * 1024ull;
+
+const size_t        MEDIA_PROBE_WORKER_COUNT                    = 2;
+const size_t        MEDIA_PROBE_BATCH_SIZE                      = 64;
+const size_t        MEDIA_PROBE_MAX_PIXEL_COUNT                 = 256ull * 1024ull * 1024ull;
+const int32_t       MEDIA_INDEX_REFRESH_INTERVAL_MS             = 1000;
+
+const size_t        AUDIO_PREOPENED_COUNT                       = 3;
+const std::string   WAVEFORM_CACHE_DIR                          = joinPaths(APPLICATION_CACHE_DIR, "waveforms");
+const size_t        WAVEFORM_CACHE_MAX_SIZE                     = 512ull * 1024ull * 1024ull;
+const uint32_t      WAVEFORM_BLOCK_FRAME_COUNT                  = 256;
+const std::string   SPECTROGRAM_CACHE_DIR                       = joinPaths(APPLICATION_CACHE_DIR, "spectrograms");
+const size_t        SPECTROGRAM_CACHE_MAX_SIZE                  = 1024ull * 1024ull * 1024ull;
+const size_t        SPECTROGRAM_WORKER_COUNT                    = 4;
+const int32_t       SPECTROGRAM_MAX_COLUMN_COUNT                = 8192;
+const size_t        SPECTROGRAM_UPLOADS_PER_FRAME               = 4;
+
+const int32_t       DIRECTORY_RESCAN_INTERVAL_MS                = 60000;
+const int32_t       FILE_WATCHER_BATCH_WINDOW_MS                = 50;
+const int32_t       FILE_WATCHER_MAX_BATCH_DELAY_MS             = 500;
+const std::string   DIRECTORY_INDEX_CACHE_DIR                   = joinPaths(APPLICATION_CACHE_DIR, "directories");
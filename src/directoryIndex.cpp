@@ -0,0 +1,179 @@
+#include <algorithm>
+#include <filesystem>
+#include <unordered_set>
+#include "directoryIndex.h"
+
+bool DirectoryIndex::Changes::empty() const {
+    return added.empty() && removed.empty() && modified.empty();
+}
+
+DirectoryIndex::DirectoryIndex(const std::string& directory, MediaType media_type, std::vector<std::string> filepaths)
+    : m_directory(directory), m_media_type(media_type), m_extensions(getValidExtensions(media_type)), m_filepaths(std::move(filepaths)) {
+    m_positions.reserve(m_filepaths.size());
+    for (size_t position = 0; position < m_filepaths.size(); position++) {
+        m_positions.emplace(m_filepaths[position], position);
+    }
+}
+
+DirectoryIndex::Changes DirectoryIndex::apply(const std::string& filename, efsw::Action action, const std::string& old_filename) {
+    namespace fs = std::filesystem;
+
+    Changes changes;
+    const std::string filepath = getFilepath(filename);
+    switch (action) {
+        case efsw::Actions::Add:
+        case efsw::Actions::Modified: {
+
+            // Directories get actions too. A file modified without having been added was missed, so it is added now.
+            std::error_code error;
+            if (! isMediaFilename(filename) || ! fs::is_regular_file(filepath, error)) {
+                break;
+            }
+            if (add(filepath)) {
+                changes.added.push_back(filepath);
+            } else if (action == efsw::Actions::Modified) {
+                changes.modified.push_back(filepath);
+            }
+            break;
+        }
+        case efsw::Actions::Delete:
+            if (remove(filepath)) {
+                changes.removed.push_back(filepath);
+            }
+            break;
+        case efsw::Actions::Moved: {
+
+            // A file renamed within the directory keeps its place. One moved in from elsewhere has no old name.
+            const std::string old_filepath = old_filename.empty() ? std::string() : getFilepath(old_filename);
+            auto it = old_filepath.empty() ? m_positions.end() : m_positions.find(old_filepath);
+            const bool media_file = isMediaFilename(filename);
+            if (it != m_positions.end() && media_file && ! contains(filepath)) {
+                size_t position = it->second;
+                m_positions.erase(it);
+                m_filepaths[position] = filepath;
+                m_positions.emplace(filepath, position);
+                changes.removed.push_back(old_filepath);
+                changes.added.push_back(filepath);
+                break;
+            }
+            if (! old_filepath.empty() && remove(old_filepath)) {
+                changes.removed.push_back(old_filepath);
+            }
+            if (media_file && add(filepath)) {
+                changes.added.push_back(filepath);
+            }
+            break;
+        }
+    }
+    return changes;
+}
+
+DirectoryIndex::Changes DirectoryIndex::apply(const std::vector<Watcher::Event>& events) {
+    Changes changes;
+    for (const Watcher::Event& event : events) {
+        Changes event_changes = apply(event.filename, event.action, event.old_filename);
+        changes.added.insert(changes.added.end(), event_changes.added.begin(), event_changes.added.end());
+        changes.removed.insert(changes.removed.end(), event_changes.removed.begin(), event_changes.removed.end());
+        changes.modified.insert(changes.modified.end(), event_changes.modified.begin(), event_changes.modified.end());
+    }
+    return changes;
+}
+
+DirectoryIndex::Changes DirectoryIndex::reconcile(const std::vector<std::string>& filepaths) {
+    namespace fs = std::filesystem;
+
+    // The listing may predate actions applied since, so a difference only counts once the file confirms it.
+    // Only the few files that differ are checked.
+    Changes changes;
+    const std::unordered_set<std::string> listed(filepaths.begin(), filepaths.end());
+    for (const std::string& filepath : m_filepaths) {
+        std::error_code error;
+        if (! filepath.empty() && ! listed.contains(filepath) && ! fs::exists(filepath, error)) {
+            changes.removed.push_back(filepath);
+        }
+    }
+    for (const std::string& filepath : changes.removed) {
+        remove(filepath);
+    }
+    for (const std::string& filepath : filepaths) {
+        std::error_code error;
+        if (! contains(filepath) && fs::is_regular_file(filepath, error) && add(filepath)) {
+            changes.added.push_back(filepath);
+        }
+    }
+    return changes;
+}
+
+bool DirectoryIndex::add(const std::string& filepath) {
+    if (filepath.empty() || m_positions.contains(filepath)) {
+        return false;
+    }
+    m_positions.emplace(filepath, m_filepaths.size());
+    m_filepaths.push_back(filepath);
+    return true;
+}
+
+bool DirectoryIndex::remove(const std::string& filepath) {
+    auto it = m_positions.find(filepath);
+    if (it == m_positions.end()) {
+        return false;
+    }
+    m_filepaths[it->second].clear();
+    m_positions.erase(it);
+    m_removed_count++;
+    return true;
+}
+
+bool DirectoryIndex::contains(const std::string& filepath) const {
+    return m_positions.contains(filepath);
+}
+
+size_t DirectoryIndex::size() const {
+    return m_positions.size();
+}
+
+bool DirectoryIndex::empty() const {
+    return m_positions.empty();
+}
+
+const std::string& DirectoryIndex::getDirectory() const {
+    return m_directory;
+}
+
+MediaType DirectoryIndex::getMediaType() const {
+    return m_media_type;
+}
+
+const std::vector<std::string>& DirectoryIndex::getFilepaths() {
+    if (m_removed_count > 0) {
+        compact();
+    }
+    return m_filepaths;
+}
+
+bool DirectoryIndex::isMediaFilename(const std::string& filename) const {
+    const std::string extension = std::filesystem::path(filename).extension().string();
+    return std::find(m_extensions.begin(), m_extensions.end(), extension) != m_extensions.end();
+}
+
+std::string DirectoryIndex::getFilepath(const std::string& filename) const {
+
+    // Built like the paths listed by loadMediaFiles(), so that both can be compared.
+    return (std::filesystem::path(m_directory) / filename).string();
+}
+
+void DirectoryIndex::compact() {
+    size_t position = 0;
+    for (std::string& filepath : m_filepaths) {
+        if (filepath.empty()) {
+            continue;
+        }
+        if (m_positions[filepath] != position) {
+            m_positions[filepath] = position;
+            m_filepaths[position] = std::move(filepath);
+        }
+        position++;
+    }
+    m_filepaths.resize(position);
+    m_removed_count = 0;
+}
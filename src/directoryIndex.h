@@ -0,0 +1,75 @@
+#pragma once
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <efsw/efsw.hpp>
+
+#include "fileWatcher.h"
+#include "util.h"
+
+/**
+ * @brief The media files of a directory, kept up to date from the actions reported by its Watcher
+ * instead of listing the directory again on every change.
+ *
+ * Files are kept in the order they were found. Adding, removing and renaming a file take constant time:
+ * a removed file leaves a hole that is compacted away the next time the list is read, so a burst of
+ * actions (e.g. thousands of files copied in) costs a single pass over the list at most. Not thread
+ * safe: guard it like the file list it replaces.
+ */
+class DirectoryIndex {
+public:
+    // Files whose presence changed, as full paths.
+    struct Changes {
+        std::vector<std::string>    added;
+        std::vector<std::string>    removed;
+        std::vector<std::string>    modified;
+
+        bool empty() const;
+    };
+
+    // Starts from a listing of the directory, as returned by loadMediaFiles().
+    DirectoryIndex(const std::string& directory, MediaType media_type, std::vector<std::string> filepaths);
+
+    /**
+     * @brief Applies an action reported by a (non recursive) Watcher of the directory. Files that aren't
+     * media files of the index's type are ignored.
+     */
+    Changes apply(const std::string& filename, efsw::Action action, const std::string& old_filename);
+
+    // Applies a batch of actions delivered by the Watcher, in order.
+    Changes apply(const std::vector<Watcher::Event>& events);
+
+    /**
+     * @brief Brings the index in line with a fresh listing of the directory, for the actions a watcher
+     * may have missed. Files still there keep their place, new ones are appended in listing order.
+     */
+    Changes reconcile(const std::vector<std::string>& filepaths);
+
+    // Returns whether the file was added, respectively removed.
+    bool add(const std::string& filepath);
+    bool remove(const std::string& filepath);
+
+    bool contains(const std::string& filepath) const;
+    size_t size() const;
+    bool empty() const;
+
+    const std::string& getDirectory() const;
+    MediaType getMediaType() const;
+
+    // Files in order. Compacts removed files away first, hence not const.
+    const std::vector<std::string>& getFilepaths();
+
+private:
+    bool isMediaFilename(const std::string& filename) const;
+    std::string getFilepath(const std::string& filename) const;
+    void compact();
+
+    std::string                                 m_directory;
+    MediaType                                   m_media_type;
+    std::vector<std::string>                    m_extensions;
+    std::vector<std::string>                    m_filepaths;        // Removed files are left empty until compacted.
+    std::unordered_map<std::string, size_t>     m_positions;
+    size_t                                      m_removed_count{ 0 };
+};
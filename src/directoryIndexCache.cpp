@@ -0,0 +1,201 @@
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <stdexcept>
+#include "directoryIndexCache.h"
+#include "mappedFile.h"
+
+namespace {
+    const char      CACHE_MAGIC[8]      = {'M', 'L', 'B', 'C', 'D', 'I', 'R', 'S'};
+    const uint32_t  CACHE_VERSION       = 1;
+
+    // Probe status of a file that wasn't probed when the snapshot was taken.
+    const int32_t   UNPROBED_STATUS     = -1;
+
+    struct CacheHeader {
+        char        magic[8];
+        uint32_t    version;
+        int32_t     media_type;
+        uint64_t    entry_count;
+        uint64_t    directory_size;
+        uint64_t    names_size;
+    };
+
+    struct ProbeRecord {
+        int32_t     status;
+        int32_t     width;
+        int32_t     height;
+        int32_t     channels;
+        int32_t     bit_depth;
+        int32_t     reserved;
+    };
+
+    // Fixed size of an entry, besides its name.
+    const uint64_t  ENTRY_SIZE          = sizeof(uint64_t) + sizeof(int64_t) + sizeof(ProbeRecord) + sizeof(uint64_t);
+
+    // Sections are aligned to 8 bytes, so that the arrays of the mapping could be read in place.
+    uint64_t getPaddedSize(uint64_t size) {
+        return (size + 7) & ~uint64_t(7);
+    }
+
+    // What the paths of the files in the directory start with, as built by loadMediaFiles().
+    std::string getFilepathPrefix(const std::string& directory) {
+        return (std::filesystem::path(directory) / "").string();
+    }
+}
+
+DirectoryIndexCache::DirectoryIndexCache(const std::string& directory)
+    : m_directory(directory) {
+    std::error_code ec;
+    std::filesystem::create_directories(directory, ec);
+}
+
+std::shared_ptr<const DirectorySnapshot> DirectoryIndexCache::find(const std::string& directory, MediaType media_type) const {
+    std::optional<MappedFile> file;
+    try {
+        file.emplace(getEntryFilepath(directory, media_type));
+    } catch (const std::runtime_error&) {
+        return nullptr;
+    }
+    const uint8_t* data = file->getData();
+    const uint64_t size = file->getSize();
+
+    CacheHeader header{};
+    if (size < sizeof(CacheHeader)) {
+        return nullptr;
+    }
+    std::memcpy(&header, data, sizeof(CacheHeader));
+    if (std::memcmp(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC)) != 0
+        || header.version != CACHE_VERSION
+        || header.media_type != static_cast<int32_t>(media_type)
+        || header.directory_size != directory.size()) {
+        return nullptr;
+    }
+
+    // Section sizes that don't add up to the file size mean a damaged entry, caught before allocating for it.
+    const uint64_t entry_count = header.entry_count;
+    if (entry_count > size / ENTRY_SIZE || header.names_size > size) {
+        return nullptr;
+    }
+    const uint64_t directory_offset = sizeof(CacheHeader);
+    const uint64_t file_sizes_offset = directory_offset + getPaddedSize(header.directory_size);
+    const uint64_t modification_times_offset = file_sizes_offset + entry_count * sizeof(uint64_t);
+    const uint64_t probe_records_offset = modification_times_offset + entry_count * sizeof(int64_t);
+    const uint64_t name_offsets_offset = probe_records_offset + entry_count * sizeof(ProbeRecord);
+    const uint64_t names_offset = name_offsets_offset + (entry_count + 1) * sizeof(uint64_t);
+    if (names_offset + header.names_size != size
+        || std::memcmp(data + directory_offset, directory.data(), directory.size()) != 0) {
+        return nullptr;
+    }
+
+    auto snapshot = std::make_shared<DirectorySnapshot>();
+    snapshot->directory = directory;
+    snapshot->media_type = media_type;
+    snapshot->file_sizes.resize(entry_count);
+    snapshot->modification_times.resize(entry_count);
+    if (entry_count > 0) {
+        std::memcpy(snapshot->file_sizes.data(), data + file_sizes_offset, entry_count * sizeof(uint64_t));
+        std::memcpy(snapshot->modification_times.data(), data + modification_times_offset, entry_count * sizeof(int64_t));
+    }
+
+    snapshot->probe_results.resize(entry_count);
+    for (uint64_t i = 0; i < entry_count; i++) {
+        ProbeRecord record;
+        std::memcpy(&record, data + probe_records_offset + i * sizeof(ProbeRecord), sizeof(ProbeRecord));
+        if (record.status == UNPROBED_STATUS) {
+            continue;
+        }
+        if (record.status < static_cast<int32_t>(MediaProbeStatus::Valid) || record.status > static_cast<int32_t>(MediaProbeStatus::Oversized)) {
+            return nullptr;
+        }
+        MediaProbeResult& result = snapshot->probe_results[i].emplace();
+        result.status = static_cast<MediaProbeStatus>(record.status);
+        result.width = record.width;
+        result.height = record.height;
+        result.channels = record.channels;
+        result.bit_depth = record.bit_depth;
+        result.file_size = snapshot->file_sizes[i];
+    }
+
+    const std::string prefix = getFilepathPrefix(directory);
+    const char* names = reinterpret_cast<const char*>(data + names_offset);
+    uint64_t name_start;
+    std::memcpy(&name_start, data + name_offsets_offset, sizeof(uint64_t));
+    snapshot->filepaths.reserve(entry_count);
+    for (uint64_t i = 0; i < entry_count; i++) {
+        uint64_t name_end;
+        std::memcpy(&name_end, data + name_offsets_offset + (i + 1) * sizeof(uint64_t), sizeof(uint64_t));
+        if (name_start >= name_end || name_end > header.names_size) {
+            return nullptr;
+        }
+        std::string& filepath = snapshot->filepaths.emplace_back();
+        filepath.reserve(prefix.size() + (name_end - name_start));
+        filepath.append(prefix).append(names + name_start, name_end - name_start);
+        name_start = name_end;
+    }
+    return snapshot;
+}
+
+void DirectoryIndexCache::add(const DirectorySnapshot& snapshot) const {
+
+    // Names are stored relative to the directory, which usually halves the size of the entry.
+    const std::string prefix = getFilepathPrefix(snapshot.directory);
+    const size_t count = snapshot.filepaths.size();
+    std::vector<uint64_t> file_sizes;
+    std::vector<int64_t> modification_times;
+    std::vector<ProbeRecord> probe_records;
+    std::vector<uint64_t> name_offsets = {0};
+    std::string names;
+    file_sizes.reserve(count);
+    modification_times.reserve(count);
+    probe_records.reserve(count);
+    name_offsets.reserve(count + 1);
+    for (size_t i = 0; i < count; i++) {
+        const std::string& filepath = snapshot.filepaths[i];
+        if (filepath.size() <= prefix.size() || filepath.compare(0, prefix.size(), prefix) != 0) {
+            continue;
+        }
+        file_sizes.push_back(i < snapshot.file_sizes.size() ? snapshot.file_sizes[i] : 0);
+        modification_times.push_back(i < snapshot.modification_times.size() ? snapshot.modification_times[i] : 0);
+
+        ProbeRecord record{UNPROBED_STATUS, 0, 0, 0, 0, 0};
+        if (i < snapshot.probe_results.size() && snapshot.probe_results[i]) {
+            const MediaProbeResult& result = snapshot.probe_results[i].value();
+            record = {static_cast<int32_t>(result.status), result.width, result.height, result.channels, result.bit_depth, 0};
+        }
+        probe_records.push_back(record);
+
+        names.append(filepath, prefix.size(), std::string::npos);
+        name_offsets.push_back(names.size());
+    }
+
+    CacheHeader header{};
+    std::memcpy(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC));
+    header.version = CACHE_VERSION;
+    header.media_type = static_cast<int32_t>(snapshot.media_type);
+    header.entry_count = file_sizes.size();
+    header.directory_size = snapshot.directory.size();
+    header.names_size = names.size();
+
+    writeFileAtomically(getEntryFilepath(snapshot.directory, snapshot.media_type), [&](std::ostream& file) {
+        const char padding[8] = {};
+        file.write(reinterpret_cast<const char*>(&header), sizeof(CacheHeader));
+        file.write(snapshot.directory.data(), static_cast<std::streamsize>(snapshot.directory.size()));
+        file.write(padding, static_cast<std::streamsize>(getPaddedSize(snapshot.directory.size()) - snapshot.directory.size()));
+        file.write(reinterpret_cast<const char*>(file_sizes.data()), static_cast<std::streamsize>(file_sizes.size() * sizeof(uint64_t)));
+        file.write(reinterpret_cast<const char*>(modification_times.data()), static_cast<std::streamsize>(modification_times.size() * sizeof(int64_t)));
+        file.write(reinterpret_cast<const char*>(probe_records.data()), static_cast<std::streamsize>(probe_records.size() * sizeof(ProbeRecord)));
+        file.write(reinterpret_cast<const char*>(name_offsets.data()), static_cast<std::streamsize>(name_offsets.size() * sizeof(uint64_t)));
+        file.write(names.data(), static_cast<std::streamsize>(names.size()));
+    });
+}
+
+std::string DirectoryIndexCache::getEntryFilepath(const std::string& directory, MediaType media_type) const {
+
+    // The same directory may be configured for images and for audio files.
+    std::stringstream name;
+    name << std::hex << std::setw(16) << std::setfill('0') << hashPath(directory + '\0' + std::to_string(static_cast<int32_t>(media_type))) << ".index";
+    return joinPaths(m_directory, name.str());
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "mediaProbe.h"
+#include "util.h"
+
+// What was known about the files of a directory when the application last saw it, in listing order.
+struct DirectorySnapshot {
+    std::string                                     directory;
+    MediaType                                       media_type{ MediaType::Image };
+    std::vector<std::string>                        filepaths;
+    std::vector<uint64_t>                           file_sizes;             // 0 when unknown.
+    std::vector<int64_t>                            modification_times;     // In file clock ticks, 0 when unknown.
+    std::vector<std::optional<MediaProbeResult>>    probe_results;          // Empty for files not probed yet.
+};
+
+/**
+ * @brief Keeps a snapshot of each configured directory on disk, one compact binary file per directory,
+ * so that a directory of a million files is shown at startup without listing, stat-ing and probing it
+ * first. The snapshot is then checked against the directory in the background.
+ *
+ * Entries are memory mapped and laid out as flat arrays (sizes, modification times, probe results, then
+ * the file names relative to the directory packed end to end), so loading one is a single pass over
+ * it. Safe to use from any thread.
+ */
+class DirectoryIndexCache {
+public:
+    explicit DirectoryIndexCache(const std::string& directory);
+
+    // Returns the snapshot of the directory, `nullptr` if there is none (or it is damaged).
+    std::shared_ptr<const DirectorySnapshot> find(const std::string& directory, MediaType media_type) const;
+
+    // Stores the snapshot. Failures are ignored, the directory is just listed again next time.
+    void add(const DirectorySnapshot& snapshot) const;
+
+private:
+    std::string getEntryFilepath(const std::string& directory, MediaType media_type) const;
+
+    std::string     m_directory;
+};
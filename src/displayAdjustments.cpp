@@ -0,0 +1,204 @@
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+#include <glad/glad.h>
+#include "displayAdjustments.h"
+
+namespace {
+
+    // Shader sources for GLSL 1.30+ (and ES 3.00), with the older syntax substituted for GLSL 1.00/1.20.
+    const char* VERTEX_SHADER_MODERN =
+        "uniform mat4 ProjMtx;\n"
+        "in vec2 Position;\n"
+        "in vec2 UV;\n"
+        "in vec4 Color;\n"
+        "out vec2 Frag_UV;\n"
+        "void main() {\n"
+        "    Frag_UV = UV;\n"
+        "    gl_Position = ProjMtx * vec4(Position.xy, 0.0, 1.0);\n"
+        "}\n";
+
+    const char* VERTEX_SHADER_LEGACY =
+        "uniform mat4 ProjMtx;\n"
+        "attribute vec2 Position;\n"
+        "attribute vec2 UV;\n"
+        "attribute vec4 Color;\n"
+        "varying vec2 Frag_UV;\n"
+        "void main() {\n"
+        "    Frag_UV = UV;\n"
+        "    gl_Position = ProjMtx * vec4(Position.xy, 0.0, 1.0);\n"
+        "}\n";
+
+    const char* FRAGMENT_SHADER_MODERN_PREFIX =
+        "in vec2 Frag_UV;\n"
+        "out vec4 Out_Color;\n"
+        "#define SAMPLE texture\n"
+        "#define FRAG_COLOR Out_Color\n";
+
+    const char* FRAGMENT_SHADER_LEGACY_PREFIX =
+        "varying vec2 Frag_UV;\n"
+        "#define SAMPLE texture2D\n"
+        "#define FRAG_COLOR gl_FragColor\n";
+
+    // Channel values match DisplayChannel.
+    const char* FRAGMENT_SHADER =
+        "uniform sampler2D Texture;\n"
+        "uniform float Exposure;\n"
+        "uniform float Level;\n"
+        "uniform float Window;\n"
+        "uniform float Brightness;\n"
+        "uniform float Contrast;\n"
+        "uniform float Gamma;\n"
+        "uniform int Channel;\n"
+        "uniform bool Invert;\n"
+        "void main() {\n"
+        "    vec4 color = SAMPLE(Texture, Frag_UV);\n"
+        "    vec3 value = (color.rgb * exp2(Exposure) - (Level - 0.5 * Window)) / Window;\n"
+        "    value = (value - 0.5) * Contrast + 0.5 + Brightness;\n"
+        "    value = pow(clamp(value, 0.0, 1.0), vec3(1.0 / Gamma));\n"
+        "    if (Channel == 1) { value = vec3(value.r); }\n"
+        "    else if (Channel == 2) { value = vec3(value.g); }\n"
+        "    else if (Channel == 3) { value = vec3(value.b); }\n"
+        "    else if (Channel == 4) { value = vec3(color.a); color.a = 1.0; }\n"
+        "    if (Invert) { value = vec3(1.0) - value; }\n"
+        "    FRAG_COLOR = vec4(value, color.a);\n"
+        "}\n";
+
+    uint32_t compileShader(GLenum type, const std::string& source) {
+        uint32_t shader = glCreateShader(type);
+        const char* source_data = source.c_str();
+        glShaderSource(shader, 1, &source_data, nullptr);
+        glCompileShader(shader);
+
+        GLint status = GL_FALSE;
+        glGetShaderiv(shader, GL_COMPILE_STATUS, &status);
+        if (status != GL_TRUE) {
+            GLint log_length = 0;
+            glGetShaderiv(shader, GL_INFO_LOG_LENGTH, &log_length);
+            std::vector<char> log(static_cast<size_t>(std::max(log_length, 1)), '\0');
+            glGetShaderInfoLog(shader, log_length, nullptr, log.data());
+            std::cerr << "error: couldn't compile display adjustment shader: " << log.data() << std::endl;
+            glDeleteShader(shader);
+            return 0;
+        }
+        return shader;
+    }
+}
+
+DisplayAdjustmentRenderer::DisplayAdjustmentRenderer(const std::string& glsl_version)
+    : m_glsl_version(glsl_version) {}
+
+DisplayAdjustmentRenderer::~DisplayAdjustmentRenderer() {
+    if (m_program) {
+        glDeleteProgram(m_program);
+        m_program = 0;
+    }
+}
+
+void DisplayAdjustmentRenderer::newFrame() {
+    m_draw_parameters.clear();
+}
+
+void DisplayAdjustmentRenderer::begin(ImDrawList* draw_list, const DisplayAdjustments& adjustments) {
+    m_draw_parameters.push_back(DrawParameters{this, adjustments});
+    draw_list->AddCallback(&DisplayAdjustmentRenderer::onDraw, &m_draw_parameters.back());
+}
+
+void DisplayAdjustmentRenderer::end(ImDrawList* draw_list) {
+
+    // Hands the next commands back to the backend's own shader.
+    draw_list->AddCallback(ImDrawCallback_ResetRenderState, nullptr);
+}
+
+void DisplayAdjustmentRenderer::onDraw(const ImDrawList*, const ImDrawCmd* command) {
+    const DrawParameters* parameters = static_cast<const DrawParameters*>(command->UserCallbackData);
+    parameters->renderer->use(parameters->adjustments);
+}
+
+bool DisplayAdjustmentRenderer::ensureProgram(int32_t imgui_program) {
+    if (m_program) {
+        return true;
+    }
+    if (m_program_failed) {
+        return false;
+    }
+
+    // "#version 100", "#version 150", "#version 300 es", ...
+    const int32_t version = std::atoi(m_glsl_version.c_str() + std::string("#version ").size());
+    const bool modern = version >= 130;
+    const bool embedded = version == 100 || m_glsl_version.find(" es") != std::string::npos;
+    const std::string header = m_glsl_version + "\n" + (embedded ? "precision mediump float;\n" : "");
+
+    uint32_t vertex_shader = compileShader(GL_VERTEX_SHADER, header + (modern ? VERTEX_SHADER_MODERN : VERTEX_SHADER_LEGACY));
+    uint32_t fragment_shader = compileShader(GL_FRAGMENT_SHADER, header + (modern ? FRAGMENT_SHADER_MODERN_PREFIX : FRAGMENT_SHADER_LEGACY_PREFIX) + FRAGMENT_SHADER);
+    if (! vertex_shader || ! fragment_shader) {
+        glDeleteShader(vertex_shader);
+        glDeleteShader(fragment_shader);
+        m_program_failed = true;
+        return false;
+    }
+
+    // The backend's vertex attribute setup is reused as it is, so the attributes must be at the same locations.
+    uint32_t program = glCreateProgram();
+    glAttachShader(program, vertex_shader);
+    glAttachShader(program, fragment_shader);
+    for (const char* attribute : {"Position", "UV", "Color"}) {
+        GLint location = glGetAttribLocation(static_cast<GLuint>(imgui_program), attribute);
+        if (location >= 0) {
+            glBindAttribLocation(program, static_cast<GLuint>(location), attribute);
+        }
+    }
+    glLinkProgram(program);
+    glDetachShader(program, vertex_shader);
+    glDetachShader(program, fragment_shader);
+    glDeleteShader(vertex_shader);
+    glDeleteShader(fragment_shader);
+
+    GLint status = GL_FALSE;
+    glGetProgramiv(program, GL_LINK_STATUS, &status);
+    if (status != GL_TRUE) {
+        std::cerr << "error: couldn't link display adjustment shader" << std::endl;
+        glDeleteProgram(program);
+        m_program_failed = true;
+        return false;
+    }
+
+    m_program = program;
+    m_projection_location = glGetUniformLocation(m_program, "ProjMtx");
+    m_texture_location = glGetUniformLocation(m_program, "Texture");
+    m_exposure_location = glGetUniformLocation(m_program, "Exposure");
+    m_level_location = glGetUniformLocation(m_program, "Level");
+    m_window_location = glGetUniformLocation(m_program, "Window");
+    m_brightness_location = glGetUniformLocation(m_program, "Brightness");
+    m_contrast_location = glGetUniformLocation(m_program, "Contrast");
+    m_gamma_location = glGetUniformLocation(m_program, "Gamma");
+    m_channel_location = glGetUniformLocation(m_program, "Channel");
+    m_invert_location = glGetUniformLocation(m_program, "Invert");
+    return true;
+}
+
+void DisplayAdjustmentRenderer::use(const DisplayAdjustments& adjustments) {
+
+    // Called while the backend's program is bound with its projection for the viewport being rendered.
+    GLint imgui_program = 0;
+    glGetIntegerv(GL_CURRENT_PROGRAM, &imgui_program);
+    if (! imgui_program || ! ensureProgram(imgui_program)) {
+        return;
+    }
+
+    GLfloat projection[16];
+    glGetUniformfv(static_cast<GLuint>(imgui_program), glGetUniformLocation(static_cast<GLuint>(imgui_program), "ProjMtx"), projection);
+
+    glUseProgram(m_program);
+    glUniformMatrix4fv(m_projection_location, 1, GL_FALSE, projection);
+    glUniform1i(m_texture_location, 0);
+    glUniform1f(m_exposure_location, adjustments.exposure);
+    glUniform1f(m_level_location, adjustments.level);
+    glUniform1f(m_window_location, std::max(adjustments.window, 1e-6f));
+    glUniform1f(m_brightness_location, adjustments.brightness);
+    glUniform1f(m_contrast_location, adjustments.contrast);
+    glUniform1f(m_gamma_location, std::max(adjustments.gamma, 1e-3f));
+    glUniform1i(m_channel_location, static_cast<GLint>(adjustments.channel));
+    glUniform1i(m_invert_location, adjustments.invert ? 1 : 0);
+}
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <string>
+
+#include <imgui.h>
+
+// Channel of the image shown by the preview.
+enum class DisplayChannel: int32_t {
+    All = 0,
+    Red = 1,        // Single channels are shown as grayscale.
+    Green = 2,
+    Blue = 3,
+    Alpha = 4
+};
+
+/**
+ * @brief How pixel values are mapped to the display, applied in the order of the members.
+ *
+ * The defaults leave 8-bit images untouched. Level, window and exposure matter mostly for high bit
+ * depth (16-bit or HDR) images, whose values don't necessarily fill the displayable range.
+ */
+struct DisplayAdjustments {
+    float           exposure{ 0.0f };       // In stops.
+    float           level{ 0.5f };          // Center of the displayed value range.
+    float           window{ 1.0f };         // Width of the displayed value range.
+    float           brightness{ 0.0f };     // Offset added to the values.
+    float           contrast{ 1.0f };       // Scale of the values around mid gray.
+    float           gamma{ 1.0f };
+    DisplayChannel  channel{ DisplayChannel::All };
+    bool            invert{ false };
+
+    bool operator==(const DisplayAdjustments& other) const = default;
+};
+
+/**
+ * @brief Draws images through a fragment shader that applies DisplayAdjustments.
+ *
+ * Adjustments are applied on the GPU as the texture is sampled, so changing them doesn't touch the
+ * pixels and costs nothing beyond a regular frame. Draws between begin() and end() are made with this
+ * shader in place of the ImGui backend's one, through draw list callbacks, so it must be used with the
+ * OpenGL 3 backend and on the OpenGL thread.
+ */
+class DisplayAdjustmentRenderer {
+public:
+    explicit DisplayAdjustmentRenderer(const std::string& glsl_version);
+    ~DisplayAdjustmentRenderer();
+
+    // Forgets the adjustments of the draws of the previous frame. Call once per frame, before any begin().
+    void newFrame();
+
+    // Images added to the draw list until end() are drawn with the given adjustments.
+    void begin(ImDrawList* draw_list, const DisplayAdjustments& adjustments);
+    void end(ImDrawList* draw_list);
+
+    // Disable copying DisplayAdjustmentRenderer objects.
+    DisplayAdjustmentRenderer(const DisplayAdjustmentRenderer&) = delete;
+    DisplayAdjustmentRenderer& operator=(const DisplayAdjustmentRenderer&) = delete;
+
+private:
+    struct DrawParameters {
+        DisplayAdjustmentRenderer*  renderer;
+        DisplayAdjustments          adjustments;
+    };
+
+    static void onDraw(const ImDrawList* draw_list, const ImDrawCmd* command);
+
+    // Compiles the shader the first time it is needed, once the ImGui backend's own program exists.
+    bool ensureProgram(int32_t imgui_program);
+
+    void use(const DisplayAdjustments& adjustments);
+
+    std::string                     m_glsl_version;
+    uint32_t                        m_program{ 0 };
+    bool                            m_program_failed{ false };
+    int32_t                         m_projection_location{ -1 };
+    int32_t                         m_texture_location{ -1 };
+    int32_t                         m_exposure_location{ -1 };
+    int32_t                         m_level_location{ -1 };
+    int32_t                         m_window_location{ -1 };
+    int32_t                         m_brightness_location{ -1 };
+    int32_t                         m_contrast_location{ -1 };
+    int32_t                         m_gamma_location{ -1 };
+    int32_t                         m_channel_location{ -1 };
+    int32_t                         m_invert_location{ -1 };
+
+    // Referenced by the callbacks of the current frame's draw lists, so elements must not move.
+    std::deque<DrawParameters>      m_draw_parameters;
+};
@@ -1,14 +1,224 @@
+#include <algorithm>
 #include <stdexcept>
 #include "fileWatcher.h"
 
 
-Watcher::Watcher(const std::string& directory, Callback callback, bool recursive) {
+Watcher::Watcher(const std::string& directory, Callback callback, bool recursive, std::chrono::milliseconds batch_window, std::chrono::milliseconds max_batch_delay)
+    : m_callback(std::move(callback)), m_batch_window(batch_window), m_max_batch_delay(std::max(max_batch_delay, batch_window)) {
+    m_watch_id = WatcherService::instance().addWatch(directory, *this, recursive);
+}
+
+Watcher::~Watcher() {
+
+    // Actions still pending are dropped, whoever watched the directory is done with it.
+    WatcherService::instance().removeWatch(m_watch_id, *this);
+}
+
+Watcher::Statistics Watcher::getStatistics() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_statistics;
+}
+
+void Watcher::push(Event event) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto now = std::chrono::steady_clock::now();
+    if (m_pending_action_count == 0) {
+        m_first_action_time = now;
+    }
+    m_last_action_time = now;
+    m_pending_action_count++;
+    coalesce(std::move(event));
+}
+
+void Watcher::coalesce(Event event) {
+    using namespace efsw::Actions;
+
+    const std::string key = getKey(event.directory, event.filename);
+    auto append = [this, &key](Event event) {
+        m_pending_positions[key] = m_pending_events.size();
+        m_pending_events.push_back(std::move(event));
+    };
+
+    // A file renamed from a pending one merges with the pending event of the old name instead.
+    if (event.action == Moved && ! event.old_filename.empty()) {
+        auto it = m_pending_positions.find(getKey(event.directory, event.old_filename));
+        if (it == m_pending_positions.end()) {
+            append(std::move(event));
+            return;
+        }
+        const size_t position = it->second;
+        Event& pending = m_pending_events[position].value();
+        if (pending.action == Add) {
+
+            // Created then renamed: created under the new name.
+            pending.filename = event.filename;
+        } else if (pending.action == Modified) {
+            pending.action = Moved;
+            pending.old_filename = pending.filename;
+            pending.filename = event.filename;
+        } else if (pending.action == Moved) {
+
+            // Renamed back and forth: only the modification of the contents may remain.
+            pending.filename = event.filename;
+            if (pending.filename == pending.old_filename) {
+                pending.action = Modified;
+                pending.old_filename.clear();
+            }
+        } else {
+            append(std::move(event));
+            return;
+        }
+        m_pending_positions.erase(it);
+        m_pending_positions[key] = position;
+        return;
+    }
+
+    auto it = m_pending_positions.find(key);
+    if (it == m_pending_positions.end()) {
+        append(std::move(event));
+        return;
+    }
+    const size_t position = it->second;
+    Event& pending = m_pending_events[position].value();
+    switch (event.action) {
+        case Add:
+
+            // Deleted then created again: replaced.
+            if (pending.action == Delete) {
+                pending.action = Modified;
+                return;
+            }
+            break;
+        case Modified:
+            if (pending.action != Delete) {
+                return;
+            }
+            break;
+        case Delete:
+            if (pending.action == Add) {
+                m_pending_events[position] = std::nullopt;
+                m_pending_positions.erase(it);
+                return;
+            }
+            if (pending.action == Modified || pending.action == Delete) {
+                pending.action = Delete;
+                return;
+            }
+            if (pending.action == Moved) {
+
+                // Renamed then deleted: the file is gone under its original name.
+                pending.action = Delete;
+                pending.filename = pending.old_filename;
+                pending.old_filename.clear();
+                m_pending_positions.erase(it);
+                m_pending_positions[getKey(pending.directory, pending.filename)] = position;
+                return;
+            }
+            break;
+        default:
+            break;
+    }
+    append(std::move(event));
+}
+
+std::optional<std::chrono::steady_clock::time_point> Watcher::getDeadline() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_pending_action_count == 0) {
+        return std::nullopt;
+    }
+
+    // Wait for the actions to settle, but not indefinitely while they keep coming.
+    return std::min(m_last_action_time + m_batch_window, m_first_action_time + m_max_batch_delay);
+}
+
+Watcher::Batch Watcher::takeBatch() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    Batch batch;
+    batch.events.reserve(m_pending_events.size());
+    for (std::optional<Event>& event : m_pending_events) {
+        if (event) {
+            batch.events.push_back(std::move(event.value()));
+        }
+    }
+    batch.action_count = m_pending_action_count;
+    batch.first_action_time = m_first_action_time;
+    m_pending_events.clear();
+    m_pending_positions.clear();
+    m_pending_action_count = 0;
+    return batch;
+}
+
+void Watcher::deliver(const Batch& batch) {
+    if (m_callback && ! batch.events.empty()) {
+        m_callback(batch.events);
+    }
+
+    const double latency_milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - batch.first_action_time).count();
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_statistics.batch_count++;
+    m_statistics.action_count += batch.action_count;
+    m_statistics.event_count += batch.events.size();
+    m_statistics.last_action_count = batch.action_count;
+    m_statistics.last_event_count = batch.events.size();
+    m_statistics.last_latency_milliseconds = latency_milliseconds;
+    m_statistics.max_latency_milliseconds = std::max(m_statistics.max_latency_milliseconds, latency_milliseconds);
+}
+
+std::string Watcher::getKey(const std::string& directory, const std::string& filename) {
+    return directory + '\0' + filename;
+}
+
+WatcherService& WatcherService::instance() {
+    static WatcherService service;
+    return service;
+}
+
+WatcherService::WatcherService() {
+    m_file_watch_listener = std::make_unique<FileWatchListenerImpl>(*this);
     m_file_watcher = std::make_unique<efsw::FileWatcher>();
-    m_file_watch_listener = std::make_unique<FileWatchListenerImpl>(std::move(callback));
-    m_watch_id = m_file_watcher->addWatch(directory, m_file_watch_listener.get(), recursive);
-    
+    m_delivery_thread = std::thread(&WatcherService::deliverBatches, this);
+    m_file_watcher->watch();
+}
+
+WatcherService::~WatcherService() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+    }
+    m_condition.notify_all();
+    m_delivery_thread.join();
+}
+
+size_t WatcherService::getWatchCount() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_watch_ids.size();
+}
+
+size_t WatcherService::getWatcherCount() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    size_t count = 0;
+    for (const auto& [watch_id, watchers] : m_watchers) {
+        count += watchers.size();
+    }
+    return count;
+}
+
+efsw::WatchID WatcherService::addWatch(const std::string& directory, Watcher& watcher, bool recursive) {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto it = m_watch_ids.find(directory);
+        if (it != m_watch_ids.end()) {
+            m_watchers[it->second].push_back(&watcher);
+            return it->second;
+        }
+    }
+
+    // efsw is called without holding the lock, which its thread may be waiting on to route an action
+    // while holding efsw's own lock. Actions reported before the watcher is registered are dropped.
+    efsw::WatchID watch_id = m_file_watcher->addWatch(directory, m_file_watch_listener.get(), recursive);
+
     // error checking
-    switch (m_watch_id)
+    switch (watch_id)
     {
     case efsw::Errors::Error::FileNotFound:
     case efsw::Errors::Error::FileRepeated:
@@ -20,19 +230,83 @@ Watcher::Watcher(const std::string& directory, Callback callback, bool recursive
         throw std::runtime_error("couldn't watch directory: " + directory);
     }
 
-    m_file_watcher->watch();
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_watch_ids[directory] = watch_id;
+    m_watchers[watch_id].push_back(&watcher);
+    return watch_id;
+}
+
+void WatcherService::removeWatch(efsw::WatchID watch_id, Watcher& watcher) {
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_condition.wait(lock, [this, &watcher] { return m_delivering_watcher != &watcher; });
+
+        std::vector<Watcher*>& watchers = m_watchers[watch_id];
+        watchers.erase(std::remove(watchers.begin(), watchers.end(), &watcher), watchers.end());
+        if (! watchers.empty()) {
+            return;
+        }
+        m_watchers.erase(watch_id);
+        std::erase_if(m_watch_ids, [watch_id](const auto& entry) { return entry.second == watch_id; });
+    }
+    m_file_watcher->removeWatch(watch_id);
 }
 
-Watcher::~Watcher() {    
-    m_file_watcher->removeWatch(m_watch_id);
+void WatcherService::route(efsw::WatchID watch_id, const Watcher::Event& event) {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto it = m_watchers.find(watch_id);
+        if (it == m_watchers.end()) {
+            return;
+        }
+        for (Watcher* watcher : it->second) {
+            watcher->push(event);
+        }
+    }
+    m_condition.notify_all();
 }
 
-Watcher::FileWatchListenerImpl::FileWatchListenerImpl(Callback cb) : callback(std::move(cb)) {}
+void WatcherService::deliverBatches() {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (! m_stopping) {
 
-void Watcher::FileWatchListenerImpl::handleFileAction(efsw::WatchID watchid, const std::string& dir,
-                                                      const std::string& filename, efsw::Action action,
-                                                      std::string old_filename) {
-    if (callback) {
-        callback(dir, filename, action, old_filename);
+        // The watcher whose batch is due first.
+        std::optional<std::chrono::steady_clock::time_point> deadline;
+        Watcher* due_watcher = nullptr;
+        for (const auto& [watch_id, watchers] : m_watchers) {
+            for (Watcher* watcher : watchers) {
+                std::optional<std::chrono::steady_clock::time_point> watcher_deadline = watcher->getDeadline();
+                if (watcher_deadline && (! deadline || watcher_deadline.value() < deadline.value())) {
+                    deadline = watcher_deadline;
+                    due_watcher = watcher;
+                }
+            }
+        }
+        if (! deadline) {
+            m_condition.wait(lock);
+            continue;
+        }
+        if (std::chrono::steady_clock::now() < deadline.value()) {
+            m_condition.wait_until(lock, deadline.value());
+            continue;
+        }
+
+        // Delivered without the lock, so that actions keep being routed meanwhile. The watcher can't go
+        // away until the delivery is over.
+        Watcher::Batch batch = due_watcher->takeBatch();
+        m_delivering_watcher = due_watcher;
+        lock.unlock();
+        due_watcher->deliver(batch);
+        lock.lock();
+        m_delivering_watcher = nullptr;
+        m_condition.notify_all();
     }
 }
+
+WatcherService::FileWatchListenerImpl::FileWatchListenerImpl(WatcherService& service) : service(service) {}
+
+void WatcherService::FileWatchListenerImpl::handleFileAction(efsw::WatchID watchid, const std::string& dir,
+                                                             const std::string& filename, efsw::Action action,
+                                                             std::string old_filename) {
+    service.route(watchid, {dir, filename, action, std::move(old_filename)});
+}
@@ -1,32 +1,154 @@
 #pragma once
 
 #include <efsw/efsw.hpp>
+#include <chrono>
+#include <condition_variable>
 #include <functional>
 #include <memory>
+#include <mutex>
+#include <optional>
 #include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
 
 
+/**
+ * @brief Watches a directory, delivering its file actions in batches.
+ *
+ * Actions are collected until none has arrived for `batch_window` (or the oldest one has waited for
+ * `max_batch_delay`), then delivered together on the WatcherService thread. Within a batch, actions on
+ * the same file are coalesced into their net effect: repeated modifications are reported once, a file
+ * added then deleted isn't reported at all, a file renamed twice is reported as a single rename, and so
+ * on. Dropping thousands of files into the directory thus costs a handful of callbacks.
+ */
 class Watcher {
 public:
-    using Callback = std::function<void(const std::string&, const std::string&, efsw::Action, const std::string&)>;
+    struct Event {
+        std::string     directory;
+        std::string     filename;
+        efsw::Action    action;
+        std::string     old_filename;       // Only for efsw::Actions::Moved.
+    };
+
+    // Counters of the batches delivered so far.
+    struct Statistics {
+        size_t      batch_count{ 0 };
+        size_t      action_count{ 0 };              // Actions reported by efsw.
+        size_t      event_count{ 0 };               // Events delivered, after coalescing.
+        size_t      last_action_count{ 0 };
+        size_t      last_event_count{ 0 };
+        double      last_latency_milliseconds{ 0.0 };   // From the first action of the batch to its delivery.
+        double      max_latency_milliseconds{ 0.0 };
+    };
+
+    using Callback = std::function<void(const std::vector<Event>&)>;
 
-    Watcher(const std::string& directory, Callback callback, bool recursive = false);
+    Watcher(
+        const std::string& directory,
+        Callback callback,
+        bool recursive = false,
+        std::chrono::milliseconds batch_window = std::chrono::milliseconds(50),
+        std::chrono::milliseconds max_batch_delay = std::chrono::milliseconds(500)
+    );
+
+    // Waits for a batch being delivered to this watcher. Must not be called from its own callback.
     ~Watcher();
 
+    Statistics getStatistics() const;
+
+    // Disable copying Watcher objects, the service routes actions to their address.
+    Watcher(const Watcher&) = delete;
+    Watcher& operator=(const Watcher&) = delete;
+
 private:
+    friend class WatcherService;
+
+    // A batch taken out of the pending actions, to be delivered.
+    struct Batch {
+        std::vector<Event>                          events;
+        size_t                                      action_count{ 0 };
+        std::chrono::steady_clock::time_point       first_action_time;
+    };
+
+    // Adds an action to the pending batch, merging it with the pending event of the same file if there is one.
+    void push(Event event);
+    void coalesce(Event event);
+
+    // When the pending batch is due, if there is one.
+    std::optional<std::chrono::steady_clock::time_point> getDeadline() const;
+
+    Batch takeBatch();
+    void deliver(const Batch& batch);
+
+    static std::string getKey(const std::string& directory, const std::string& filename);
+
+    Callback                                        m_callback;
+    std::chrono::milliseconds                       m_batch_window;
+    std::chrono::milliseconds                       m_max_batch_delay;
+
+    mutable std::mutex                              m_mutex;
+    std::vector<std::optional<Event>>               m_pending_events;       // Coalesced away events are left empty.
+    std::unordered_map<std::string, size_t>         m_pending_positions;    // Latest pending event of each file.
+    size_t                                          m_pending_action_count{ 0 };
+    std::chrono::steady_clock::time_point           m_first_action_time;
+    std::chrono::steady_clock::time_point           m_last_action_time;
+    Statistics                                      m_statistics;
+
+    efsw::WatchID                                   m_watch_id;
+};
+
+/**
+ * @brief Multiplexes every Watcher of the process onto a single efsw::FileWatcher, so that watching
+ * more directories costs a watch each rather than a watcher thread (and inotify instance) each.
+ * Actions are routed to the watchers of their watch, and batches are delivered on a single thread.
+ * Watchers of the same directory share its watch (with the recursion of the first one).
+ */
+class WatcherService {
+public:
+    // The service shared by all watchers.
+    static WatcherService& instance();
+
+    ~WatcherService();
+
+    // Number of directories watched, respectively of watchers of them.
+    size_t getWatchCount() const;
+    size_t getWatcherCount() const;
+
+private:
+    friend class Watcher;
+
     class FileWatchListenerImpl : public efsw::FileWatchListener {
     public:
-        explicit FileWatchListenerImpl(Callback cb);
+        explicit FileWatchListenerImpl(WatcherService& service);
 
         void handleFileAction(efsw::WatchID watchid, const std::string& dir,
                               const std::string& filename, efsw::Action action,
                               std::string old_filename) override;
 
     private:
-        Callback callback;
+        WatcherService& service;
     };
 
-    std::unique_ptr<efsw::FileWatcher> m_file_watcher;
-    std::unique_ptr<FileWatchListenerImpl> m_file_watch_listener;
-    efsw::WatchID m_watch_id;
+    WatcherService();
+
+    // Throws std::runtime_error if the directory can't be watched.
+    efsw::WatchID addWatch(const std::string& directory, Watcher& watcher, bool recursive);
+
+    // Returns once no action is being routed to the watcher, nor any batch delivered to it.
+    void removeWatch(efsw::WatchID watch_id, Watcher& watcher);
+
+    void route(efsw::WatchID watch_id, const Watcher::Event& event);
+    void deliverBatches();
+
+    mutable std::mutex                                          m_mutex;
+    std::condition_variable                                     m_condition;
+    std::unordered_map<efsw::WatchID, std::vector<Watcher*>>    m_watchers;
+    std::unordered_map<std::string, efsw::WatchID>              m_watch_ids;            // By directory.
+    Watcher*                                                    m_delivering_watcher{ nullptr };
+    bool                                                        m_stopping{ false };
+    std::thread                                                 m_delivery_thread;
+
+    std::unique_ptr<FileWatchListenerImpl>                      m_file_watch_listener;
+    std::unique_ptr<efsw::FileWatcher>                          m_file_watcher;
 };
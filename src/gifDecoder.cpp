@@ -0,0 +1,40 @@
+#include <stdexcept>
+#include "gifDecoder.h"
+
+GifDecoder::GifDecoder(const std::string& filepath)
+    : m_filepath(filepath), m_file(filepath) {
+
+    // stb_image's lengths are ints.
+    if (m_file.getSize() > static_cast<size_t>(INT32_MAX)) {
+        throw std::runtime_error("error: GIF file is too large: " + filepath);
+    }
+    rewind();
+}
+
+GifDecoder::~GifDecoder() {
+    gifStreamClose(m_stream);
+}
+
+int32_t GifDecoder::getWidth() const {
+    return m_width;
+}
+
+int32_t GifDecoder::getHeight() const {
+    return m_height;
+}
+
+bool GifDecoder::next(const uint8_t*& pixels, int32_t& delay_milliseconds) {
+    int32_t status = gifStreamNextFrame(m_stream, &pixels, &delay_milliseconds);
+    if (status < 0) {
+        throw std::runtime_error("error: couldn't decode GIF frame: " + m_filepath);
+    }
+    return status > 0;
+}
+
+void GifDecoder::rewind() {
+    gifStreamClose(m_stream);
+    m_stream = gifStreamOpen(m_file.getData(), static_cast<int32_t>(m_file.getSize()), &m_width, &m_height);
+    if (! m_stream) {
+        throw std::runtime_error("error: couldn't load image: " + m_filepath);
+    }
+}
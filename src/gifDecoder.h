@@ -0,0 +1,56 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+#include "mappedFile.h"
+
+// Incremental GIF decoding hooks, implemented on top of stb_image's GIF loader (see vendors/stb/stb_image.cpp).
+struct GifStream;
+GifStream* gifStreamOpen(const uint8_t* data, int32_t size, int32_t* width, int32_t* height);
+int32_t gifStreamNextFrame(GifStream* stream, const uint8_t** pixels, int32_t* delay_milliseconds);
+void gifStreamClose(GifStream* stream);
+
+/**
+ * @brief Decodes the frames of a (possibly animated) GIF one at a time, straight from the mapped file.
+ *
+ * Unlike stbi_load_gif_from_memory(), which decodes every frame into one buffer, only the frame being
+ * composed and the two before it (for "restore to previous" disposal) are held in memory, whatever
+ * the number of frames.
+ */
+class GifDecoder {
+public:
+
+    /**
+     * @throws std::runtime_error if the file can't be read or isn't a GIF.
+     */
+    explicit GifDecoder(const std::string& filepath);
+    ~GifDecoder();
+
+    int32_t getWidth() const;
+    int32_t getHeight() const;
+
+    /**
+     * @brief Decodes the next frame.
+     *
+     * @param pixels Set to the RGBA pixels of the frame (getWidth() x getHeight()), valid until the next call.
+     * @param delay_milliseconds Set to how long the frame is to be shown.
+     * @return `false` once every frame has been decoded.
+     * @throws std::runtime_error if the file is corrupt.
+     */
+    bool next(const uint8_t*& pixels, int32_t& delay_milliseconds);
+
+    // Starts over from the first frame.
+    void rewind();
+
+    // Disable copying GifDecoder objects.
+    GifDecoder(const GifDecoder&) = delete;
+    GifDecoder& operator=(const GifDecoder&) = delete;
+
+private:
+    std::string     m_filepath;
+    MappedFile      m_file;
+    GifStream*      m_stream{ nullptr };
+    int32_t         m_width{ 0 };
+    int32_t         m_height{ 0 };
+};
@@ -1,25 +1,222 @@
+#include <algorithm>
+#include <cstdlib>
+#include <filesystem>
 #include "image.h"
+#include "jpegDecoder.h"
+#include "mappedFile.h"
+#include "pixelArena.h"
+#include "resample.h"
+#include "texturePool.h"
 
-Image::Image(ImTextureID gpu_texture, int32_t width, int32_t height)
-    : m_gpu_texture(gpu_texture), m_width(width), m_height(height) {}
+ImageData::ImageData(uint8_t* pixels, int32_t width, int32_t height, int32_t channels, PixelType pixel_type, int32_t source_width, int32_t source_height)
+    : m_pixels(pixels), m_width(width), m_height(height), m_channels(channels), m_pixel_type(pixel_type), m_source_width(source_width), m_source_height(source_height) {}
 
-uint32_t Image::createTexture(uint8_t* data, int32_t width, int32_t height) {
-    uint32_t texture;
-    glGenTextures(1, &texture);
-    glBindTexture(GL_TEXTURE_2D, texture);
+const uint8_t* ImageData::getPixels() const {
+    return m_pixels;
+}
+
+int32_t ImageData::getWidth() const {
+    return m_width;
+}
+
+int32_t ImageData::getHeight() const {
+    return m_height;
+}
+
+int32_t ImageData::getChannelCount() const {
+    return m_channels;
+}
+
+PixelType ImageData::getPixelType() const {
+    return m_pixel_type;
+}
+
+size_t ImageData::getSizeInBytes() const {
+    return static_cast<size_t>(m_width) * static_cast<size_t>(m_height) * static_cast<size_t>(m_channels) * getBytesPerChannel(m_pixel_type);
+}
+
+int32_t ImageData::getSourceWidth() const {
+    return m_source_width;
+}
+
+int32_t ImageData::getSourceHeight() const {
+    return m_source_height;
+}
+
+bool ImageData::isDownscaled() const {
+    return m_width != m_source_width || m_height != m_source_height;
+}
+
+ImageData ImageData::decodeFromFile(const std::string& filepath, const ImageDecodeOptions& options) {
+    int32_t fitted_width;
+    int32_t fitted_height;
+
+    // A thumbnail that already covers the requested size spares decoding the image at all.
+    if (options.allow_embedded_thumbnail) {
+        std::optional<ImageData> thumbnail = decodeEmbeddedThumbnail(filepath, options.channels);
+        if (thumbnail) {
+            fitWithin(thumbnail->m_source_width, thumbnail->m_source_height, options.max_width, options.max_height, fitted_width, fitted_height);
+            if (thumbnail->m_width >= fitted_width && thumbnail->m_height >= fitted_height) {
+                return downscale(std::move(thumbnail.value()), fitted_width, fitted_height, filepath);
+            }
+        }
+    }
+
+    std::optional<DecodedJPEG> jpeg = decodeJPEGScaled(filepath, options.max_width, options.max_height, options.channels);
+    if (jpeg) {
+        fitWithin(jpeg->source_width, jpeg->source_height, options.max_width, options.max_height, fitted_width, fitted_height);
+        ImageData data(jpeg->pixels, jpeg->width, jpeg->height, jpeg->channels, PixelType::UInt8, jpeg->source_width, jpeg->source_height);
+        return downscale(std::move(data), fitted_width, fitted_height, filepath);
+    }
+
+    int32_t width;
+    int32_t height;
+    int32_t channels;
+    PixelType pixel_type = PixelType::UInt8;
+
+    // Decoded from the file read in whole (stb_image's length is an int, so huge files are read by stb_image itself).
+    // Unless asked otherwise the file's own channel count is kept, so that e.g. grayscale images take a quarter of the memory.
+    uint8_t* pixels = nullptr;
+    std::error_code ec;
+    const uintmax_t file_size = std::filesystem::file_size(filepath, ec);
+    try {
+        if (! ec && file_size <= static_cast<uintmax_t>(INT32_MAX)) {
+            FileContents file(filepath);
+            const int size = static_cast<int>(std::min<size_t>(file.getSize(), INT32_MAX));
+            if (options.high_bit_depth && stbi_is_16_bit_from_memory(file.getData(), size)) {
+                pixels = reinterpret_cast<uint8_t*>(stbi_load_16_from_memory(file.getData(), size, &width, &height, &channels, options.channels));
+                pixel_type = PixelType::UInt16;
+            } else if (options.high_bit_depth && stbi_is_hdr_from_memory(file.getData(), size)) {
+                pixels = reinterpret_cast<uint8_t*>(stbi_loadf_from_memory(file.getData(), size, &width, &height, &channels, options.channels));
+                pixel_type = PixelType::Float32;
+            } else {
+                pixels = stbi_load_from_memory(file.getData(), size, &width, &height, &channels, options.channels);
+            }
+        } else {
+            pixels = stbi_load(filepath.c_str(), &width, &height, &channels, options.channels);
+        }
+    } catch (const std::runtime_error&) {
+        pixels = nullptr;
+    }
+    if (! pixels) {
+        throw std::runtime_error("error: couldn't load image: " + filepath);
+    }
+
+    if (options.channels) {
+        channels = options.channels;
+    }
+
+    fitWithin(width, height, options.max_width, options.max_height, fitted_width, fitted_height);
+    return downscale(ImageData(pixels, width, height, channels, pixel_type, width, height), fitted_width, fitted_height, filepath);
+}
+
+std::optional<ImageData> ImageData::decodeEmbeddedThumbnail(const std::string& filepath, int32_t channels) {
+    std::optional<DecodedJPEG> thumbnail = decodeEXIFThumbnail(filepath, channels);
+    if (! thumbnail) {
+        return std::nullopt;
+    }
+    return ImageData(thumbnail->pixels, thumbnail->width, thumbnail->height, thumbnail->channels, PixelType::UInt8, thumbnail->source_width, thumbnail->source_height);
+}
+
+ImageData ImageData::downscale(ImageData data, int32_t width, int32_t height, const std::string& filepath) {
+    if (width >= data.m_width && height >= data.m_height) {
+        return data;
+    }
+
+    // Allocated from the pixel arena so that it can be released with stbi_image_free() like decoded pixels.
+    const size_t size = static_cast<size_t>(width) * height * data.m_channels * getBytesPerChannel(data.m_pixel_type);
+    uint8_t* downscaled_pixels = static_cast<uint8_t*>(PixelArena::instance().allocate(size));
+    if (! downscaled_pixels) {
+        throw std::runtime_error("error: couldn't allocate memory to downscale image: " + filepath);
+    }
 
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    switch (data.m_pixel_type) {
+        case PixelType::UInt8:
+            downscaleArea(data.m_pixels, data.m_width, data.m_height, downscaled_pixels, width, height, data.m_channels);
+            break;
+        case PixelType::UInt16:
+            downscaleArea(
+                reinterpret_cast<const uint16_t*>(data.m_pixels), data.m_width, data.m_height,
+                reinterpret_cast<uint16_t*>(downscaled_pixels), width, height, data.m_channels
+            );
+            break;
+        case PixelType::Float32:
+            downscaleArea(
+                reinterpret_cast<const float*>(data.m_pixels), data.m_width, data.m_height,
+                reinterpret_cast<float*>(downscaled_pixels), width, height, data.m_channels
+            );
+            break;
+    }
+
+    return ImageData(downscaled_pixels, width, height, data.m_channels, data.m_pixel_type, data.m_source_width, data.m_source_height);
+}
+
+ImageData::~ImageData() {
+    if (m_pixels) {
+        stbi_image_free(m_pixels);
+        m_pixels = nullptr;
+    }
+}
+
+ImageData::ImageData(ImageData&& other) noexcept
+    : m_pixels(other.m_pixels), m_width(other.m_width), m_height(other.m_height), m_channels(other.m_channels), m_pixel_type(other.m_pixel_type),
+      m_source_width(other.m_source_width), m_source_height(other.m_source_height) {
+    other.m_pixels = nullptr;
+    other.m_width = 0;
+    other.m_height = 0;
+    other.m_channels = 0;
+    other.m_source_width = 0;
+    other.m_source_height = 0;
+}
+
+ImageData& ImageData::operator=(ImageData&& other) noexcept {
+    if (this != &other) {
+        if (m_pixels) {
+            stbi_image_free(m_pixels);
+        }
+
+        m_pixels = other.m_pixels;
+        m_width = other.m_width;
+        m_height = other.m_height;
+        m_channels = other.m_channels;
+        m_pixel_type = other.m_pixel_type;
+        m_source_width = other.m_source_width;
+        m_source_height = other.m_source_height;
+
+        other.m_pixels = nullptr;
+        other.m_width = 0;
+        other.m_height = 0;
+        other.m_channels = 0;
+        other.m_source_width = 0;
+        other.m_source_height = 0;
+    }
+    return *this;
+}
+
+Image::Image(ImTextureID gpu_texture, int32_t width, int32_t height, int32_t channels, PixelType pixel_type, int32_t source_width, int32_t source_height)
+    : m_gpu_texture(gpu_texture), m_width(width), m_height(height), m_channels(channels), m_pixel_type(pixel_type), m_source_width(source_width), m_source_height(source_height) {}
 
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, data);
-    glGenerateMipmap(GL_TEXTURE_2D);
+uint32_t Image::createTexture(const uint8_t* data, int32_t width, int32_t height, int32_t channels, PixelType pixel_type) {
+    uint32_t texture = allocateTexture(width, height, channels, pixel_type);
+    glBindTexture(GL_TEXTURE_2D, texture);
+
+    // Rows of 1 to 3 channel pixels aren't necessarily 4-byte aligned.
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, width, height, TexturePool::getPixelFormat(channels), TexturePool::getPixelDataType(pixel_type), data);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
     glBindTexture(GL_TEXTURE_2D, 0);
     
     return texture;
 }
 
+uint32_t Image::allocateTexture(int32_t width, int32_t height, int32_t channels, PixelType pixel_type) {
+    return TexturePool::instance().acquire(width, height, channels, pixel_type);
+}
+
+void Image::releaseTexture(uint32_t texture, int32_t width, int32_t height, int32_t channels, PixelType pixel_type) {
+    TexturePool::instance().release(texture, width, height, channels, pixel_type);
+}
+
 const ImTextureID& Image::getTexture() const {
     return m_gpu_texture;
 }
@@ -32,56 +229,89 @@ int32_t Image::getHeight() const {
     return m_height;
 }
 
-Image Image::loadFromFile(const std::string& filepath) {
-    int32_t width;
-    int32_t height;
-    int32_t channels;
+int32_t Image::getChannelCount() const {
+    return m_channels;
+}
 
-    uint8_t* data = stbi_load(filepath.c_str(), &width, &height, &channels, 4);
-    if (data) {
-        uint32_t texture = createTexture(data, width, height);
-        stbi_image_free(data);
-        return Image(
-            reinterpret_cast<ImTextureID>(static_cast<uintptr_t>(texture)),
-            width,
-            height
-        );
-    }
+PixelType Image::getPixelType() const {
+    return m_pixel_type;
+}
+
+int32_t Image::getSourceWidth() const {
+    return m_source_width;
+}
+
+int32_t Image::getSourceHeight() const {
+    return m_source_height;
+}
+
+bool Image::isDownscaled() const {
+    return m_width != m_source_width || m_height != m_source_height;
+}
+
+size_t Image::getSizeInBytes() const {
+    return TexturePool::estimateSizeInBytes(m_width, m_height, m_channels, m_pixel_type);
+}
+
+Image Image::loadFromFile(const std::string& filepath, const ImageDecodeOptions& options) {
+    return loadFromData(ImageData::decodeFromFile(filepath, options));
+}
 
-    throw std::runtime_error("error: couldn't load image: " + filepath);
+Image Image::loadFromData(const ImageData& data) {
+    uint32_t texture = createTexture(data.getPixels(), data.getWidth(), data.getHeight(), data.getChannelCount(), data.getPixelType());
+    return Image(
+        reinterpret_cast<ImTextureID>(static_cast<uintptr_t>(texture)),
+        data.getWidth(),
+        data.getHeight(),
+        data.getChannelCount(),
+        data.getPixelType(),
+        data.getSourceWidth(),
+        data.getSourceHeight()
+    );
 }
 
 Image::~Image() {
 
-    // Clean up OpenGL texture.
+    // Hand the OpenGL texture back to the pool for reuse.
     if (m_gpu_texture) {
         uint32_t texture = static_cast<uint32_t>(reinterpret_cast<intptr_t>(m_gpu_texture));
-        glDeleteTextures(1, &texture);
+        releaseTexture(texture, m_width, m_height, m_channels, m_pixel_type);
         m_gpu_texture = 0;
     }
 }
 
 Image::Image(Image&& other) noexcept
-    : m_gpu_texture(other.m_gpu_texture), m_width(other.m_width), m_height(other.m_height) {
+    : m_gpu_texture(other.m_gpu_texture), m_width(other.m_width), m_height(other.m_height), m_channels(other.m_channels), m_pixel_type(other.m_pixel_type),
+      m_source_width(other.m_source_width), m_source_height(other.m_source_height) {
     other.m_gpu_texture = 0;
     other.m_width = 0;
     other.m_height = 0;
+    other.m_channels = 0;
+    other.m_source_width = 0;
+    other.m_source_height = 0;
 }
 
 Image& Image::operator=(Image&& other) noexcept {
     if (this != &other) {
         if (m_gpu_texture) {
             uint32_t texture = static_cast<uint32_t>(reinterpret_cast<intptr_t>(m_gpu_texture));
-            glDeleteTextures(1, &texture);
+            releaseTexture(texture, m_width, m_height, m_channels, m_pixel_type);
         }
 
         m_gpu_texture = other.m_gpu_texture;
         m_width = other.m_width;
         m_height = other.m_height;
+        m_channels = other.m_channels;
+        m_pixel_type = other.m_pixel_type;
+        m_source_width = other.m_source_width;
+        m_source_height = other.m_source_height;
 
         other.m_gpu_texture = 0;
         other.m_width = 0;
         other.m_height = 0;
+        other.m_channels = 0;
+        other.m_source_width = 0;
+        other.m_source_height = 0;
     }
     return *this;
 }
@@ -3,28 +3,133 @@
 #include <glad/glad.h>
 #include <stb_image.h>
 #include <imgui.h>
+#include <optional>
 #include <string>
 #include <stdexcept>
 
+#include "pixelType.h"
+
+struct ImageDecodeOptions {
+
+    // Images larger than this are downscaled (preserving the aspect ratio) right after decoding.
+    // Zero means that dimension is unbounded.
+    int32_t max_width{ 0 };
+    int32_t max_height{ 0 };
+
+    // Whether a JPEG's embedded EXIF thumbnail may be used when it is at least as large as the requested size.
+    bool allow_embedded_thumbnail{ false };
+
+    // Number of channels to decode into (1 to 4). Zero keeps the file's own: gray, gray + alpha, RGB or RGBA.
+    int32_t channels{ 0 };
+
+    // Whether 16-bit and HDR files keep their full precision (UInt16 / Float32 pixels) instead of being reduced to 8 bits.
+    bool high_bit_depth{ false };
+};
+
+/**
+ * @brief Decoded pixels (1 to 4 interleaved 8-bit, 16-bit or floating point channels) held in CPU memory.
+ *
+ * Decoding is safe to do on any thread. Turning the pixels into an Image (a GPU texture) must
+ * happen on the thread that owns the OpenGL context.
+ */
+class ImageData {
+private:
+    uint8_t*        m_pixels;
+    int32_t         m_width;
+    int32_t         m_height;
+    int32_t         m_channels;
+    PixelType       m_pixel_type;
+    int32_t         m_source_width;
+    int32_t         m_source_height;
+
+    // Private constructor to ensure objects are created through decodeFromFile().
+    ImageData(uint8_t* pixels, int32_t width, int32_t height, int32_t channels, PixelType pixel_type, int32_t source_width, int32_t source_height);
+
+    // Function to downscale the pixels to exactly the given size (if they are larger).
+    static ImageData downscale(ImageData data, int32_t width, int32_t height, const std::string& filepath);
+
+public:
+    // Raw pixel bytes, to be interpreted according to getPixelType().
+    const uint8_t* getPixels() const;
+    int32_t getWidth() const;
+    int32_t getHeight() const;
+    int32_t getChannelCount() const;
+    PixelType getPixelType() const;
+    size_t getSizeInBytes() const;
+
+    // Dimensions of the image file, which differ from getWidth()/getHeight() if it was downscaled.
+    int32_t getSourceWidth() const;
+    int32_t getSourceHeight() const;
+    bool isDownscaled() const;
+
+    /**
+     * @brief Static method to decode image from file (without touching OpenGL).
+     *
+     * JPEGs are decoded in the DCT domain at the smallest scale that covers the requested size (when
+     * built with libjpeg-turbo), every other format (or JPEG otherwise) is decoded by stb_image.
+     */
+    static ImageData decodeFromFile(const std::string& filepath, const ImageDecodeOptions& options = {});
+
+    // Static method to decode the small thumbnail embedded in a JPEG file's EXIF metadata, if any.
+    static std::optional<ImageData> decodeEmbeddedThumbnail(const std::string& filepath, int32_t channels = 0);
+
+    ~ImageData();
+
+    // Disable copying ImageData objects.
+    ImageData(const ImageData&) = delete;
+    ImageData& operator=(const ImageData&) = delete;
+
+    // Enable move semantics.
+    ImageData(ImageData&& other) noexcept;
+    ImageData& operator=(ImageData&& other) noexcept;
+};
+
 class Image {
 private:
     ImTextureID     m_gpu_texture;
     int32_t         m_width;
     int32_t         m_height;
+    int32_t         m_channels;
+    PixelType       m_pixel_type;
+    int32_t         m_source_width;
+    int32_t         m_source_height;
 
-    // Private constructor to ensure objects are created through loadFromFile().
-    Image(ImTextureID gpu_texture, int32_t width, int32_t height);
+    // Private constructor to ensure objects are created through loadFromFile() (or a TextureUpload).
+    Image(ImTextureID gpu_texture, int32_t width, int32_t height, int32_t channels, PixelType pixel_type, int32_t source_width, int32_t source_height);
 
     // Function to create OpenGL texture from image data.
-    static uint32_t createTexture(uint8_t* data, int32_t width, int32_t height);
+    static uint32_t createTexture(const uint8_t* data, int32_t width, int32_t height, int32_t channels, PixelType pixel_type);
+
+    // Function to obtain an OpenGL texture (from the texture pool) whose storage is to be filled in.
+    static uint32_t allocateTexture(int32_t width, int32_t height, int32_t channels, PixelType pixel_type);
+
+    // Function to hand an OpenGL texture back to the texture pool.
+    static void releaseTexture(uint32_t texture, int32_t width, int32_t height, int32_t channels, PixelType pixel_type);
+
+    friend class TextureUpload;
 
 public:
     const ImTextureID& getTexture() const;
     int32_t getWidth() const;
     int32_t getHeight() const;
+    int32_t getChannelCount() const;
+
+    // High bit depth images need window/level or exposure (see DisplayAdjustments) to be displayed meaningfully.
+    PixelType getPixelType() const;
+
+    // Dimensions of the image file, which differ from getWidth()/getHeight() if it was downscaled.
+    int32_t getSourceWidth() const;
+    int32_t getSourceHeight() const;
+    bool isDownscaled() const;
+
+    // Estimated GPU memory used by the texture.
+    size_t getSizeInBytes() const;
 
     // Static method to load image from file.
-    static Image loadFromFile(const std::string& filepath);
+    static Image loadFromFile(const std::string& filepath, const ImageDecodeOptions& options = {});
+
+    // Static method to upload already decoded pixels. Must be called on the OpenGL thread.
+    static Image loadFromData(const ImageData& data);
 
     ~Image();
 
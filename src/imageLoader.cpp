@@ -0,0 +1,129 @@
+#include <iostream>
+#include "imageLoader.h"
+#include "constants.h"
+#include "util.h"
+
+ImageLoader::ImageLoader(ThreadPool& thread_pool)
+    : m_thread_pool(thread_pool) {}
+
+void ImageLoader::request(const std::string& filepath, const ImageDecodeOptions& options, bool embedded_thumbnail_first) {
+    cancel();
+
+    auto cancelled = std::make_shared<std::atomic<bool>>(false);
+    std::future<std::optional<ImageData>> future = m_thread_pool.submit(
+        [filepath, options, cancelled]() -> std::optional<ImageData> {
+
+            // The labeler may have moved on while this request was waiting in the queue.
+            if (cancelled->load()) {
+                return std::nullopt;
+            }
+            return ImageData::decodeFromFile(filepath, options);
+        },
+        true
+    );
+
+    m_request = Request{filepath, cancelled, std::move(future), std::nullopt};
+
+    // Submitted last (and with high priority) so that it overtakes the full decode.
+    if (embedded_thumbnail_first) {
+        m_request->thumbnail_future = m_thread_pool.submit(
+            [filepath, cancelled]() -> std::optional<ImageData> {
+                if (cancelled->load()) {
+                    return std::nullopt;
+                }
+                return ImageData::decodeEmbeddedThumbnail(filepath);
+            },
+            true
+        );
+    }
+}
+
+void ImageLoader::upload(ImageData data) {
+    cancel();
+
+    // The ring is created lazily since the OpenGL context doesn't exist yet at construction time.
+    if (! m_unpack_ring) {
+        m_unpack_ring = std::make_unique<PixelUnpackRing>(TEXTURE_UPLOAD_RING_SIZE);
+    }
+    m_upload = std::make_unique<TextureUpload>(std::move(data), m_upload_mode, *m_unpack_ring);
+}
+
+void ImageLoader::adopt(const std::string& filepath, std::future<std::optional<ImageData>> future, std::shared_ptr<std::atomic<bool>> cancelled) {
+    cancel();
+    m_request = Request{filepath, std::move(cancelled), std::move(future), std::nullopt};
+}
+
+void ImageLoader::cancel() {
+    if (m_request) {
+        m_request->cancelled->store(true);
+        m_request = std::nullopt;
+    }
+    m_upload = nullptr;
+}
+
+bool ImageLoader::isPending() const {
+    return m_request.has_value() || m_upload;
+}
+
+std::optional<Image> ImageLoader::poll() {
+    if (m_request && isFutureReady(m_request->future)) {
+
+        // Take ownership of the request before get() so that a decoding error doesn't leave it pending.
+        Request request = std::move(m_request.value());
+        m_request = std::nullopt;
+
+        std::optional<ImageData> data = request.future.get();
+        if (data) {
+            upload(std::move(data.value()));
+        }
+    } else if (m_request && m_request->thumbnail_future && isFutureReady(m_request->thumbnail_future.value())) {
+
+        // The thumbnail is tiny, so it is uploaded right away rather than streamed.
+        std::optional<ImageData> thumbnail = m_request->thumbnail_future->get();
+        m_request->thumbnail_future = std::nullopt;
+        if (thumbnail) {
+            return Image::loadFromData(thumbnail.value());
+        }
+    }
+
+    if (! m_upload || ! m_upload->step(TEXTURE_UPLOAD_BYTES_PER_FRAME)) {
+        return std::nullopt;
+    }
+
+    m_last_upload_stats = m_upload->getStats();
+    if (m_upload_logging) {
+        const TextureUploadStats& stats = m_last_upload_stats.value();
+        std::cout << "texture upload: "
+                  << (stats.mode == TextureUploadMode::Streamed ? "streamed" : "synchronous") << ", "
+                  << stats.width << "x" << stats.height << ", "
+                  << stats.bytes << " bytes, "
+                  << stats.frames << " frame(s), "
+                  << stats.total_milliseconds << " ms total, "
+                  << stats.max_step_milliseconds << " ms max per frame" << std::endl;
+    }
+
+    Image image = m_upload->finish();
+    m_upload = nullptr;
+    return image;
+}
+
+void ImageLoader::setUploadMode(TextureUploadMode mode) {
+    m_upload_mode = mode;
+}
+
+TextureUploadMode ImageLoader::getUploadMode() const {
+    return m_upload_mode;
+}
+
+const std::optional<TextureUploadStats>& ImageLoader::getLastUploadStats() const {
+    return m_last_upload_stats;
+}
+
+void ImageLoader::setUploadLogging(bool enabled) {
+    m_upload_logging = enabled;
+}
+
+void ImageLoader::releaseGPUResources() {
+    cancel();
+    m_unpack_ring = nullptr;
+}
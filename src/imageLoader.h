@@ -0,0 +1,83 @@
+#pragma once
+
+#include <atomic>
+#include <future>
+#include <memory>
+#include <optional>
+#include <string>
+
+#include "image.h"
+#include "textureUpload.h"
+#include "threadPool.h"
+
+/**
+ * @brief Decodes images on worker threads and uploads them on the render thread.
+ *
+ * Only the most recent request is of interest: issuing a new request cancels the previous one.
+ * A cancelled request that has not started decoding yet is skipped by the worker, and the result
+ * of one that has already started is discarded.
+ *
+ * Uploads either happen within a single poll() (synchronous mode) or are streamed through pixel
+ * unpack buffers in slices over several polls, so that large textures don't cause a frame-time spike.
+ */
+class ImageLoader {
+public:
+    explicit ImageLoader(ThreadPool& thread_pool);
+
+    /**
+     * @brief Requests asynchronous decoding of the image at the given path.
+     *
+     * @param embedded_thumbnail_first Whether to first provide the thumbnail embedded in the file (if
+     * any) while the image itself is being decoded.
+     */
+    void request(const std::string& filepath, const ImageDecodeOptions& options = {}, bool embedded_thumbnail_first = false);
+
+    // Requests uploading of already decoded pixels (e.g. prefetched ones).
+    void upload(ImageData data);
+
+    // Takes over a decode of the image already running elsewhere (e.g. a prefetch), as if it had been requested.
+    void adopt(const std::string& filepath, std::future<std::optional<ImageData>> future, std::shared_ptr<std::atomic<bool>> cancelled);
+
+    // Cancels the pending request (if any).
+    void cancel();
+
+    bool isPending() const;
+
+    /**
+     * @brief Must be called on the OpenGL thread (typically once per frame).
+     *
+     * @return The requested image once it has been decoded and uploaded, `std::nullopt` otherwise. An
+     * image returned while isPending() is still `true` is the provisional embedded thumbnail.
+     * @throws std::runtime_error if the requested image couldn't be decoded.
+     */
+    std::optional<Image> poll();
+
+    void setUploadMode(TextureUploadMode mode);
+    TextureUploadMode getUploadMode() const;
+
+    // Timing of the most recently completed upload.
+    const std::optional<TextureUploadStats>& getLastUploadStats() const;
+
+    // Logs the timing of every completed upload to the standard output.
+    void setUploadLogging(bool enabled);
+
+    // Releases OpenGL objects. Must be called on the OpenGL thread before the context is destroyed.
+    void releaseGPUResources();
+
+private:
+    struct Request {
+        std::string                                             filepath;
+        std::shared_ptr<std::atomic<bool>>                      cancelled;
+        std::future<std::optional<ImageData>>                   future;
+        std::optional<std::future<std::optional<ImageData>>>    thumbnail_future;
+    };
+
+    ThreadPool&                                 m_thread_pool;
+    std::optional<Request>                      m_request;
+
+    TextureUploadMode                           m_upload_mode{ TextureUploadMode::Streamed };
+    bool                                        m_upload_logging{ false };
+    std::unique_ptr<PixelUnpackRing>            m_unpack_ring;
+    std::unique_ptr<TextureUpload>              m_upload;
+    std::optional<TextureUploadStats>           m_last_upload_stats;
+};
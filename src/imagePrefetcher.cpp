@@ -0,0 +1,183 @@
+#include <iostream>
+#include "imagePrefetcher.h"
+#include "util.h"
+
+ImagePrefetcher::ImagePrefetcher(ThreadPool& thread_pool, size_t lookahead, size_t byte_budget)
+    : m_thread_pool(thread_pool), m_lookahead(lookahead), m_byte_budget(byte_budget) {}
+
+void ImagePrefetcher::setLookahead(size_t lookahead) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_lookahead = lookahead;
+    reschedule();
+}
+
+size_t ImagePrefetcher::getLookahead() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_lookahead;
+}
+
+void ImagePrefetcher::setByteBudget(size_t byte_budget) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_byte_budget = byte_budget;
+    reschedule();
+}
+
+size_t ImagePrefetcher::getByteBudget() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_byte_budget;
+}
+
+void ImagePrefetcher::setDecodeOptions(const ImageDecodeOptions& options) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_decode_options = options;
+}
+
+size_t ImagePrefetcher::getCachedBytes() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    collectFinished();
+
+    size_t cached_bytes = 0;
+    for (const auto& [filepath, entry] : m_entries) {
+        if (entry.data) {
+            cached_bytes += entry.data->getSizeInBytes();
+        }
+    }
+    return cached_bytes;
+}
+
+void ImagePrefetcher::update(const std::vector<std::string>& upcoming_filepaths) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_upcoming_filepaths = upcoming_filepaths;
+    reschedule();
+}
+
+ImagePrefetcher::Prefetched ImagePrefetcher::take(const std::string& filepath) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_current_filepath = filepath;
+    collectFinished();
+
+    Prefetched prefetched;
+    auto it = m_entries.find(filepath);
+    if (it != m_entries.end()) {
+        Entry& entry = it->second;
+        prefetched.data = std::move(entry.data);
+        if (entry.future.valid() && entry.started->load()) {
+            prefetched.future = std::move(entry.future);
+            prefetched.cancelled = entry.cancelled;
+        } else {
+            entry.cancelled->store(true);
+        }
+        m_entries.erase(it);
+    }
+
+    // The window moves forward by one now that this file is no longer upcoming.
+    reschedule();
+    return prefetched;
+}
+
+size_t ImagePrefetcher::evict(size_t bytes) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    collectFinished();
+
+    size_t released_bytes = 0;
+    for (auto it = m_upcoming_filepaths.rbegin(); it != m_upcoming_filepaths.rend() && released_bytes < bytes; it++) {
+        auto entry = m_entries.find(*it);
+        if (entry == m_entries.end() || ! entry->second.data) {
+            continue;
+        }
+        released_bytes += entry->second.data->getSizeInBytes();
+        entry->second.data = std::nullopt;
+        entry->second.evicted = true;
+    }
+    return released_bytes;
+}
+
+void ImagePrefetcher::clear() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (auto& [filepath, entry] : m_entries) {
+        entry.cancelled->store(true);
+    }
+    m_entries.clear();
+    m_upcoming_filepaths.clear();
+    m_current_filepath = std::nullopt;
+}
+
+void ImagePrefetcher::collectFinished() {
+    for (auto& [filepath, entry] : m_entries) {
+        if (! entry.future.valid() || ! isFutureReady(entry.future)) {
+            continue;
+        }
+
+        // A file that fails to decode is kept (without data) so that it isn't retried on every
+        // update. The error surfaces when the file is actually previewed.
+        try {
+            entry.data = entry.future.get();
+        } catch (const std::exception& e) {
+            std::cerr << e.what() << std::endl;
+            continue;
+        }
+
+        if (entry.data) {
+            m_decoded_count++;
+            m_decoded_bytes_total += entry.data->getSizeInBytes();
+        }
+    }
+}
+
+void ImagePrefetcher::reschedule() {
+    collectFinished();
+
+    // Until the first decode completes there is nothing to base an estimate on, so in-flight
+    // decodes are assumed to be free.
+    const size_t estimated_bytes = m_decoded_count ? (m_decoded_bytes_total / m_decoded_count) : 0;
+
+    std::unordered_map<std::string, Entry> scheduled_entries;
+    size_t scheduled_bytes = 0;
+
+    for (const std::string& filepath : m_upcoming_filepaths) {
+        if (scheduled_entries.size() >= m_lookahead) {
+            break;
+        }
+        if ((m_current_filepath && filepath == m_current_filepath.value()) || scheduled_entries.contains(filepath)) {
+            continue;
+        }
+
+        auto it = m_entries.find(filepath);
+        size_t bytes = estimated_bytes;
+        if (it != m_entries.end() && it->second.data) {
+            bytes = it->second.data->getSizeInBytes();
+        } else if (it != m_entries.end() && it->second.evicted) {
+            bytes = 0;
+        }
+        if (scheduled_bytes + bytes > m_byte_budget) {
+            break;
+        }
+        scheduled_bytes += bytes;
+
+        // Keep work that has already been done or started.
+        if (it != m_entries.end()) {
+            scheduled_entries.emplace(filepath, std::move(it->second));
+            m_entries.erase(it);
+            continue;
+        }
+
+        auto cancelled = std::make_shared<std::atomic<bool>>(false);
+        auto started = std::make_shared<std::atomic<bool>>(false);
+        std::future<std::optional<ImageData>> future = m_thread_pool.submit(
+            [filepath, options = m_decode_options, cancelled, started]() -> std::optional<ImageData> {
+                if (cancelled->load()) {
+                    return std::nullopt;
+                }
+                started->store(true);
+                return ImageData::decodeFromFile(filepath, options);
+            }
+        );
+        scheduled_entries.emplace(filepath, Entry{cancelled, started, std::move(future), std::nullopt, false});
+    }
+
+    // Whatever is left fell out of the window (or the budget).
+    for (auto& [filepath, entry] : m_entries) {
+        entry.cancelled->store(true);
+    }
+    m_entries = std::move(scheduled_entries);
+}
@@ -0,0 +1,104 @@
+#pragma once
+
+#include <atomic>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "image.h"
+#include "threadPool.h"
+
+/**
+ * @brief Decodes the upcoming images ahead of time so that advancing to them doesn't wait on a decode.
+ *
+ * The prefetcher is told which files come next (in labeling order) through update(). It decodes
+ * up to `lookahead` of them on the given thread pool, stopping early once the decoded pixels
+ * would exceed the byte budget. Files that drop out of the upcoming list are cancelled and their
+ * pixels released. All methods are thread safe.
+ */
+class ImagePrefetcher {
+public:
+
+    // What has been prefetched of a file: its decoded pixels, or else the decode in progress (if any).
+    struct Prefetched {
+        std::optional<ImageData>                    data;
+        std::future<std::optional<ImageData>>       future;         // Valid only if the decode has started but isn't done.
+        std::shared_ptr<std::atomic<bool>>          cancelled;      // Of that decode.
+    };
+
+    ImagePrefetcher(ThreadPool& thread_pool, size_t lookahead, size_t byte_budget);
+
+    void setLookahead(size_t lookahead);
+    size_t getLookahead() const;
+
+    void setByteBudget(size_t byte_budget);
+    size_t getByteBudget() const;
+
+    // Options for decodes started from now on. Already prefetched images are kept as they are.
+    void setDecodeOptions(const ImageDecodeOptions& options);
+
+    // Bytes held by decoded (but not yet taken) images.
+    size_t getCachedBytes();
+
+    /**
+     * @brief Replaces the list of upcoming files.
+     *
+     * @param upcoming_filepaths Files in the order they will be shown. Only the first `lookahead`
+     * of them (excluding the current one) are prefetched.
+     */
+    void update(const std::vector<std::string>& upcoming_filepaths);
+
+    /**
+     * @brief Marks the given file as the one being previewed, so it is no longer prefetched.
+     *
+     * @return Its decoded pixels if they are ready, else its decode if one is already running, for
+     * the caller to wait on instead of decoding the file again. A decode still waiting in the queue
+     * is cancelled, a fresh request with a higher priority overtakes it.
+     */
+    Prefetched take(const std::string& filepath);
+
+    /**
+     * @brief Releases decoded pixels, those of the files furthest down the upcoming list first, until
+     * at least `bytes` are released. Evicted files aren't decoded again while they stay upcoming.
+     *
+     * @return The bytes released.
+     */
+    size_t evict(size_t bytes);
+
+    // Cancels all outstanding work and releases all decoded pixels.
+    void clear();
+
+private:
+    struct Entry {
+        std::shared_ptr<std::atomic<bool>>      cancelled;
+        std::shared_ptr<std::atomic<bool>>      started;
+        std::future<std::optional<ImageData>>   future;
+        std::optional<ImageData>                data;
+        bool                                    evicted{ false };
+    };
+
+    // Moves the results of finished decodes into their entries. Expects m_mutex to be held.
+    void collectFinished();
+
+    // Re-applies the lookahead window and the byte budget. Expects m_mutex to be held.
+    void reschedule();
+
+    ThreadPool&                                 m_thread_pool;
+    size_t                                      m_lookahead;
+    size_t                                      m_byte_budget;
+    ImageDecodeOptions                          m_decode_options;
+
+    std::vector<std::string>                    m_upcoming_filepaths;
+    std::optional<std::string>                  m_current_filepath;
+    std::unordered_map<std::string, Entry>      m_entries;
+
+    // Running average of decoded image sizes, used to estimate the size of in-flight decodes.
+    size_t                                      m_decoded_count{ 0 };
+    size_t                                      m_decoded_bytes_total{ 0 };
+
+    mutable std::mutex                          m_mutex;
+};
@@ -0,0 +1,340 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+#include <fstream>
+#include <iterator>
+#include <vector>
+#include <stb_image.h>
+#include "jpegDecoder.h"
+#include "mappedFile.h"
+#include "pixelArena.h"
+#include "resample.h"
+
+#ifdef MLBC_HAVE_TURBOJPEG
+#include <turbojpeg.h>
+#endif
+
+namespace {
+
+    // The EXIF segment (APP1) is at most 64 KiB and comes right after the start of the image, possibly
+    // preceded by a JFIF segment (APP0).
+    const size_t    EXIF_SEARCH_BYTES           = 128 * 1024;
+
+    // Thumbnails whose aspect ratio is further off than this are assumed to be letterboxed.
+    const double    EXIF_THUMBNAIL_ASPECT_RATIO_TOLERANCE = 0.05;
+
+    std::vector<uint8_t> readFile(const std::string& filepath, size_t max_bytes) {
+        std::ifstream file(filepath, std::ios::binary | std::ios::ate);
+        if (! file) {
+            return {};
+        }
+
+        size_t size = std::min(static_cast<size_t>(file.tellg()), max_bytes);
+        std::vector<uint8_t> data(size);
+        file.seekg(0);
+        file.read(reinterpret_cast<char*>(data.data()), static_cast<std::streamsize>(size));
+        data.resize(static_cast<size_t>(file.gcount()));
+        return data;
+    }
+
+    /**
+     * @brief Reads integers from a TIFF structure (the body of an EXIF segment) with bounds checking.
+     */
+    class TIFFReader {
+    public:
+        TIFFReader(const uint8_t* data, size_t size)
+            : m_data(data), m_size(size) {}
+
+        bool readByteOrder() {
+            if (m_size < 8) {
+                return false;
+            }
+            if (m_data[0] == 'I' && m_data[1] == 'I') {
+                m_little_endian = true;
+            } else if (m_data[0] == 'M' && m_data[1] == 'M') {
+                m_little_endian = false;
+            } else {
+                return false;
+            }
+
+            uint16_t magic;
+            return read16(2, magic) && magic == 42;
+        }
+
+        bool read16(size_t offset, uint16_t& value) const {
+            if (offset + 2 > m_size) {
+                return false;
+            }
+            const uint8_t* p = m_data + offset;
+            value = m_little_endian ? (p[0] | (p[1] << 8)) : ((p[0] << 8) | p[1]);
+            return true;
+        }
+
+        bool read32(size_t offset, uint32_t& value) const {
+            if (offset + 4 > m_size) {
+                return false;
+            }
+            const uint8_t* p = m_data + offset;
+            value = m_little_endian
+                ? (static_cast<uint32_t>(p[0]) | (static_cast<uint32_t>(p[1]) << 8) | (static_cast<uint32_t>(p[2]) << 16) | (static_cast<uint32_t>(p[3]) << 24))
+                : ((static_cast<uint32_t>(p[0]) << 24) | (static_cast<uint32_t>(p[1]) << 16) | (static_cast<uint32_t>(p[2]) << 8) | static_cast<uint32_t>(p[3]));
+            return true;
+        }
+
+        size_t getSize() const { return m_size; }
+
+    private:
+        const uint8_t*  m_data;
+        size_t          m_size;
+        bool            m_little_endian{ true };
+    };
+
+    // Locates the JPEG thumbnail referenced by IFD1 of a TIFF structure, as an offset and length into it.
+    std::optional<std::pair<size_t, size_t>> findThumbnailInTIFF(const uint8_t* data, size_t size) {
+        const uint16_t TAG_COMPRESSION      = 0x0103;
+        const uint16_t TAG_JPEG_OFFSET      = 0x0201;
+        const uint16_t TAG_JPEG_LENGTH      = 0x0202;
+        const uint16_t COMPRESSION_JPEG     = 6;
+        const uint16_t TYPE_SHORT           = 3;
+
+        TIFFReader reader(data, size);
+        if (! reader.readByteOrder()) {
+            return std::nullopt;
+        }
+
+        // IFD0 describes the image itself, the thumbnail is described by the IFD that follows it.
+        uint32_t ifd0_offset;
+        uint16_t ifd0_entry_count;
+        uint32_t ifd1_offset;
+        if (! reader.read32(4, ifd0_offset) || ! reader.read16(ifd0_offset, ifd0_entry_count)
+            || ! reader.read32(ifd0_offset + 2 + static_cast<size_t>(ifd0_entry_count) * 12, ifd1_offset) || ifd1_offset == 0) {
+            return std::nullopt;
+        }
+
+        uint16_t entry_count;
+        if (! reader.read16(ifd1_offset, entry_count)) {
+            return std::nullopt;
+        }
+
+        std::optional<uint32_t> jpeg_offset;
+        std::optional<uint32_t> jpeg_length;
+        for (uint16_t i = 0; i < entry_count; i++) {
+            size_t entry = ifd1_offset + 2 + static_cast<size_t>(i) * 12;
+            uint16_t tag;
+            uint16_t type;
+            if (! reader.read16(entry, tag) || ! reader.read16(entry + 2, type)) {
+                return std::nullopt;
+            }
+
+            // Values of up to four bytes are stored in place.
+            uint32_t value;
+            if (type == TYPE_SHORT) {
+                uint16_t short_value;
+                if (! reader.read16(entry + 8, short_value)) {
+                    return std::nullopt;
+                }
+                value = short_value;
+            } else if (! reader.read32(entry + 8, value)) {
+                return std::nullopt;
+            }
+
+            if (tag == TAG_COMPRESSION && value != COMPRESSION_JPEG) {
+                return std::nullopt;
+            } else if (tag == TAG_JPEG_OFFSET) {
+                jpeg_offset = value;
+            } else if (tag == TAG_JPEG_LENGTH) {
+                jpeg_length = value;
+            }
+        }
+
+        if (! jpeg_offset || ! jpeg_length || jpeg_length.value() == 0 || static_cast<size_t>(jpeg_offset.value()) + jpeg_length.value() > size) {
+            return std::nullopt;
+        }
+        return std::make_pair(static_cast<size_t>(jpeg_offset.value()), static_cast<size_t>(jpeg_length.value()));
+    }
+
+    // Locates the EXIF thumbnail of a JPEG file, as an offset and length into the file.
+    std::optional<std::pair<size_t, size_t>> findEXIFThumbnail(const uint8_t* data, size_t size) {
+        if (size < 4 || data[0] != 0xFF || data[1] != 0xD8) {
+            return std::nullopt;
+        }
+
+        size_t position = 2;
+        while (position + 4 <= size) {
+            if (data[position] != 0xFF) {
+                return std::nullopt;
+            }
+
+            uint8_t marker = data[position + 1];
+            if (marker == 0xFF) {
+                position++;     // Fill byte.
+                continue;
+            }
+            if (marker == 0xDA || marker == 0xD9) {
+                return std::nullopt;    // Start of scan or end of image: no more metadata.
+            }
+
+            size_t segment_length = (static_cast<size_t>(data[position + 2]) << 8) | data[position + 3];
+            if (segment_length < 2) {
+                return std::nullopt;
+            }
+            size_t segment = position + 4;
+            size_t segment_size = segment_length - 2;
+            if (segment + segment_size > size) {
+                return std::nullopt;
+            }
+
+            const char EXIF_IDENTIFIER[6] = {'E', 'x', 'i', 'f', '\0', '\0'};
+            if (marker == 0xE1 && segment_size > sizeof(EXIF_IDENTIFIER) && std::memcmp(data + segment, EXIF_IDENTIFIER, sizeof(EXIF_IDENTIFIER)) == 0) {
+                size_t tiff = segment + sizeof(EXIF_IDENTIFIER);
+                std::optional<std::pair<size_t, size_t>> thumbnail = findThumbnailInTIFF(data + tiff, segment_size - sizeof(EXIF_IDENTIFIER));
+                if (thumbnail) {
+                    return std::make_pair(tiff + thumbnail->first, thumbnail->second);
+                }
+            }
+            position = segment + segment_size;
+        }
+        return std::nullopt;
+    }
+}
+
+bool isJPEGFile(const std::string& filepath) {
+    std::vector<uint8_t> data = readFile(filepath, 3);
+    return data.size() == 3 && data[0] == 0xFF && data[1] == 0xD8 && data[2] == 0xFF;
+}
+
+std::optional<DecodedJPEG> decodeEXIFThumbnail(const std::string& filepath, int32_t channels) {
+
+    // Only the metadata at the start of the file is read in.
+    std::vector<uint8_t> file = readFile(filepath, EXIF_SEARCH_BYTES);
+    const uint8_t* data = file.data();
+    std::optional<std::pair<size_t, size_t>> thumbnail = findEXIFThumbnail(data, file.size());
+    if (! thumbnail) {
+        return std::nullopt;
+    }
+
+    // The dimensions of the full image are read from its frame header (which follows the metadata), without decoding it.
+    int32_t source_width;
+    int32_t source_height;
+    int32_t source_channels;
+    if (! stbi_info_from_memory(data, static_cast<int>(file.size()), &source_width, &source_height, &source_channels)) {
+        return std::nullopt;
+    }
+
+    int32_t width;
+    int32_t height;
+    int32_t thumbnail_channels;
+    uint8_t* pixels = stbi_load_from_memory(data + thumbnail->first, static_cast<int>(thumbnail->second), &width, &height, &thumbnail_channels, channels);
+    if (! pixels) {
+        return std::nullopt;
+    }
+
+    double aspect_ratio = static_cast<double>(width) / height;
+    double source_aspect_ratio = static_cast<double>(source_width) / source_height;
+    if (std::abs(aspect_ratio - source_aspect_ratio) > EXIF_THUMBNAIL_ASPECT_RATIO_TOLERANCE * source_aspect_ratio) {
+        stbi_image_free(pixels);
+        return std::nullopt;
+    }
+
+    return DecodedJPEG{pixels, width, height, channels ? channels : thumbnail_channels, source_width, source_height};
+}
+
+#ifdef MLBC_HAVE_TURBOJPEG
+
+bool isScaledJPEGDecodingAvailable() {
+    return true;
+}
+
+std::optional<DecodedJPEG> decodeJPEGScaled(const std::string& filepath, int32_t max_width, int32_t max_height, int32_t channels) {
+
+    // libjpeg-turbo has no gray+alpha output format.
+    if (channels == 2) {
+        return std::nullopt;
+    }
+
+    // Check the signature before reading the whole file, which other formats would do for nothing.
+    if (! isJPEGFile(filepath)) {
+        return std::nullopt;
+    }
+
+    std::optional<FileContents> file;
+    try {
+        file.emplace(filepath);
+    } catch (const std::runtime_error&) {
+        return std::nullopt;
+    }
+    const uint8_t* data = file->getData();
+    const size_t size = file->getSize();
+
+    tjhandle decompressor = tjInitDecompress();
+    if (! decompressor) {
+        return std::nullopt;
+    }
+
+    int32_t source_width;
+    int32_t source_height;
+    int32_t subsampling;
+    int32_t colorspace;
+    if (tjDecompressHeader3(decompressor, data, size, &source_width, &source_height, &subsampling, &colorspace) != 0) {
+        tjDestroy(decompressor);
+        return std::nullopt;
+    }
+
+    int32_t fitted_width;
+    int32_t fitted_height;
+    fitWithin(source_width, source_height, max_width, max_height, fitted_width, fitted_height);
+
+    // Pick the smallest downscaling factor whose output still covers the fitted size.
+    int32_t width = source_width;
+    int32_t height = source_height;
+    int32_t scaling_factor_count = 0;
+    tjscalingfactor* scaling_factors = tjGetScalingFactors(&scaling_factor_count);
+    for (int32_t i = 0; scaling_factors && i < scaling_factor_count; i++) {
+        const tjscalingfactor& factor = scaling_factors[i];
+        if (factor.num > factor.denom) {
+            continue;
+        }
+
+        int32_t scaled_width = TJSCALED(source_width, factor);
+        int32_t scaled_height = TJSCALED(source_height, factor);
+        if (scaled_width >= fitted_width && scaled_height >= fitted_height && scaled_width * scaled_height < width * height) {
+            width = scaled_width;
+            height = scaled_height;
+        }
+    }
+
+    // Grayscale JPEGs stay single channel unless asked otherwise.
+    if (! channels) {
+        channels = (colorspace == TJCS_GRAY) ? 1 : 3;
+    }
+    const int32_t pixel_format = (channels == 1) ? TJPF_GRAY : (channels == 3) ? TJPF_RGB : TJPF_RGBA;
+
+    uint8_t* pixels = static_cast<uint8_t*>(PixelArena::instance().allocate(static_cast<size_t>(width) * height * channels));
+    if (! pixels) {
+        tjDestroy(decompressor);
+        return std::nullopt;
+    }
+
+    if (tjDecompress2(decompressor, data, size, pixels, width, 0, height, pixel_format, 0) != 0) {
+        PixelArena::instance().release(pixels);
+        tjDestroy(decompressor);
+        return std::nullopt;
+    }
+
+    tjDestroy(decompressor);
+    return DecodedJPEG{pixels, width, height, channels, source_width, source_height};
+}
+
+#else
+
+bool isScaledJPEGDecodingAvailable() {
+    return false;
+}
+
+std::optional<DecodedJPEG> decodeJPEGScaled(const std::string&, int32_t, int32_t, int32_t) {
+    return std::nullopt;
+}
+
+#endif
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <string>
+
+/**
+ * @brief Pixels (1 to 4 interleaved 8-bit channels) decoded by one of the JPEG specific paths.
+ *
+ * The pixels are allocated from the pixel arena, so that they can be released with stbi_image_free()
+ * like the ones decoded by stb_image.
+ */
+struct DecodedJPEG {
+    uint8_t*        pixels;
+    int32_t         width;
+    int32_t         height;
+    int32_t         channels;
+
+    // Dimensions of the full image, which are larger than the decoded ones for thumbnails and scaled decodes.
+    int32_t         source_width;
+    int32_t         source_height;
+};
+
+// Whether the file starts with a JPEG start-of-image marker.
+bool isJPEGFile(const std::string& filepath);
+
+/**
+ * @brief Decodes the thumbnail embedded in the EXIF metadata of a JPEG file (typically 160x120),
+ * reading only the start of the file.
+ *
+ * @param channels Number of channels to decode into, zero to keep the thumbnail's own.
+ * @return `std::nullopt` if the file has no usable thumbnail (e.g. none at all, or one whose aspect
+ * ratio doesn't match the image, which usually means it is letterboxed).
+ */
+std::optional<DecodedJPEG> decodeEXIFThumbnail(const std::string& filepath, int32_t channels);
+
+/**
+ * @brief Whether decodeJPEGScaled() is available (libjpeg-turbo was found at build time).
+ */
+bool isScaledJPEGDecodingAvailable();
+
+/**
+ * @brief Decodes a JPEG file at a reduced scale (1/8, 1/4 or 1/2) directly in the DCT domain.
+ *
+ * The smallest scale whose output still covers the size the image fits in within `max_width` x
+ * `max_height` is used, so only a cheap final downscale is needed. A maximum of zero means that
+ * dimension is unbounded (decoding at full scale if both are).
+ *
+ * @param channels Number of channels to decode into, zero to keep the image's own (gray or RGB).
+ * @return `std::nullopt` if the file couldn't be decoded this way (the caller should fall back to stb_image).
+ */
+std::optional<DecodedJPEG> decodeJPEGScaled(const std::string& filepath, int32_t max_width, int32_t max_height, int32_t channels);
@@ -10,6 +10,8 @@
 #include <SDL_opengl.h>
 #include <stdexcept>
 #include <future>
+#include <chrono>
+#include <filesystem>
 #include <algorithm>
 #include <glm/glm.hpp>
 #include <glm/gtc/type_ptr.hpp>
@@ -23,12 +25,51 @@
 #include "util.h"
 #include "constants.h"
 #include "docking.h"
+#include "directoryIndex.h"
+#include "directoryIndexCache.h"
+#include "displayAdjustments.h"
+#include "animatedImage.h"
+#include "audioPlayer.h"
 #include "fileWatcher.h"
 #include "image.h"
+#include "imageLoader.h"
+#include "imagePrefetcher.h"
+#include "mappedFile.h"
+#include "mediaIndex.h"
+#include "mediaProbe.h"
+#include "memoryBudget.h"
+#include "pixelArena.h"
+#include "readahead.h"
+#include "spectrogram.h"
+#include "textureCache.h"
+#include "texturePool.h"
+#include "textureUpload.h"
+#include "threadPool.h"
+#include "tiledImage.h"
+#include "thumbnailer.h"
+#include "waveform.h"
 #include "widgets.h"
 
 struct UIFlags {
     bool ConfigureDirectories{ false };
+    bool MemoryStatistics{ false };
+};
+
+enum class FilesViewMode: int32_t {
+    List = 0,
+    Grid = 1
+};
+
+// Files of a directory, as listed by loadMediaFiles().
+struct DirectoryListing {
+    std::string                 directory;
+    std::vector<std::string>    filepaths;
+    std::vector<std::string>    modified_filepaths;     // Files that changed since the directory's snapshot was saved.
+};
+
+enum class AudioViewMode: int32_t {
+    Waveform = 0,
+    Spectrogram = 1
 };
 
 struct DirectoryConfiguration {
@@ -50,12 +91,17 @@ private:
     ImFont*                                                         m_ui_font;
     ImFont*                                                         m_ui_icon_regular_font;
     ImFont*                                                         m_ui_icon_solid_font;
-    sf::Music                                                       m_music;
     UIFlags                                                         m_ui_flags;
 
-    std::optional<std::vector<std::string>>                         m_media_sources;
-    std::optional<std::vector<std::string>>                         m_media_class_a;
-    std::optional<std::vector<std::string>>                         m_media_class_b;
+    std::optional<DirectoryIndex>                                   m_media_sources;
+    std::optional<DirectoryIndex>                                   m_media_class_a;
+    std::optional<DirectoryIndex>                                   m_media_class_b;
+    std::atomic<bool>                                               m_media_sources_changed{ false };
+    std::future<std::vector<DirectoryListing>>                      m_directory_rescan_future;
+    std::chrono::steady_clock::time_point                           m_directory_rescan_time;
+    DirectoryIndexCache                                             m_directory_index_cache{ DIRECTORY_INDEX_CACHE_DIR };
+    std::vector<std::shared_ptr<const DirectorySnapshot>>           m_unverified_snapshots;     // Loaded, not checked by a rescan yet.
+    std::atomic<bool>                                               m_directory_indexes_dirty{ false };
 
     std::unique_ptr<Watcher>                                        m_media_sources_watcher;
     std::unique_ptr<Watcher>                                        m_media_class_a_watcher;
@@ -63,7 +109,47 @@ private:
 
     std::optional<DirectoryConfiguration>                           m_directory_configuration;
 
-    std::optional<Image>                                            m_current_media_image_preview;
+    std::shared_ptr<const Image>                                    m_current_media_image_preview;
+    std::optional<TextureCache::Key>                                m_current_media_texture_key;
+    bool                                                            m_current_media_full_resolution_requested{ false };
+    ui::widget::ImageViewState                                      m_preview_view_state;
+    std::unique_ptr<TiledImage>                                     m_current_media_tiled_preview;
+    std::unique_ptr<AnimatedImage>                                  m_current_media_animation;
+    std::future<std::shared_ptr<TilePyramid>>                       m_tile_pyramid_future;
+    std::shared_ptr<std::atomic<bool>>                              m_tile_pyramid_cancelled;
+    std::unique_ptr<DisplayAdjustmentRenderer>                      m_display_adjustment_renderer;
+    DisplayAdjustments                                              m_display_adjustments;
+    int32_t                                                         m_max_texture_size{ 0 };
+    glm::ivec2                                                      m_preview_target_size{ 0, 0 };
+    TextureCache                                                    m_texture_cache{ TEXTURE_CACHE_VRAM_BUDGET };
+    ThreadPool                                                      m_decode_thread_pool{ IMAGE_DECODE_WORKER_COUNT };
+    ImageLoader                                                     m_image_loader{ m_decode_thread_pool };
+    ImagePrefetcher                                                 m_image_prefetcher{ m_decode_thread_pool, IMAGE_PREFETCH_LOOKAHEAD, IMAGE_PREFETCH_BYTE_BUDGET };
+    AudioPlayer                                                     m_audio_player{ m_decode_thread_pool, AUDIO_PREOPENED_COUNT };
+    std::shared_ptr<const WaveformCache>                            m_waveform_cache{ std::make_shared<const WaveformCache>(WAVEFORM_CACHE_DIR, WAVEFORM_CACHE_MAX_SIZE) };
+    std::shared_ptr<const WaveformPyramid>                          m_current_media_waveform;
+    std::future<std::shared_ptr<const WaveformPyramid>>             m_waveform_future;
+    std::shared_ptr<std::atomic<bool>>                              m_waveform_cancelled;
+    ThreadPool                                                      m_analysis_thread_pool{ SPECTROGRAM_WORKER_COUNT };
+    std::shared_ptr<const SpectrogramCache>                         m_spectrogram_cache{ std::make_shared<const SpectrogramCache>(SPECTROGRAM_CACHE_DIR, SPECTROGRAM_CACHE_MAX_SIZE) };
+    std::unique_ptr<Spectrogram>                                    m_current_media_spectrogram;
+    AudioViewMode                                                   m_audio_view_mode{ AudioViewMode::Waveform };
+    ui::widget::TimelineViewState                                   m_audio_view_state;
+    Readahead                                                       m_readahead;
+    ThreadPool                                                      m_thumbnail_thread_pool{ THUMBNAIL_WORKER_COUNT };
+    Thumbnailer                                                     m_thumbnailer{ m_thumbnail_thread_pool, openThumbnailPack() };
+    FilesViewMode                                                   m_files_view_mode{ FilesViewMode::List };
+    MemoryBudget                                                    m_memory_budget{ MEMORY_BUDGET_COMPRESSED_BYTES, MEMORY_BUDGET_DECODED_PIXELS_BYTES, MEMORY_BUDGET_GPU_TEXTURES_BYTES };
+    ThreadPool                                                      m_probe_thread_pool{ MEDIA_PROBE_WORKER_COUNT };
+    MediaProber                                                     m_media_prober{ m_probe_thread_pool, MEDIA_PROBE_BATCH_SIZE, MEDIA_PROBE_MAX_PIXEL_COUNT };
+    std::optional<MediaProbeResult>                                 m_current_media_probe_result;
+    MediaIndex                                                      m_media_index;
+    std::future<MediaFileStats>                                     m_media_file_stats_future;
+    std::string                                                     m_media_filter_text;
+    MediaFilter                                                     m_media_filter;
+    MediaSortKey                                                    m_media_sort_key{ MediaSortKey::DirectoryOrder };
+    bool                                                            m_media_sort_descending{ false };
+    std::chrono::steady_clock::time_point                           m_media_index_refresh_time;
     std::optional<std::string>                                      m_current_media_filepath;
 
     glm::vec4                                                       m_preview_bg_color;
@@ -80,6 +166,7 @@ private:
     const char* WINDOW_MEDIA_PREVIEW = "Media Preview";
     const char* WINDOW_MEDIA_EDITOR = "Media Editor";
     const char* WINDOW_CONFIGURE_DIRECTORIES = "Configure Directories";
+    const char* WINDOW_MEMORY_STATISTICS = "Memory Statistics";
 
     const char* ERROR_MOVING_FILE_POPUP = "Error Moving File";
     std::string m_error_moving_file_pop_up_message;
@@ -102,19 +189,19 @@ public:
         SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, 2);
         SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, 0);
     #elif defined(__APPLE__)
-        // GL 3.2 Core + GLSL 150
-        const char* glsl_version = "#version 150";
+        // GL 3.3 Core + GLSL 330 (texture swizzles, used for gray textures, are core from 3.3)
+        const char* glsl_version = "#version 330";
         SDL_GL_SetAttribute(SDL_GL_CONTEXT_FLAGS, SDL_GL_CONTEXT_FORWARD_COMPATIBLE_FLAG); // Always required on Mac
         SDL_GL_SetAttribute(SDL_GL_CONTEXT_PROFILE_MASK, SDL_GL_CONTEXT_PROFILE_CORE);
         SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, 3);
-        SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, 2);
+        SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, 3);
     #else
-        // GL 3.0 + GLSL 130
-        const char* glsl_version = "#version 130";
+        // GL 3.3 Core + GLSL 330 (texture swizzles, used for gray textures, are core from 3.3)
+        const char* glsl_version = "#version 330";
         SDL_GL_SetAttribute(SDL_GL_CONTEXT_FLAGS, 0);
         SDL_GL_SetAttribute(SDL_GL_CONTEXT_PROFILE_MASK, SDL_GL_CONTEXT_PROFILE_CORE);
         SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, 3);
-        SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, 0);
+        SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, 3);
     #endif
 
         // From 2.0.18: Enable native IME.
@@ -153,6 +240,9 @@ public:
             exit(EXIT_FAILURE);
         }
 
+        // Images larger than this can't be displayed through a single texture.
+        glGetIntegerv(GL_MAX_TEXTURE_SIZE, &m_max_texture_size);
+
         // Set the background clear/refresh color.
         glClearColor(ui::COLOR_DARK_GREY.x, ui::COLOR_DARK_GREY.y, ui::COLOR_DARK_GREY.z, ui::COLOR_DARK_GREY.w);
 
@@ -170,6 +260,7 @@ public:
         // Setup Platform/Renderer backends.
         ImGui_ImplSDL2_InitForOpenGL(m_window, m_gl_context);
         ImGui_ImplOpenGL3_Init(glsl_version);
+        m_display_adjustment_renderer = std::make_unique<DisplayAdjustmentRenderer>(glsl_version);
         
         // Load application theme.
         m_theme = ui::deserializeThemeFromJSON(APPLICATION_THEME_FILEPATH);
@@ -186,9 +277,52 @@ public:
 
         // Initially the preview background color is the same as the window background color.
         m_preview_bg_color = m_theme->WindowBg;
+
+        // Texture upload path, overridable for comparing both paths (e.g. on a headless test rig).
+        if (const char* upload_mode = std::getenv("MLBC_TEXTURE_UPLOAD_MODE")) {
+            if (std::string(upload_mode) == "sync") {
+                m_image_loader.setUploadMode(TextureUploadMode::Synchronous);
+            } else if (std::string(upload_mode) == "streamed") {
+                m_image_loader.setUploadMode(TextureUploadMode::Streamed);
+            } else {
+                std::cerr << "warning: unknown MLBC_TEXTURE_UPLOAD_MODE '" << upload_mode << "' (expected 'sync' or 'streamed')" << std::endl;
+            }
+        }
+        m_image_loader.setUploadLogging(std::getenv("MLBC_LOG_TEXTURE_UPLOADS") != nullptr);
+
+        // Memory budgets, overridable for running on shared machines.
+        for (auto [variable, tier] : {
+            std::pair{"MLBC_DECODED_PIXELS_BUDGET_MB", MemoryTier::DecodedPixels},
+            std::pair{"MLBC_GPU_TEXTURES_BUDGET_MB", MemoryTier::GPUTextures}
+        }) {
+            if (const char* budget = std::getenv(variable)) {
+                try {
+                    m_memory_budget.setBudget(tier, std::stoull(budget) * 1024 * 1024);
+                } catch (const std::exception&) {
+                    std::cerr << "warning: invalid " << variable << " '" << budget << "' (expected a number of MiB)" << std::endl;
+                }
+            }
+        }
+        registerMemoryConsumers();
     }
 
     ~MLBC() override {
+
+        // Watcher callbacks use most members, so they are stopped before anything else goes away.
+        resetWatchers();
+
+        // Keep what is known about the directories for the next start.
+        saveDirectoryIndexes(true);
+
+        // Free GPU resources while the OpenGL context is still alive.
+        m_current_media_image_preview = nullptr;
+        m_current_media_tiled_preview = nullptr;
+        m_current_media_animation = nullptr;
+        m_texture_cache.clear();
+        m_image_loader.releaseGPUResources();
+        m_thumbnailer.releaseGPUResources();
+        TexturePool::instance().clear();
+        m_display_adjustment_renderer = nullptr;
         
         // Free ImGui resources.
         ImGui_ImplOpenGL3_Shutdown();
@@ -222,6 +356,52 @@ public:
         });
 
         showMainMenuBar();
+
+        // Adjusted draws of the previous frame have been rendered by now.
+        m_display_adjustment_renderer->newFrame();
+
+        // Release textures of files that changed on disk.
+        m_texture_cache.processInvalidations();
+
+        // Fill in the dimensions probed (and the file stats read) since the last refresh, so that the Files window can filter and sort by them.
+        auto now = std::chrono::steady_clock::now();
+        if (now - m_media_index_refresh_time >= std::chrono::milliseconds(MEDIA_INDEX_REFRESH_INTERVAL_MS)) {
+            m_media_index_refresh_time = now;
+            std::lock_guard<std::mutex> lock(mutex_media_sources);
+            std::vector<std::pair<std::string, MediaProbeResult>> probe_results = m_media_prober.takeCompleted();
+            if (! probe_results.empty()) {
+                m_media_index.applyProbeResults(probe_results);
+                m_directory_indexes_dirty.store(true);
+            }
+            if (m_media_file_stats_future.valid() && isFutureReady(m_media_file_stats_future)) {
+                m_media_index.applyFileStats(m_media_file_stats_future.get());
+                m_directory_indexes_dirty.store(true);
+            }
+        }
+
+        // Watchers only flag changes to the source files, the prefetch queue is updated once per frame.
+        if (m_media_sources_changed.exchange(false)) {
+            std::lock_guard<std::mutex> lock(mutex_media_sources);
+            updatePrefetchQueue();
+        }
+        rescanDirectories(now);
+
+        // Pick up the requested preview image once it has been decoded.
+        pollCurrentPreview();
+        pollTiledPreview();
+        pollWaveform();
+        if (m_current_media_spectrogram) {
+            m_current_media_spectrogram->update(SPECTROGRAM_UPLOADS_PER_FRAME);
+        }
+        if (m_current_media_animation) {
+            m_current_media_animation->update();
+        }
+
+        // Upload finished thumbnails and generate the ones requested by the files grid.
+        m_thumbnailer.update();
+
+        // Release cached pixels and textures if any tier went over its budget.
+        m_memory_budget.enforce();
         
         // Docked windows.
         ImGuiWindowFlags docked_window_flags = ImGuiWindowFlags_None;
@@ -273,6 +453,22 @@ public:
             preview_bg_color_edit_flags |= ImGuiColorEditFlags_AlphaBar;
             ImGui::ColorEdit4("Preview Background", glm::value_ptr(m_preview_bg_color), preview_bg_color_edit_flags);
 
+            // Display adjustments (applied by the preview's shader, the pixels are left as they are).
+            if (m_directory_configuration && m_directory_configuration->mediaType == MediaType::Image) {
+                showDisplayAdjustmentControls(slider_width / 4.0f);
+
+                // Number of upcoming source images decoded ahead of time.
+                int32_t prefetch_lookahead = static_cast<int32_t>(m_image_prefetcher.getLookahead());
+                ImGui::PushItemWidth(slider_width / 4.0f);
+                if (ImGui::SliderInt("Prefetch Lookahead", &prefetch_lookahead, 0, IMAGE_PREFETCH_MAX_LOOKAHEAD, "%d", ImGuiSliderFlags_AlwaysClamp)) {
+                    m_image_prefetcher.setLookahead(static_cast<size_t>(prefetch_lookahead));
+
+                    std::lock_guard<std::mutex> lock(mutex_media_sources);
+                    updatePrefetchQueue();
+                }
+                ImGui::PopItemWidth();
+            }
+
             // Label button click handler.
             if (label_button_clicked) {
                 labelButtonClickHandler();
@@ -299,17 +495,46 @@ public:
         
         if (ImGui::Begin(WINDOW_FILES, nullptr, docked_window_flags)) {
             if (m_directory_configuration) {
+
+                // View mode toggle.
+                if (m_directory_configuration->mediaType == MediaType::Image) {
+                    if (ImGui::RadioButton(ICON_FA_LIST " List", m_files_view_mode == FilesViewMode::List)) { m_files_view_mode = FilesViewMode::List; }
+                    ImGui::SameLine();
+                    if (ImGui::RadioButton(ICON_FA_TABLE_CELLS " Grid", m_files_view_mode == FilesViewMode::Grid)) { m_files_view_mode = FilesViewMode::Grid; }
+
+                    // Progress of the background validation pass, and how many files it flagged.
+                    size_t pending_probe_count = m_media_prober.getPendingCount();
+                    size_t flagged_count = m_media_prober.getFlaggedCount();
+                    if (pending_probe_count > 0) {
+                        ImGui::SameLine();
+                        ImGui::TextDisabled(ICON_FA_HOURGLASS_HALF " Checking %zu files", pending_probe_count);
+                    }
+                    if (flagged_count > 0) {
+                        ImGui::SameLine();
+                        ImGui::TextDisabled(ICON_FA_TRIANGLE_EXCLAMATION " %zu flagged", flagged_count);
+                    }
+
+                    showMediaFilterControls();
+                }
                 
                 // Build header labels.
 
                 // Build header label for media sources.
                 size_t media_sources_count = 0;
+                std::optional<size_t> media_sources_shown_count;
                 {
                     std::lock_guard<std::mutex> lock(mutex_media_sources);
                     media_sources_count = m_media_sources->size();
+                    if (isMediaIndexQueried()) {
+                        media_sources_shown_count = m_media_index.query(m_media_filter, m_media_sort_key, m_media_sort_descending).size();
+                    }
                 }
                 std::stringstream media_sources_header_label_ss;
-                media_sources_header_label_ss << "Source  [" << media_sources_count << "]";
+                media_sources_header_label_ss << "Source  [";
+                if (media_sources_shown_count) {
+                    media_sources_header_label_ss << media_sources_shown_count.value() << " / ";
+                }
+                media_sources_header_label_ss << media_sources_count << "]";
                 media_sources_header_label_ss << "###media-sources-header";
                 std::string media_sources_header_label = media_sources_header_label_ss.str();
 
@@ -340,13 +565,17 @@ public:
                     std::lock_guard<std::mutex> lock(mutex_media_sources);
                     if (m_media_sources.has_value()) {
                         ImGui::Indent();
-                        filesListView(
-                            m_media_sources.value(),
-                            m_directory_configuration->mediaType,
-                            [this](const std::vector<std::string>& filepaths, MediaType media_type, int selected_index){
-                                loadCurrentPreviewAndFilepath(filepaths.at(selected_index));
-                            }
-                        );
+                        auto on_file_selected = [this](const std::vector<std::string>& filepaths, MediaType media_type, int selected_index){
+                            loadCurrentPreviewAndFilepath(filepaths.at(selected_index));
+                        };
+
+                        // Filtered or sorted files are listed through the index, by row.
+                        if (isMediaIndexQueried()) {
+                            const std::vector<uint32_t>& rows = m_media_index.query(m_media_filter, m_media_sort_key, m_media_sort_descending);
+                            filesListView(m_media_index.getFilepaths(), m_directory_configuration->mediaType, on_file_selected, &rows);
+                        } else {
+                            filesListView(m_media_sources->getFilepaths(), m_directory_configuration->mediaType, on_file_selected);
+                        }
                         ImGui::Unindent();
                     }  
                 }
@@ -357,7 +586,7 @@ public:
                     if (m_media_class_a.has_value()) {
                         ImGui::Indent();
                         filesListView(
-                            m_media_class_a.value(),
+                            m_media_class_a->getFilepaths(),
                             m_directory_configuration->mediaType,
                             [this](const std::vector<std::string>& filepaths, MediaType media_type, int selected_index){
                                 loadCurrentPreviewAndFilepath(filepaths.at(selected_index));
@@ -372,7 +601,7 @@ public:
                     if (m_media_class_b.has_value()) {
                         ImGui::Indent();
                         filesListView(
-                            m_media_class_b.value(),
+                            m_media_class_b->getFilepaths(),
                             m_directory_configuration->mediaType,
                             [this](const std::vector<std::string>& filepaths, MediaType media_type, int selected_index){
                                 loadCurrentPreviewAndFilepath(filepaths.at(selected_index));
@@ -388,15 +617,76 @@ public:
         ImGui::PushStyleColor(ImGuiCol_WindowBg, toImVec4(m_preview_bg_color));
         ImGui::PushStyleColor(ImGuiCol_Text, toImVec4(ui::getContrastingTextColor(toGLMVec4(ImGui::GetStyle().Colors[ImGuiCol_WindowBg]))));
         if (ImGui::Begin(WINDOW_MEDIA_PREVIEW, nullptr, docked_window_flags | ImGuiWindowFlags_NoNav)) {
+
+            // Previews are decoded at the resolution they are displayed at (in framebuffer pixels).
+            ImVec2 preview_content_size = ImGui::GetContentRegionAvail();
+            ImVec2 framebuffer_scale = ImGui::GetIO().DisplayFramebufferScale;
+            m_preview_target_size = {
+                static_cast<int32_t>(preview_content_size.x * framebuffer_scale.x),
+                static_cast<int32_t>(preview_content_size.y * framebuffer_scale.y)
+            };
+
             if (m_directory_configuration.has_value()) {
                 if (m_directory_configuration->mediaType == MediaType::Image) {
-                    if (m_current_media_filepath && m_current_media_image_preview) {
+                    if (m_current_media_filepath) {
                         SelectableText(m_current_media_filepath.value());
-                        ui::widget::ImageView(m_current_media_image_preview.value());
+                        if (m_current_media_probe_result && m_current_media_probe_result->isFlagged()) {
+                            ui::widget::Placeholder(std::string(ICON_FA_TRIANGLE_EXCLAMATION " ") + getMediaProbeStatusDescription(m_current_media_probe_result->status));
+                        } else if (m_current_media_animation && m_current_media_animation->isAnimated() && m_current_media_animation->hasFrame()) {
+                            ui::widget::AnimatedImageView(*m_current_media_animation, m_preview_view_state, *m_display_adjustment_renderer, m_display_adjustments);
+                        } else if (m_current_media_tiled_preview) {
+                            ui::widget::TiledImageView(*m_current_media_tiled_preview, m_preview_view_state, *m_display_adjustment_renderer, m_display_adjustments);
+                        } else if (m_current_media_image_preview) {
+                            ui::widget::ImageView(*m_current_media_image_preview, m_preview_view_state, *m_display_adjustment_renderer, m_display_adjustments);
+
+                            // Full resolution is only loaded once the user zooms into a downscaled preview.
+                            // Images too large for a single texture are loaded as a tile pyramid instead.
+                            if (m_preview_view_state.zoom > 1.0f && m_current_media_image_preview->isDownscaled() && ! m_current_media_full_resolution_requested) {
+                                m_current_media_full_resolution_requested = true;
+                                if (needsTiledPreview(m_current_media_image_preview->getSourceWidth(), m_current_media_image_preview->getSourceHeight())) {
+                                    requestTiledPreview(m_current_media_filepath.value());
+                                } else {
+                                    ImageDecodeOptions full_resolution_options;
+                                    full_resolution_options.high_bit_depth = true;
+                                    m_image_loader.request(m_current_media_filepath.value(), full_resolution_options);
+                                }
+                            }
+                        } else if (m_image_loader.isPending()) {
+                            ui::widget::Placeholder(ICON_FA_HOURGLASS_HALF " Loading...");
+                        }
                     }
                 } 
                 else if (m_directory_configuration->mediaType == MediaType::Audio) {
-
+                    if (m_current_media_filepath) {
+                        SelectableText(m_current_media_filepath.value());
+                        if (m_audio_player.isOpen()) {
+                            showAudioPlayerControls();
+                            showAudioViewModeControls();
+
+                            // Both views share the zoom and pan, so switching keeps the same part of the recording in view.
+                            std::optional<float> seek_position;
+                            if (m_audio_view_mode == AudioViewMode::Waveform) {
+                                if (m_current_media_waveform) {
+                                    seek_position = ui::widget::WaveformView(*m_current_media_waveform, m_audio_view_state, m_audio_player.getPosition());
+                                } else if (m_waveform_future.valid()) {
+                                    ui::widget::Placeholder(ICON_FA_HOURGLASS_HALF " Computing waveform...");
+                                }
+                            } else if (m_current_media_spectrogram) {
+                                if (m_current_media_spectrogram->getData().hasFailed()) {
+                                    ui::widget::Placeholder(ICON_FA_TRIANGLE_EXCLAMATION " Couldn't compute the spectrogram");
+                                } else if (m_current_media_spectrogram->getTexture()) {
+                                    seek_position = ui::widget::SpectrogramView(*m_current_media_spectrogram, m_audio_view_state, m_audio_player.getPosition());
+                                } else {
+                                    ui::widget::Placeholder(ICON_FA_HOURGLASS_HALF " Computing spectrogram...");
+                                }
+                            }
+                            if (seek_position) {
+                                m_audio_player.seek(seek_position.value());
+                            }
+                        } else {
+                            ui::widget::Placeholder(ICON_FA_TRIANGLE_EXCLAMATION " Unsupported or unreadable audio file");
+                        }
+                    }
                 }
             }
         }
@@ -410,42 +700,61 @@ public:
             
             showConfigureDirectoriesWindow([this](std::optional<DirectoryConfiguration> data) {
                 if (data) {
-                    
-                    // Audio support is not available yet.
-                    if (data->mediaType == MediaType::Audio) {
-                        return;
-                    }
-
                     m_directory_configuration = data;
 
+                    // Stop watching the previous directories before their indexes are replaced.
+                    resetWatchers();
+
                     // Initially load (asynchronously) the configured directories when a 
-                    // directory configuration is set.
+                    // directory configuration is set. Directories seen before are loaded from
+                    // their saved snapshots, which the first rescan then checks.
 
-                    std::future<void> media_sources_future = std::async([this, data] {
+                    std::future<std::shared_ptr<const DirectorySnapshot>> media_sources_future = std::async([this, data] {
                         std::lock_guard<std::mutex> lock(mutex_media_sources);
-                        m_media_sources = loadMediaFiles(data->sourceDirectory, data->mediaType);
+                        m_media_file_stats_future = {};
+                        std::shared_ptr<const DirectorySnapshot> snapshot = openDirectoryIndex(m_media_sources, data->sourceDirectory, data->mediaType);
+                        if (data->mediaType == MediaType::Image && snapshot) {
+                            m_media_index.rebuild(snapshot->filepaths, snapshot->file_sizes, snapshot->modification_times, m_media_prober);
+                        } else if (data->mediaType == MediaType::Image) {
+                            // Without a snapshot the files are stat'ed on the probe threads, the index is usable meanwhile.
+                            m_media_index.rebuild(m_media_sources->getFilepaths(), m_media_prober);
+                            m_media_file_stats_future = m_probe_thread_pool.submit([filepaths = m_media_sources->getFilepaths()] {
+                                return readMediaFileStats(filepaths);
+                            });
+                        }
+                        return snapshot;
                     });
 
-                    std::future<void> media_class_a_future = std::async([this, data] {
+                    std::future<std::shared_ptr<const DirectorySnapshot>> media_class_a_future = std::async([this, data] {
                         std::lock_guard<std::mutex> lock(mutex_media_class_a);
-                        m_media_class_a = loadMediaFiles(data->classADirectory, data->mediaType);
+                        return openDirectoryIndex(m_media_class_a, data->classADirectory, data->mediaType);
                     });
 
-                    std::future<void> media_class_b_future = std::async([this, data] {
+                    std::future<std::shared_ptr<const DirectorySnapshot>> media_class_b_future = std::async([this, data] {
                         std::lock_guard<std::mutex> lock(mutex_media_class_b);
-                        m_media_class_b = loadMediaFiles(data->classBDirectory, data->mediaType);
+                        return openDirectoryIndex(m_media_class_b, data->classBDirectory, data->mediaType);
                     });
 
                     // Set up watchers to asynchronously watch the configured directories for changes.
-                    // If there are any changes to the configured directories, reload them.
+                    // Changes are delivered in coalesced batches and applied to the directory's index,
+                    // a periodic rescan catches up with any the watchers miss.
 
                     try {
                         m_media_sources_watcher  = std::make_unique<Watcher>(
                             data->sourceDirectory,
-                            [this, data](const std::string& directory, const std::string& file, efsw::Action action, const std::string& old_file) {
+                            [this](const std::vector<Watcher::Event>& events) {
+                                for (const Watcher::Event& event : events) {
+                                    invalidateCachedTextures(event.directory, event.filename, event.old_filename);
+                                }
+
                                 std::lock_guard<std::mutex> lock(mutex_media_sources);
-                                m_media_sources = loadMediaFiles(data->sourceDirectory, data->mediaType);
-                            }
+                                if (m_media_sources) {
+                                    applyMediaSourcesChanges(m_media_sources->apply(events));
+                                }
+                            },
+                            false,
+                            std::chrono::milliseconds(FILE_WATCHER_BATCH_WINDOW_MS),
+                            std::chrono::milliseconds(FILE_WATCHER_MAX_BATCH_DELAY_MS)
                         );
                     } catch (const std::runtime_error& re) {
                         std::cerr << re.what() << std::endl;
@@ -454,10 +763,19 @@ public:
                     try {
                         m_media_class_a_watcher  = std::make_unique<Watcher>(
                             data->classADirectory,
-                            [this, data](const std::string& directory, const std::string& file, efsw::Action action, const std::string& old_file) {
+                            [this](const std::vector<Watcher::Event>& events) {
+                                for (const Watcher::Event& event : events) {
+                                    invalidateCachedTextures(event.directory, event.filename, event.old_filename);
+                                }
+
                                 std::lock_guard<std::mutex> lock(mutex_media_class_a);
-                                m_media_class_a = loadMediaFiles(data->classADirectory, data->mediaType);
-                            }
+                                if (m_media_class_a) {
+                                    applyMediaClassChanges(*m_media_class_a, m_media_class_a->apply(events));
+                                }
+                            },
+                            false,
+                            std::chrono::milliseconds(FILE_WATCHER_BATCH_WINDOW_MS),
+                            std::chrono::milliseconds(FILE_WATCHER_MAX_BATCH_DELAY_MS)
                         );
                     } catch (const std::runtime_error& re) {
                         std::cerr << re.what() << std::endl;
@@ -466,30 +784,52 @@ public:
                     try {
                         m_media_class_b_watcher  = std::make_unique<Watcher>(
                             data->classBDirectory,
-                            [this, data](const std::string& directory, const std::string& file, efsw::Action action, const std::string& old_file) {
+                            [this](const std::vector<Watcher::Event>& events) {
+                                for (const Watcher::Event& event : events) {
+                                    invalidateCachedTextures(event.directory, event.filename, event.old_filename);
+                                }
+
                                 std::lock_guard<std::mutex> lock(mutex_media_class_b);
-                                m_media_class_b = loadMediaFiles(data->classBDirectory, data->mediaType);
-                            }
+                                if (m_media_class_b) {
+                                    applyMediaClassChanges(*m_media_class_b, m_media_class_b->apply(events));
+                                }
+                            },
+                            false,
+                            std::chrono::milliseconds(FILE_WATCHER_BATCH_WINDOW_MS),
+                            std::chrono::milliseconds(FILE_WATCHER_MAX_BATCH_DELAY_MS)
                         );
                     } catch (const std::runtime_error& re) {
                         std::cerr << re.what() << std::endl;
                     }
 
                     // Wait on the futures to finish.
-                    media_sources_future.get();
-                    media_class_a_future.get();
-                    media_class_b_future.get();
+                    m_unverified_snapshots.clear();
+                    for (std::future<std::shared_ptr<const DirectorySnapshot>>* future : {&media_sources_future, &media_class_a_future, &media_class_b_future}) {
+                        std::shared_ptr<const DirectorySnapshot> snapshot = future->get();
+                        if (snapshot) {
+                            m_unverified_snapshots.push_back(std::move(snapshot));
+                        }
+                    }
+                    m_directory_indexes_dirty.store(true);
 
                     // Load the first media source (if any) for preview.
                     {
                         std::lock_guard<std::mutex> lock(mutex_media_sources);
                         if (! m_media_sources->empty()) {
-                            loadCurrentPreviewAndFilepath(m_media_sources->front());
+                            loadCurrentPreviewAndFilepath(m_media_sources->getFilepaths().front());
                         }
+                        updatePrefetchQueue();
                     }
+
+                    // Snapshots may be out of date, so the first rescan starts right away.
+                    m_directory_rescan_time = m_unverified_snapshots.empty() ? std::chrono::steady_clock::now() : std::chrono::steady_clock::time_point();
                 }
             });
         }
+
+        if (m_ui_flags.MemoryStatistics) {
+            showMemoryStatisticsWindow();
+        }
     }
 
     void run() override {
@@ -507,7 +847,9 @@ public:
                 if (event.type == SDL_WINDOWEVENT && event.window.event == SDL_WINDOWEVENT_CLOSE && event.window.windowID == SDL_GetWindowID(m_window)) {
                     m_application_should_close = true;
                 }
-                if (event.type == SDL_KEYDOWN) {
+
+                // Keys typed into a text field (e.g. the filter of the files) aren't shortcuts.
+                if (event.type == SDL_KEYDOWN && ! ImGui::GetIO().WantTextInput) {
                     handleKeyPress(event.key.keysym.sym);
                 }
             }
@@ -546,13 +888,25 @@ public:
     }
 
 private:
+
+    // Destroying a watcher waits for a batch being delivered to it, so none is delivered afterwards.
+    void resetWatchers() {
+        m_media_sources_watcher = nullptr;
+        m_media_class_a_watcher = nullptr;
+        m_media_class_b_watcher = nullptr;
+    }
+
     void showMainMenuBar() {
         if (ImGui::BeginMainMenuBar()) {
             if (ImGui::BeginMenu("File")) {
                 if (ImGui::MenuItem("Close Directories")) {
+                    resetWatchers();
+                    saveDirectoryIndexes(true);
                     {
                         std::lock_guard<std::mutex> lock(mutex_media_sources);
                         m_media_sources = std::nullopt;
+                        m_media_index.clear();
+                        m_media_file_stats_future = {};
                     }
                     
                     {
@@ -566,10 +920,16 @@ private:
                     }
 
                     m_directory_configuration = std::nullopt;
+                    m_image_prefetcher.clear();
+                    m_audio_player.clear();
+                    m_readahead.clear();
+                    m_media_prober.clear();
+
+                    // Cached pixel buffers are sized for the closed directories' images.
+                    PixelArena::instance().trim();
 
-                    m_media_sources_watcher = nullptr;
-                    m_media_class_a_watcher = nullptr;
-                    m_media_class_b_watcher = nullptr;
+                    m_directory_rescan_future = {};
+                    m_unverified_snapshots.clear();
                 }
                 if (ImGui::MenuItem("Close Preview")) {
                     clearCurrentPreviewAndFilepath();
@@ -579,15 +939,110 @@ private:
             }
             if (ImGui::BeginMenu("Configure")) {
                 if (ImGui::MenuItem("Directories")) { m_ui_flags.ConfigureDirectories = true; }
+                bool streamed_uploads = m_image_loader.getUploadMode() == TextureUploadMode::Streamed;
+                if (ImGui::MenuItem("Streamed Texture Uploads", nullptr, &streamed_uploads)) {
+                    m_image_loader.setUploadMode(streamed_uploads ? TextureUploadMode::Streamed : TextureUploadMode::Synchronous);
+                }
                 ImGui::EndMenu();
             }
             if (ImGui::BeginMenu("Help")) {
+                ImGui::MenuItem("Memory Statistics", nullptr, &m_ui_flags.MemoryStatistics);
                 ImGui::EndMenu();
             }
             ImGui::EndMainMenuBar();
         }
     }
 
+    void showMemoryStatisticsWindow() {
+        auto toMebibytes = [](size_t bytes) {
+            return static_cast<double>(bytes) / (1024.0 * 1024.0);
+        };
+
+        ImGui::SetNextWindowSize({520.0f, 560.0f}, ImGuiCond_FirstUseEver);
+        if (ImGui::Begin(WINDOW_MEMORY_STATISTICS, &m_ui_flags.MemoryStatistics, ImGuiWindowFlags_NoDocking)) {
+
+            // Usage and budget of every tier.
+            for (MemoryTier tier : {MemoryTier::Compressed, MemoryTier::DecodedPixels, MemoryTier::GPUTextures}) {
+                const MemoryBudget::TierStats& stats = m_memory_budget.getTierStats(tier);
+                ImGui::PushID(static_cast<int32_t>(tier));
+                ImGui::TextUnformatted(getMemoryTierName(tier));
+
+                std::string overlay = std::to_string(static_cast<int64_t>(toMebibytes(stats.used_bytes))) + " / "
+                    + std::to_string(static_cast<int64_t>(toMebibytes(stats.budget))) + " MiB";
+                float fraction = stats.budget ? static_cast<float>(stats.used_bytes) / static_cast<float>(stats.budget) : 1.0f;
+                ImGui::ProgressBar(std::min(fraction, 1.0f), {-1.0f, 0.0f}, overlay.c_str());
+
+                int32_t budget_mebibytes = static_cast<int32_t>(stats.budget / (1024 * 1024));
+                if (ImGui::SliderInt("Budget (MiB)", &budget_mebibytes, 64, 16384, "%d", ImGuiSliderFlags_Logarithmic)) {
+                    m_memory_budget.setBudget(tier, static_cast<size_t>(budget_mebibytes) * 1024 * 1024);
+                }
+                ImGui::Text("Released: %.1f MiB", toMebibytes(stats.released_bytes));
+                ImGui::PopID();
+                ImGui::Separator();
+            }
+
+            // Usage of every consumer, in eviction order.
+            ImGuiTableFlags table_flags = ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg;
+            if (ImGui::BeginTable("MemoryConsumersTable", 4, table_flags)) {
+                ImGui::TableSetupColumn("Consumer", ImGuiTableColumnFlags_WidthStretch);
+                ImGui::TableSetupColumn("Tier", ImGuiTableColumnFlags_WidthFixed);
+                ImGui::TableSetupColumn("Priority", ImGuiTableColumnFlags_WidthFixed);
+                ImGui::TableSetupColumn("MiB", ImGuiTableColumnFlags_WidthFixed);
+                ImGui::TableHeadersRow();
+
+                for (const MemoryBudget::ConsumerStats& stats : m_memory_budget.getConsumerStats()) {
+                    ImGui::TableNextRow();
+                    ImGui::TableNextColumn();
+                    ImGui::TextUnformatted(stats.name.c_str());
+                    ImGui::TableNextColumn();
+                    ImGui::TextUnformatted(getMemoryTierName(stats.tier));
+                    ImGui::TableNextColumn();
+                    if (stats.releasable) {
+                        ImGui::Text("%d", stats.priority);
+                    } else {
+                        ImGui::TextUnformatted("-");
+                    }
+                    ImGui::TableNextColumn();
+                    ImGui::Text("%.1f", toMebibytes(stats.used_bytes));
+                }
+                ImGui::EndTable();
+            }
+
+            // Counters of the individual caches.
+            ImGui::Separator();
+            ImGui::Text("Texture cache: %zu entries, %zu hits, %zu misses",
+                m_texture_cache.getEntryCount(), m_texture_cache.getHitCount(), m_texture_cache.getMissCount());
+
+            const TexturePool& texture_pool = TexturePool::instance();
+            ImGui::Text("Texture pool: %zu textures, %zu reused, %zu allocated",
+                texture_pool.getPooledTextureCount(), texture_pool.getReuseCount(), texture_pool.getAllocationCount());
+
+            PixelArena::Stats arena_stats = PixelArena::instance().getStats();
+            ImGui::Text("Pixel arena: %.1f MiB used (%.1f MiB peak), %zu reused, %zu allocated",
+                toMebibytes(arena_stats.used_bytes), toMebibytes(arena_stats.peak_used_bytes), arena_stats.reuse_count, arena_stats.system_allocation_count);
+
+            const ThumbnailAtlas& atlas = m_thumbnailer.getAtlas();
+            ImGui::Text("Thumbnails: %zu in %zu atlas pages, %zu pending",
+                atlas.getThumbnailCount(), atlas.getPageCount(), m_thumbnailer.getPendingCount());
+
+            ImGui::Text("File watcher: %zu directories, %zu watchers", WatcherService::instance().getWatchCount(), WatcherService::instance().getWatcherCount());
+            for (const auto& [name, watcher] : {std::pair{"Source", m_media_sources_watcher.get()}, std::pair{"Class A", m_media_class_a_watcher.get()}, std::pair{"Class B", m_media_class_b_watcher.get()}}) {
+                if (watcher) {
+                    Watcher::Statistics watcher_stats = watcher->getStatistics();
+                    ImGui::Text("%s watcher: %zu actions in %zu batches, last %zu -> %zu events after %.0f ms (max %.0f ms)",
+                        name, watcher_stats.action_count, watcher_stats.batch_count, watcher_stats.last_action_count,
+                        watcher_stats.last_event_count, watcher_stats.last_latency_milliseconds, watcher_stats.max_latency_milliseconds);
+                }
+            }
+
+            if (const std::optional<TextureUploadStats>& upload_stats = m_image_loader.getLastUploadStats()) {
+                ImGui::Text("Last upload: %dx%d in %d frames, %.2f ms (longest frame %.2f ms)",
+                    upload_stats->width, upload_stats->height, upload_stats->frames, upload_stats->total_milliseconds, upload_stats->max_step_milliseconds);
+            }
+        }
+        ImGui::End();
+    }
+
     void showConfigureDirectoriesWindow(std::function<void(std::optional<DirectoryConfiguration>)> on_submit_callback) {
         static DirectoryConfiguration data;
 
@@ -825,25 +1280,242 @@ private:
         ImGui::End();
     }
 
+    // Whether the Source list goes through the media index, i.e. it is filtered or not in directory order.
+    bool isMediaIndexQueried() const {
+        return m_directory_configuration && m_directory_configuration->mediaType == MediaType::Image
+            && (m_media_filter != MediaFilter{} || m_media_sort_key != MediaSortKey::DirectoryOrder || m_media_sort_descending);
+    }
+
+    void showMediaFilterControls() {
+        if (ImGui::InputTextWithHint("##media-filter", "Filter, e.g. cat width>512 size<2mb .png", &m_media_filter_text)) {
+            m_media_filter = parseMediaFilter(m_media_filter_text);
+        }
+        if (ImGui::IsItemHovered()) {
+            ImGui::SetTooltip("Name, width/height/size with < <= = >= >, and extensions (.png or ext:png)");
+        }
+
+        if (ImGui::BeginCombo("##media-sort-key", getMediaSortKeyName(m_media_sort_key))) {
+            for (int32_t i = 0; i < MEDIA_SORT_KEY_COUNT; i++) {
+                MediaSortKey key = static_cast<MediaSortKey>(i);
+                if (ImGui::Selectable(getMediaSortKeyName(key), m_media_sort_key == key)) {
+                    m_media_sort_key = key;
+                }
+            }
+            ImGui::EndCombo();
+        }
+        ImGui::SameLine();
+        if (ImGui::Button(m_media_sort_descending ? ICON_FA_ARROW_DOWN_WIDE_SHORT : ICON_FA_ARROW_UP_SHORT_WIDE)) {
+            m_media_sort_descending = ! m_media_sort_descending;
+        }
+        if (ImGui::IsItemHovered()) {
+            ImGui::SetTooltip(m_media_sort_descending ? "Descending" : "Ascending");
+        }
+    }
+
+    /**
+     * @brief Lists files, in the given order (indices into `filepaths`) if any. The callback is given the index
+     * of the selected file in `filepaths`.
+     */
     void filesListView(
         const std::vector<std::string>& filepaths,
         MediaType media_type,
-        std::function<void(const std::vector<std::string>&, MediaType, int)> on_file_selected_callback
+        std::function<void(const std::vector<std::string>&, MediaType, int)> on_file_selected_callback,
+        const std::vector<uint32_t>* order = nullptr
     ) {
         namespace fs = std::filesystem;
-        for (int i = 0; i < static_cast<int>(filepaths.size()); i++) {
-
-            // Build label.
-            std::string file_icon;
-            if (media_type == MediaType::Image) { file_icon = ICON_FA_FILE_IMAGE; }
-            else if (media_type == MediaType::Audio) { file_icon = ICON_FA_FILE_AUDIO; }
-            else { file_icon = ICON_FA_FILE; }
-            std::string file_entry = file_icon + " " + fs::path(filepaths.at(i)).filename().string();
-            
-            if (ImGui::Selectable(file_entry.c_str())) {
-                on_file_selected_callback(filepaths, media_type, i);
+        if (m_files_view_mode == FilesViewMode::Grid && media_type == MediaType::Image) {
+            filesGridView(filepaths, media_type, on_file_selected_callback, order);
+            return;
+        }
+
+        // Only the visible entries are laid out, which keeps large (filtered) directories cheap to list.
+        const int file_count = static_cast<int>(order ? order->size() : filepaths.size());
+        ImGuiListClipper clipper;
+        clipper.Begin(file_count);
+        while (clipper.Step()) {
+            for (int n = clipper.DisplayStart; n < clipper.DisplayEnd; n++) {
+                const int i = order ? static_cast<int>((*order)[n]) : n;
+
+                // Build label.
+                std::string file_icon;
+                if (media_type == MediaType::Image) { file_icon = ICON_FA_FILE_IMAGE; }
+                else if (media_type == MediaType::Audio) { file_icon = ICON_FA_FILE_AUDIO; }
+                else { file_icon = ICON_FA_FILE; }
+                std::optional<MediaProbeResult> probe_result = m_media_prober.find(filepaths.at(i));
+                if (probe_result && probe_result->isFlagged()) { file_icon = ICON_FA_TRIANGLE_EXCLAMATION; }
+                std::string file_entry = file_icon + " " + fs::path(filepaths.at(i)).filename().string();
+                
+                if (ImGui::Selectable(file_entry.c_str())) {
+                    on_file_selected_callback(filepaths, media_type, i);
+                }
+                if (probe_result && ImGui::IsItemHovered()) {
+                    showProbeResultTooltip(probe_result.value());
+                }
+            }
+        }
+        clipper.End();
+    }
+
+    void showProbeResultTooltip(const MediaProbeResult& result) {
+        ImGui::BeginTooltip();
+        if (result.isFlagged()) {
+            ImGui::Text("%s", getMediaProbeStatusDescription(result.status));
+        }
+        if (result.width > 0) {
+            ImGui::Text("%d x %d, %d channels, %d-bit", result.width, result.height, result.channels, result.bit_depth);
+        }
+        ImGui::Text("%.1f KiB", static_cast<double>(result.file_size) / 1024.0);
+        ImGui::EndTooltip();
+    }
+
+    void filesGridView(
+        const std::vector<std::string>& filepaths,
+        MediaType media_type,
+        std::function<void(const std::vector<std::string>&, MediaType, int)> on_file_selected_callback,
+        const std::vector<uint32_t>* order = nullptr
+    ) {
+        namespace fs = std::filesystem;
+
+        const float cell_size = THUMBNAIL_GRID_CELL_SIZE;
+        const float cell_padding = 2.0f;
+        const ImVec2 item_spacing = ImGui::GetStyle().ItemSpacing;
+        const int column_count = std::max(1, static_cast<int>((ImGui::GetContentRegionAvail().x + item_spacing.x) / (cell_size + item_spacing.x)));
+        const int file_count = static_cast<int>(order ? order->size() : filepaths.size());
+        const int row_count = (file_count + column_count - 1) / column_count;
+
+        // Thumbnails go to their own channel so that all of them (sharing a few atlas textures) are
+        // batched into a handful of draw calls instead of alternating with the cell backgrounds.
+        ImDrawList* draw_list = ImGui::GetWindowDrawList();
+        draw_list->ChannelsSplit(2);
+
+        // Only the visible rows are laid out (and have their thumbnails requested).
+        ImGuiListClipper clipper;
+        clipper.Begin(row_count, cell_size + item_spacing.y);
+        while (clipper.Step()) {
+            for (int row = clipper.DisplayStart; row < clipper.DisplayEnd; row++) {
+                for (int column = 0; column < column_count; column++) {
+                    int n = row * column_count + column;
+                    if (n >= file_count) {
+                        break;
+                    }
+                    const int i = order ? static_cast<int>((*order)[n]) : n;
+                    if (column > 0) {
+                        ImGui::SameLine();
+                    }
+
+                    const std::string& filepath = filepaths.at(i);
+                    ImVec2 cell_min = ImGui::GetCursorScreenPos();
+                    ImVec2 cell_max = {cell_min.x + cell_size, cell_min.y + cell_size};
+
+                    ImGui::PushID(i);
+                    bool clicked = ImGui::InvisibleButton("##thumbnail", {cell_size, cell_size});
+                    bool hovered = ImGui::IsItemHovered();
+                    ImGui::PopID();
+
+                    draw_list->ChannelsSetCurrent(0);
+                    draw_list->AddRectFilled(cell_min, cell_max, ImGui::GetColorU32(hovered ? ImGuiCol_FrameBgHovered : ImGuiCol_FrameBg));
+                    if (m_current_media_filepath == filepath) {
+                        draw_list->AddRect(cell_min, cell_max, ImGui::GetColorU32(ImGuiCol_ButtonActive), 0.0f, 0, cell_padding);
+                    }
+
+                    const bool flagged = m_media_prober.isFlagged(filepath);
+                    const ThumbnailAtlas::Cell* thumbnail = flagged ? nullptr : m_thumbnailer.request(filepath);
+                    if (thumbnail) {
+
+                        // Fit the thumbnail within the cell, preserving its aspect ratio.
+                        float available_size = cell_size - 2.0f * cell_padding;
+                        float scale = std::min(available_size / thumbnail->width, available_size / thumbnail->height);
+                        ImVec2 size = {thumbnail->width * scale, thumbnail->height * scale};
+                        ImVec2 image_min = {cell_min.x + (cell_size - size.x) * 0.5f, cell_min.y + (cell_size - size.y) * 0.5f};
+
+                        draw_list->ChannelsSetCurrent(1);
+                        draw_list->AddImage(thumbnail->texture, image_min, {image_min.x + size.x, image_min.y + size.y}, thumbnail->uv_min, thumbnail->uv_max);
+                    } else {
+                        const char* icon = (flagged || m_thumbnailer.hasFailed(filepath)) ? ICON_FA_TRIANGLE_EXCLAMATION : ICON_FA_FILE_IMAGE;
+                        ImVec2 icon_size = ImGui::CalcTextSize(icon);
+                        draw_list->AddText(
+                            {cell_min.x + (cell_size - icon_size.x) * 0.5f, cell_min.y + (cell_size - icon_size.y) * 0.5f},
+                            ImGui::GetColorU32(ImGuiCol_TextDisabled),
+                            icon
+                        );
+                    }
+
+                    if (hovered) {
+                        ImGui::SetTooltip("%s", fs::path(filepath).filename().string().c_str());
+                    }
+                    if (clicked) {
+                        on_file_selected_callback(filepaths, media_type, i);
+                    }
+                }
             }
         }
+        clipper.End();
+
+        draw_list->ChannelsMerge();
+    }
+
+    // Every cache holding on to pixels or textures registers with the memory budget. Consumers with lower priorities are released first.
+    void registerMemoryConsumers() {
+        m_memory_budget.registerConsumer({"Mapped files", MemoryTier::Compressed, 0,
+            [] { return MappedFile::getMappedBytes(); },
+            nullptr
+        });
+
+        m_memory_budget.registerConsumer({"Pixel arena cache", MemoryTier::DecodedPixels, 0,
+            [] { return PixelArena::instance().getStats().cached_bytes; },
+            [](size_t bytes) { return PixelArena::instance().trim(bytes); }
+        });
+        m_memory_budget.registerConsumer({"Prefetched images", MemoryTier::DecodedPixels, 1,
+            [this] { return m_image_prefetcher.getCachedBytes(); },
+            [this](size_t bytes) { return m_image_prefetcher.evict(bytes); }
+        });
+        m_memory_budget.registerConsumer({"Zoom preview pyramid", MemoryTier::DecodedPixels, 2,
+            [this] { return m_current_media_tiled_preview ? m_current_media_tiled_preview->getPyramid().getSizeInBytes() : 0; },
+            [this](size_t bytes) { return m_current_media_tiled_preview ? m_current_media_tiled_preview->releasePyramid(bytes) : 0; }
+        });
+        m_memory_budget.registerConsumer({"Audio waveform", MemoryTier::DecodedPixels, 3,
+            [this] { return m_current_media_waveform ? m_current_media_waveform->getSizeInBytes() : 0; },
+            nullptr
+        });
+        m_memory_budget.registerConsumer({"Audio spectrogram", MemoryTier::DecodedPixels, 3,
+            [this] { return m_current_media_spectrogram ? m_current_media_spectrogram->getData().getSizeInBytes() : 0; },
+            nullptr
+        });
+
+        m_memory_budget.registerConsumer({"Texture pool", MemoryTier::GPUTextures, 0,
+            [] { return TexturePool::instance().getPooledBytes(); },
+            [](size_t bytes) { return TexturePool::instance().trim(bytes); }
+        });
+        m_memory_budget.registerConsumer({"Texture cache", MemoryTier::GPUTextures, 1,
+            [this] { return m_texture_cache.getUsedBytes(); },
+            [this](size_t bytes) { return m_texture_cache.evict(bytes); }
+        });
+        m_memory_budget.registerConsumer({"Zoom preview tiles", MemoryTier::GPUTextures, 2,
+            [this] { return m_current_media_tiled_preview ? m_current_media_tiled_preview->getSizeInBytes() : 0; },
+            [this](size_t bytes) { return m_current_media_tiled_preview ? m_current_media_tiled_preview->evict(bytes) : 0; }
+        });
+        m_memory_budget.registerConsumer({"Animated preview", MemoryTier::GPUTextures, 4,
+            [this] { return m_current_media_animation ? m_current_media_animation->getSizeInBytes() : 0; },
+            nullptr
+        });
+        m_memory_budget.registerConsumer({"Thumbnail atlas", MemoryTier::GPUTextures, 3,
+            [this] { return m_thumbnailer.getAtlas().getSizeInBytes(); },
+            [this](size_t bytes) { return m_thumbnailer.releaseAtlas(bytes); }
+        });
+        m_memory_budget.registerConsumer({"Audio spectrogram texture", MemoryTier::GPUTextures, 4,
+            [this] { return m_current_media_spectrogram ? m_current_media_spectrogram->getSizeInBytes() : 0; },
+            nullptr
+        });
+    }
+
+    // Opens the persistent thumbnail pack. Thumbnails are only kept in memory if it can't be opened.
+    static std::shared_ptr<ThumbnailPack> openThumbnailPack() {
+        try {
+            return std::make_shared<ThumbnailPack>(THUMBNAIL_PACK_FILEPATH, THUMBNAIL_PACK_MAX_SIZE);
+        } catch (const std::runtime_error& re) {
+            std::cerr << re.what() << std::endl;
+            return nullptr;
+        }
     }
 
     void clearCurrentPreviewAndFilepath() {
@@ -855,9 +1527,18 @@ private:
         }
 
         if (m_directory_configuration->mediaType == MediaType::Image) {
-            m_current_media_image_preview = std::nullopt;
+            m_image_loader.cancel();
+            cancelTiledPreview();
+            m_current_media_animation = nullptr;
+            m_current_media_image_preview = nullptr;
+            m_current_media_probe_result = std::nullopt;
+            m_current_media_texture_key = std::nullopt;
+            m_current_media_full_resolution_requested = false;
+            m_preview_view_state = ui::widget::ImageViewState();
         } else if (m_directory_configuration->mediaType == MediaType::Audio) {
-            // clear audio specific previews in the future.
+            m_audio_player.close();
+            cancelWaveform();
+            cancelSpectrogram();
         }
 
         m_current_media_filepath = std::nullopt;
@@ -872,14 +1553,582 @@ private:
         }
 
         if (m_directory_configuration->mediaType == MediaType::Image) {
-            m_current_media_image_preview = Image::loadFromFile(filepath);
+
+            // Prefer a texture that is still cached on the GPU, then prefetched pixels. Otherwise
+            // decoding happens on worker threads and until the image is ready, a placeholder is shown
+            // instead of the previous image so that the wrong media can't be labeled.
+            m_current_media_texture_key = TextureCache::Key::fromFile(filepath);
+            m_current_media_full_resolution_requested = false;
+            cancelTiledPreview();
+            m_preview_view_state = ui::widget::ImageViewState();
+
+            // Files found unreadable or oversized are never decoded. Those the background pass hasn't
+            // reached yet are probed right away, which only reads their header.
+            m_current_media_probe_result = m_media_prober.find(filepath);
+            if (! m_current_media_probe_result) {
+                m_current_media_probe_result = probeImageFile(filepath, MEDIA_PROBE_MAX_PIXEL_COUNT);
+            }
+            if (m_current_media_probe_result->isFlagged()) {
+                m_image_loader.cancel();
+                m_current_media_animation = nullptr;
+                m_current_media_image_preview = nullptr;
+                m_current_media_filepath = filepath;
+                return;
+            }
+
+            // GIFs are also played, frame by frame, once they turn out to be animated. Until then the
+            // first frame is shown through the regular path below.
+            m_current_media_animation = nullptr;
+            if (std::filesystem::path(filepath).extension() == ".gif") {
+                try {
+                    m_current_media_animation = std::make_unique<AnimatedImage>(filepath, ANIMATED_IMAGE_DECODED_FRAME_COUNT, ANIMATED_IMAGE_TEXTURE_COUNT);
+                } catch (const std::runtime_error& re) {
+                    std::cerr << re.what() << std::endl;
+                }
+            }
+
+            // 16-bit and HDR images keep their precision, to be tone mapped when displayed.
+            ImageDecodeOptions decode_options = {m_preview_target_size.x, m_preview_target_size.y, false, 0, true};
+            m_image_prefetcher.setDecodeOptions(decode_options);
+
+            std::shared_ptr<const Image> cached_image = m_current_media_texture_key ? m_texture_cache.find(m_current_media_texture_key.value()) : nullptr;
+            ImagePrefetcher::Prefetched prefetched = m_image_prefetcher.take(filepath);
+            if (cached_image) {
+                m_image_loader.cancel();
+                if (prefetched.cancelled) {
+                    prefetched.cancelled->store(true);
+                }
+                m_current_media_image_preview = cached_image;
+            } else if (prefetched.data) {
+                m_current_media_image_preview = nullptr;
+                m_image_loader.upload(std::move(prefetched.data.value()));
+
+                // Small images complete within the first step, sparing a frame without preview.
+                pollCurrentPreview();
+            } else if (prefetched.future.valid()) {
+
+                // Halfway through being prefetched: wait for that decode rather than starting over.
+                m_current_media_image_preview = nullptr;
+                m_image_loader.adopt(filepath, std::move(prefetched.future), std::move(prefetched.cancelled));
+            } else {
+                m_current_media_image_preview = nullptr;
+                m_image_loader.request(filepath, decode_options, true);
+            }
         } else if (m_directory_configuration->mediaType == MediaType::Audio) {
-            // load audio specific previews in the future.
+
+            // Upcoming files are opened ahead of time, so this usually only starts the stream.
+            m_audio_player.play(filepath);
+            requestWaveform(filepath);
+
+            // The spectrogram takes a lot more work than the waveform, so it is only computed when shown.
+            cancelSpectrogram();
+            if (m_audio_view_mode == AudioViewMode::Spectrogram) {
+                requestSpectrogram(filepath);
+            }
         }
 
         m_current_media_filepath = filepath;
     }
 
+    // Playback controls of the current audio file. Volume and looping carry over to the next files.
+    void showAudioPlayerControls() {
+        auto format_time = [](float seconds) {
+            int32_t total_seconds = static_cast<int32_t>(seconds);
+            char text[16];
+            std::snprintf(text, sizeof(text), "%d:%02d", total_seconds / 60, total_seconds % 60);
+            return std::string(text);
+        };
+
+        const bool paused = m_audio_player.isPaused();
+        if (ImGui::Button(paused ? ICON_FA_PLAY "###audio-play-pause" : ICON_FA_PAUSE "###audio-play-pause")) {
+            m_audio_player.setPaused(! paused);
+        }
+        if (ImGui::IsItemHovered()) {
+            ImGui::SetTooltip("%s (P)", paused ? "Play" : "Pause");
+        }
+        ImGui::SameLine();
+
+        bool looping = m_audio_player.isLooping();
+        if (ImGui::Checkbox("Loop###audio-loop", &looping)) {
+            m_audio_player.setLooping(looping);
+        }
+        ImGui::SameLine();
+
+        float volume = m_audio_player.getVolume();
+        ImGui::PushItemWidth(ImGui::GetContentRegionAvail().x * 0.25f);
+        if (ImGui::SliderFloat("Volume###audio-volume", &volume, 0.0f, 1.0f, "%.2f", ImGuiSliderFlags_AlwaysClamp)) {
+            m_audio_player.setVolume(volume);
+        }
+        ImGui::PopItemWidth();
+
+        // Seek bar, labeled with the position and the duration.
+        float position = m_audio_player.getPosition();
+        const float duration = m_audio_player.getDuration();
+        std::string position_label = format_time(position) + " / " + format_time(duration);
+        ImGui::PushItemWidth(ImGui::GetContentRegionAvail().x);
+        if (ImGui::SliderFloat("###audio-position", &position, 0.0f, std::max(duration, 0.001f), position_label.c_str(), ImGuiSliderFlags_AlwaysClamp)) {
+            m_audio_player.seek(position);
+        }
+        ImGui::PopItemWidth();
+
+        ImGui::TextDisabled("%u channels, %u Hz", m_audio_player.getChannelCount(), m_audio_player.getSampleRate());
+    }
+
+    // Adjustments of how the preview is displayed, kept from one image to the next until reset.
+    void showDisplayAdjustmentControls(float slider_width) {
+        ImGui::PushItemWidth(slider_width);
+        ImGui::SliderFloat("Brightness###display-brightness", &m_display_adjustments.brightness, -1.0f, 1.0f, "%+.2f", ImGuiSliderFlags_AlwaysClamp);
+        ImGui::SameLine();
+        ImGui::SliderFloat("Contrast###display-contrast", &m_display_adjustments.contrast, 0.0f, 4.0f, "%.2f", ImGuiSliderFlags_AlwaysClamp);
+        ImGui::SameLine();
+        ImGui::SliderFloat("Gamma###display-gamma", &m_display_adjustments.gamma, 0.1f, 4.0f, "%.2f", ImGuiSliderFlags_AlwaysClamp | ImGuiSliderFlags_Logarithmic);
+
+        // Window/level and exposure are mostly useful for 16-bit and HDR images.
+        const bool high_bit_depth = m_current_media_image_preview && m_current_media_image_preview->getPixelType() != PixelType::UInt8;
+        if (high_bit_depth) {
+            ImGui::SliderFloat("Level###display-level", &m_display_adjustments.level, 0.0f, 1.0f, "%.3f");
+            ImGui::SameLine();
+            ImGui::SliderFloat("Window###display-window", &m_display_adjustments.window, 0.001f, 2.0f, "%.3f", ImGuiSliderFlags_AlwaysClamp | ImGuiSliderFlags_Logarithmic);
+            ImGui::SameLine();
+            ImGui::SliderFloat("Exposure###display-exposure", &m_display_adjustments.exposure, -10.0f, 10.0f, "%+.2f EV");
+        }
+        ImGui::PopItemWidth();
+
+        const char* channel_names[] = {"RGB", "Red", "Green", "Blue", "Alpha"};
+        int32_t channel = static_cast<int32_t>(m_display_adjustments.channel);
+        for (int32_t i = 0; i < IM_ARRAYSIZE(channel_names); i++) {
+            if (i > 0) {
+                ImGui::SameLine();
+            }
+            if (ImGui::RadioButton(channel_names[i], channel == i)) {
+                m_display_adjustments.channel = static_cast<DisplayChannel>(i);
+            }
+        }
+        ImGui::SameLine();
+        ImGui::Checkbox("Invert###display-invert", &m_display_adjustments.invert);
+        ImGui::SameLine();
+        if (ImGui::Button("Reset###display-reset")) {
+            m_display_adjustments = DisplayAdjustments();
+        }
+    }
+
+    // Only images are probed (and indexed). Audio files are checked by the decoder that opens them.
+    void probeMediaFiles(const std::vector<std::string>& filepaths, MediaType media_type) {
+        if (media_type == MediaType::Image) {
+            m_media_prober.probe(filepaths);
+        }
+    }
+
+    // Brings the index and the validation pass in line with source files added or removed. Expects mutex_media_sources to be held.
+    void applyMediaSourcesChanges(const DirectoryIndex::Changes& changes) {
+        if (changes.empty()) {
+            return;
+        }
+
+        const MediaType media_type = m_media_sources->getMediaType();
+        probeMediaFiles(changes.added, media_type);
+        probeMediaFiles(changes.modified, media_type);
+        if (media_type == MediaType::Image) {
+            for (const std::string& filepath : changes.removed) {
+                m_media_index.erase(filepath);
+            }
+            for (const std::string& filepath : changes.added) {
+                m_media_index.insert(filepath, m_media_prober);
+            }
+            for (const std::string& filepath : changes.modified) {
+                m_media_index.insert(filepath, m_media_prober);
+            }
+        }
+        m_media_sources_changed.store(true);
+        m_directory_indexes_dirty.store(true);
+    }
+
+    // Same as applyMediaSourcesChanges() for a class directory, whose files are only listed. Expects its mutex to be held.
+    void applyMediaClassChanges(const DirectoryIndex& index, const DirectoryIndex::Changes& changes) {
+        if (changes.empty()) {
+            return;
+        }
+        probeMediaFiles(changes.added, index.getMediaType());
+        probeMediaFiles(changes.modified, index.getMediaType());
+        m_directory_indexes_dirty.store(true);
+    }
+
+    /**
+     * @brief Fills in the index of a configured directory, from its saved snapshot when there is one
+     * (returned, for the first rescan to check it) or else from a listing. Probe results saved with the
+     * snapshot are taken as is, only the files that were never probed are. Expects the index's mutex to
+     * be held.
+     */
+    std::shared_ptr<const DirectorySnapshot> openDirectoryIndex(std::optional<DirectoryIndex>& index, const std::string& directory, MediaType media_type) {
+        std::shared_ptr<const DirectorySnapshot> snapshot = m_directory_index_cache.find(directory, media_type);
+        if (! snapshot) {
+            index.emplace(directory, media_type, loadMediaFiles(directory, media_type));
+            probeMediaFiles(index->getFilepaths(), media_type);
+            return nullptr;
+        }
+
+        if (media_type == MediaType::Image) {
+            std::vector<std::pair<std::string, MediaProbeResult>> probe_results;
+            probe_results.reserve(snapshot->filepaths.size());
+            for (size_t i = 0; i < snapshot->filepaths.size(); i++) {
+                if (snapshot->probe_results[i]) {
+                    probe_results.emplace_back(snapshot->filepaths[i], snapshot->probe_results[i].value());
+                }
+            }
+            m_media_prober.seed(probe_results);
+        }
+        index.emplace(directory, media_type, snapshot->filepaths);
+        probeMediaFiles(index->getFilepaths(), media_type);
+        return snapshot;
+    }
+
+    // What is known about the files of a directory, to be saved. Expects the index's mutex to be held.
+    DirectorySnapshot takeDirectorySnapshot(DirectoryIndex& index, bool indexed) {
+        DirectorySnapshot snapshot;
+        snapshot.directory = index.getDirectory();
+        snapshot.media_type = index.getMediaType();
+        snapshot.filepaths = index.getFilepaths();
+        snapshot.file_sizes.reserve(snapshot.filepaths.size());
+        snapshot.modification_times.reserve(snapshot.filepaths.size());
+        snapshot.probe_results.reserve(snapshot.filepaths.size());
+        for (const std::string& filepath : snapshot.filepaths) {
+            std::optional<MediaProbeResult> probe_result = m_media_prober.find(filepath);
+
+            // Only indexed files have a known modification time, the others are checked by size alone.
+            auto [file_size, modification_time] = indexed ? m_media_index.getFileStat(filepath) : std::pair<uint64_t, int64_t>(probe_result ? probe_result->file_size : 0, 0);
+            snapshot.file_sizes.push_back(file_size);
+            snapshot.modification_times.push_back(modification_time);
+            snapshot.probe_results.push_back(probe_result);
+        }
+        return snapshot;
+    }
+
+    /**
+     * @brief Saves the snapshots of the configured directories if anything changed since they were last
+     * saved. Snapshots are taken on the calling thread, and written on a worker thread unless `wait`.
+     */
+    void saveDirectoryIndexes(bool wait) {
+        if (! m_directory_indexes_dirty.exchange(false)) {
+            return;
+        }
+
+        auto snapshots = std::make_shared<std::vector<DirectorySnapshot>>();
+        {
+            std::lock_guard<std::mutex> lock(mutex_media_sources);
+            if (m_media_sources) {
+                snapshots->push_back(takeDirectorySnapshot(*m_media_sources, m_media_sources->getMediaType() == MediaType::Image));
+            }
+        }
+        {
+            std::lock_guard<std::mutex> lock(mutex_media_class_a);
+            if (m_media_class_a) {
+                snapshots->push_back(takeDirectorySnapshot(*m_media_class_a, false));
+            }
+        }
+        {
+            std::lock_guard<std::mutex> lock(mutex_media_class_b);
+            if (m_media_class_b) {
+                snapshots->push_back(takeDirectorySnapshot(*m_media_class_b, false));
+            }
+        }
+
+        auto write = [cache = &m_directory_index_cache, snapshots] {
+            for (const DirectorySnapshot& snapshot : *snapshots) {
+                cache->add(snapshot);
+            }
+        };
+        if (wait) {
+            write();
+        } else {
+            m_probe_thread_pool.submit(write);
+        }
+    }
+
+    /**
+     * @brief Lists the configured directories again every DIRECTORY_RESCAN_INTERVAL_MS on a worker
+     * thread, and reconciles their indexes with the listings once done. This only catches up with
+     * changes the watchers missed (e.g. when the system's event queue overflowed); it is not how changes
+     * are normally picked up.
+     */
+    void rescanDirectories(std::chrono::steady_clock::time_point now) {
+        if (m_directory_rescan_future.valid() && isFutureReady(m_directory_rescan_future)) {
+            try {
+                for (const DirectoryListing& listing : m_directory_rescan_future.get()) {
+                    reconcileDirectory(listing);
+                }
+            } catch (const std::runtime_error& re) {
+                std::cerr << re.what() << std::endl;
+            }
+            m_directory_rescan_time = now;
+            saveDirectoryIndexes(false);
+        }
+
+        if (! m_directory_configuration || m_directory_rescan_future.valid() || now - m_directory_rescan_time < std::chrono::milliseconds(DIRECTORY_RESCAN_INTERVAL_MS)) {
+            return;
+        }
+        m_directory_rescan_future = m_probe_thread_pool.submit(
+            [configuration = m_directory_configuration.value(), snapshots = std::move(m_unverified_snapshots)] {
+                std::vector<DirectoryListing> listings;
+                for (const std::string& directory : {configuration.sourceDirectory, configuration.classADirectory, configuration.classBDirectory}) {
+                    listings.push_back({directory, loadMediaFiles(directory, configuration.mediaType), {}});
+                    for (const std::shared_ptr<const DirectorySnapshot>& snapshot : snapshots) {
+                        if (snapshot->directory == directory) {
+                            listings.back().modified_filepaths = findModifiedFiles(*snapshot);
+                        }
+                    }
+                }
+                return listings;
+            }
+        );
+        m_unverified_snapshots.clear();
+    }
+
+    // Files of a snapshot whose size or modification time no longer match the ones saved. Missing files are left to reconcile().
+    static std::vector<std::string> findModifiedFiles(const DirectorySnapshot& snapshot) {
+        namespace fs = std::filesystem;
+
+        std::vector<std::string> modified_filepaths;
+        for (size_t i = 0; i < snapshot.filepaths.size(); i++) {
+            if (snapshot.file_sizes[i] == 0 && snapshot.modification_times[i] == 0) {
+                continue;
+            }
+            std::error_code error;
+            fs::directory_entry entry(snapshot.filepaths[i], error);
+            if (error) {
+                continue;
+            }
+            uintmax_t file_size = entry.file_size(error);
+            if (error) {
+                continue;
+            }
+            int64_t modification_time = snapshot.modification_times[i] == 0 ? 0 : entry.last_write_time(error).time_since_epoch().count();
+            if (! error && (file_size != snapshot.file_sizes[i] || modification_time != snapshot.modification_times[i])) {
+                modified_filepaths.push_back(snapshot.filepaths[i]);
+            }
+        }
+        return modified_filepaths;
+    }
+
+    // Listings of directories that have been closed or reconfigured since are ignored.
+    void reconcileDirectory(const DirectoryListing& listing) {
+        auto reconcile = [this, &listing](DirectoryIndex& index) {
+            DirectoryIndex::Changes changes = index.reconcile(listing.filepaths);
+            for (const std::string& filepath : listing.modified_filepaths) {
+                if (index.contains(filepath)) {
+                    m_media_prober.invalidate(filepath);
+                    changes.modified.push_back(filepath);
+                }
+            }
+            return changes;
+        };
+
+        {
+            std::lock_guard<std::mutex> lock(mutex_media_sources);
+            if (m_media_sources && m_media_sources->getDirectory() == listing.directory) {
+                applyMediaSourcesChanges(reconcile(*m_media_sources));
+            }
+        }
+        {
+            std::lock_guard<std::mutex> lock(mutex_media_class_a);
+            if (m_media_class_a && m_media_class_a->getDirectory() == listing.directory) {
+                applyMediaClassChanges(*m_media_class_a, reconcile(*m_media_class_a));
+            }
+        }
+        {
+            std::lock_guard<std::mutex> lock(mutex_media_class_b);
+            if (m_media_class_b && m_media_class_b->getDirectory() == listing.directory) {
+                applyMediaClassChanges(*m_media_class_b, reconcile(*m_media_class_b));
+            }
+        }
+    }
+
+    // Hands the first few source files to the prefetcher (or the audio player). Expects mutex_media_sources to be held.
+    void updatePrefetchQueue() {
+        if (! m_media_sources) {
+            return;
+        }
+
+        // Labeling always advances to the front of the source list. One extra file is passed along
+        // since the current file is usually among the first ones and is skipped by the prefetcher.
+        // Files flagged by the validation pass are skipped, so they are never decoded ahead of time.
+        const bool audio = m_directory_configuration && m_directory_configuration->mediaType == MediaType::Audio;
+        const size_t lookahead = audio ? AUDIO_PREOPENED_COUNT : m_image_prefetcher.getLookahead();
+        std::vector<std::string> upcoming_filepaths;
+        const size_t readahead_count = lookahead + 1 + READAHEAD_FILE_COUNT;
+        for (const std::string& filepath : m_media_sources->getFilepaths()) {
+            if (upcoming_filepaths.size() >= readahead_count) {
+                break;
+            }
+            if (! m_media_prober.isFlagged(filepath)) {
+                upcoming_filepaths.push_back(filepath);
+            }
+        }
+        size_t count = std::min(upcoming_filepaths.size(), lookahead + 1);
+        if (audio) {
+            m_audio_player.update({upcoming_filepaths.begin(), upcoming_filepaths.begin() + count});
+        } else {
+            m_image_prefetcher.update({upcoming_filepaths.begin(), upcoming_filepaths.begin() + count});
+        }
+
+        // Reading ahead covers the prefetch window and a few files past it, so that they are already
+        // in the page cache by the time they are decoded.
+        m_readahead.update(upcoming_filepaths);
+    }
+
+    // Adds the image of the current media file to the texture cache (if the file could be stat'ed).
+    std::shared_ptr<const Image> cacheCurrentPreview(Image image) {
+        if (m_current_media_texture_key) {
+            return m_texture_cache.insert(m_current_media_texture_key.value(), std::move(image));
+        }
+        return std::make_shared<const Image>(std::move(image));
+    }
+
+    // Called from file watcher threads.
+    void invalidateCachedTextures(const std::string& directory, const std::string& file, const std::string& old_file) {
+        m_texture_cache.invalidate(joinPaths(directory, file));
+        m_thumbnailer.invalidate(joinPaths(directory, file));
+        m_media_prober.invalidate(joinPaths(directory, file));
+        if (! old_file.empty()) {
+            m_texture_cache.invalidate(joinPaths(directory, old_file));
+            m_thumbnailer.invalidate(joinPaths(directory, old_file));
+            m_media_prober.invalidate(joinPaths(directory, old_file));
+        }
+    }
+
+    bool needsTiledPreview(int32_t width, int32_t height) const {
+        return std::max(width, height) > m_max_texture_size || static_cast<size_t>(width) * height > TILED_PREVIEW_MIN_PIXEL_COUNT;
+    }
+
+    // Decodes the current image at full resolution and builds its tile pyramid on a worker thread.
+    void requestTiledPreview(const std::string& filepath) {
+        cancelTiledPreview();
+
+        auto cancelled = std::make_shared<std::atomic<bool>>(false);
+        m_tile_pyramid_cancelled = cancelled;
+        m_tile_pyramid_future = m_decode_thread_pool.submit(
+            [filepath, cancelled]() -> std::shared_ptr<TilePyramid> {
+                if (cancelled->load()) {
+                    return nullptr;
+                }
+                return std::make_shared<TilePyramid>(ImageData::decodeFromFile(filepath), TILED_PREVIEW_TILE_SIZE);
+            },
+            true
+        );
+    }
+
+    void cancelTiledPreview() {
+        if (m_tile_pyramid_cancelled) {
+            m_tile_pyramid_cancelled->store(true);
+            m_tile_pyramid_cancelled = nullptr;
+        }
+        m_tile_pyramid_future = {};
+        m_current_media_tiled_preview = nullptr;
+    }
+
+    void pollTiledPreview() {
+        if (! m_tile_pyramid_future.valid() || ! isFutureReady(m_tile_pyramid_future)) {
+            return;
+        }
+
+        try {
+            std::shared_ptr<TilePyramid> pyramid = m_tile_pyramid_future.get();
+            if (pyramid) {
+                m_current_media_tiled_preview = std::make_unique<TiledImage>(pyramid, TILED_PREVIEW_MAX_TILE_COUNT, TILED_PREVIEW_UPLOADS_PER_FRAME);
+            }
+        } catch (const std::runtime_error& re) {
+            std::cerr << re.what() << std::endl;
+        }
+        m_tile_pyramid_cancelled = nullptr;
+    }
+
+    // Loads the waveform of the current audio file from the cache, or decodes it, on a worker thread.
+    void requestWaveform(const std::string& filepath) {
+        cancelWaveform();
+
+        auto cancelled = std::make_shared<std::atomic<bool>>(false);
+        m_waveform_cancelled = cancelled;
+        m_waveform_future = m_decode_thread_pool.submit(
+            [filepath, cache = m_waveform_cache, cancelled]() -> std::shared_ptr<const WaveformPyramid> {
+                if (cancelled->load()) {
+                    return nullptr;
+                }
+                return loadWaveform(filepath, cache.get(), WAVEFORM_BLOCK_FRAME_COUNT, *cancelled);
+            },
+            true
+        );
+    }
+
+    void cancelWaveform() {
+        if (m_waveform_cancelled) {
+            m_waveform_cancelled->store(true);
+            m_waveform_cancelled = nullptr;
+        }
+        m_waveform_future = {};
+        m_current_media_waveform = nullptr;
+        m_audio_view_state = ui::widget::TimelineViewState();
+    }
+
+    void pollWaveform() {
+        if (! m_waveform_future.valid() || ! isFutureReady(m_waveform_future)) {
+            return;
+        }
+
+        try {
+            m_current_media_waveform = m_waveform_future.get();
+        } catch (const std::runtime_error& re) {
+            std::cerr << re.what() << std::endl;
+        }
+        m_waveform_cancelled = nullptr;
+    }
+
+    // Starts computing the spectrogram of the current audio file, one chunk of columns per task on the analysis workers.
+    void requestSpectrogram(const std::string& filepath) {
+        cancelSpectrogram();
+
+        // The spectrogram is shown through a single texture, a column wide per column and a row high per bin.
+        SpectrogramData::Parameters parameters;
+        parameters.max_column_count = std::min(SPECTROGRAM_MAX_COLUMN_COUNT, m_max_texture_size);
+        parameters.bin_count = std::min(parameters.bin_count, m_max_texture_size);
+        m_current_media_spectrogram = std::make_unique<Spectrogram>(SpectrogramData::compute(filepath, m_analysis_thread_pool, m_spectrogram_cache, parameters));
+    }
+
+    void cancelSpectrogram() {
+        // Outstanding chunks are cancelled when the spectrogram is destroyed.
+        m_current_media_spectrogram = nullptr;
+    }
+
+    void showAudioViewModeControls() {
+        if (ImGui::RadioButton(ICON_FA_WAVE_SQUARE " Waveform", m_audio_view_mode == AudioViewMode::Waveform)) {
+            m_audio_view_mode = AudioViewMode::Waveform;
+        }
+        ImGui::SameLine();
+        if (ImGui::RadioButton(ICON_FA_CHART_AREA " Spectrogram", m_audio_view_mode == AudioViewMode::Spectrogram)) {
+            m_audio_view_mode = AudioViewMode::Spectrogram;
+            if (! m_current_media_spectrogram && m_current_media_filepath) {
+                requestSpectrogram(m_current_media_filepath.value());
+            }
+        }
+        if (m_audio_view_mode == AudioViewMode::Spectrogram && m_current_media_spectrogram && m_current_media_spectrogram->getProgress() < 1.0f) {
+            ImGui::SameLine();
+            ImGui::ProgressBar(m_current_media_spectrogram->getProgress(), {ImGui::GetContentRegionAvail().x, 0.0f});
+        }
+    }
+
+    void pollCurrentPreview() {
+        try {
+            std::optional<Image> image = m_image_loader.poll();
+            if (image && m_image_loader.isPending()) {
+
+                // Provisional embedded thumbnail, which must not be cached in place of the image.
+                m_current_media_image_preview = std::make_shared<const Image>(std::move(image.value()));
+            } else if (image) {
+                m_current_media_image_preview = cacheCurrentPreview(std::move(image.value()));
+            }
+        } catch (const std::runtime_error& re) {
+            std::cerr << re.what() << std::endl;
+        }
+    }
+
     void SelectableText(const std::string& text, bool fit_width = true) {
         if (fit_width) {
             ImGui::SetNextItemWidth(ImGui::GetContentRegionAvail().x);
@@ -1013,33 +2262,42 @@ private:
     }
 
     void labelButtonClickHandler() {
+        namespace fs = std::filesystem;
+        const std::string& destination_directory = (m_bias_value > 0.5f ? m_directory_configuration->classADirectory : m_directory_configuration->classBDirectory);
+
+        // The file being played is streamed from disk, so it is closed before it is moved.
+        if (m_directory_configuration->mediaType == MediaType::Audio) {
+            m_audio_player.close();
+        }
         moveFile(
             m_current_media_filepath.value(),
-            (m_bias_value > 0.5f ? m_directory_configuration->classADirectory : m_directory_configuration->classBDirectory),
+            destination_directory,
             [&](const std::string& error_message) {
                 m_error_moving_file_pop_up_message = error_message;
                 ImGui::OpenPopup(ERROR_MOVING_FILE_POPUP);
             }
         );
 
+        // The labeled file won't be previewed again, so its cached pages can go.
+        m_readahead.release(joinPaths(destination_directory, fs::path(m_current_media_filepath.value()).filename().string()));
+
         // Upldate the output file.
         updateOutputFile();
 
         // Load the next media for preview (if any).
         {
             std::lock_guard<std::mutex> lock(mutex_media_sources);
-            auto it = std::find(m_media_sources->begin(), m_media_sources->end(), m_current_media_filepath.value());
-            if (it != m_media_sources->end()) {
-                m_media_sources->erase(it);
-            }
+            m_media_sources->remove(m_current_media_filepath.value());
+            m_media_index.erase(m_current_media_filepath.value());
 
             // Load the next media for preview if available.
             // Otherwise, clear the media preview.
             if (!m_media_sources->empty()) {
-                loadCurrentPreviewAndFilepath(m_media_sources->front());
+                loadCurrentPreviewAndFilepath(m_media_sources->getFilepaths().front());
             } else {
                 clearCurrentPreviewAndFilepath();
             }
+            updatePrefetchQueue();
         }
     }
 
@@ -1063,6 +2321,10 @@ private:
         case SDLK_l:
             m_keyboard_label_button_pressed = true;
             break;
+
+        case SDLK_p:
+            m_audio_player.setPaused(! m_audio_player.isPaused());
+            break;
         }
     }
 };
@@ -0,0 +1,171 @@
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <stdexcept>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "mappedFile.h"
+#include "pixelArena.h"
+
+namespace {
+    std::atomic<size_t> g_mapped_bytes{ 0 };
+}
+
+MappedFile::MappedFile(const std::string& filepath) {
+    int fd = open(filepath.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw std::runtime_error("error: couldn't open file: " + filepath);
+    }
+
+    struct stat file_stat;
+    if (fstat(fd, &file_stat) != 0 || file_stat.st_size <= 0) {
+        close(fd);
+        throw std::runtime_error("error: couldn't read file: " + filepath);
+    }
+
+    void* data = mmap(nullptr, static_cast<size_t>(file_stat.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+
+    // The mapping keeps the file referenced on its own.
+    close(fd);
+    if (data == MAP_FAILED) {
+        throw std::runtime_error("error: couldn't map file: " + filepath);
+    }
+
+    m_data = static_cast<uint8_t*>(data);
+    m_size = static_cast<size_t>(file_stat.st_size);
+    g_mapped_bytes += m_size;
+    madvise(m_data, m_size, MADV_SEQUENTIAL);
+}
+
+MappedFile::~MappedFile() {
+    if (m_data) {
+        munmap(m_data, m_size);
+        g_mapped_bytes -= m_size;
+        m_data = nullptr;
+    }
+}
+
+const uint8_t* MappedFile::getData() const {
+    return m_data;
+}
+
+size_t MappedFile::getSize() const {
+    return m_size;
+}
+
+size_t MappedFile::getMappedBytes() {
+    return g_mapped_bytes.load();
+}
+
+MappedFile::MappedFile(MappedFile&& other) noexcept
+    : m_data(other.m_data), m_size(other.m_size) {
+    other.m_data = nullptr;
+    other.m_size = 0;
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept {
+    if (this != &other) {
+        if (m_data) {
+            munmap(m_data, m_size);
+            g_mapped_bytes -= m_size;
+        }
+
+        m_data = other.m_data;
+        m_size = other.m_size;
+
+        other.m_data = nullptr;
+        other.m_size = 0;
+    }
+    return *this;
+}
+
+FileContents::FileContents(const std::string& filepath) {
+    int fd = open(filepath.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw std::runtime_error("error: couldn't open file: " + filepath);
+    }
+
+    struct stat file_stat;
+    if (fstat(fd, &file_stat) != 0 || file_stat.st_size <= 0) {
+        close(fd);
+        throw std::runtime_error("error: couldn't read file: " + filepath);
+    }
+    const size_t size = static_cast<size_t>(file_stat.st_size);
+
+    m_data = static_cast<uint8_t*>(PixelArena::instance().allocate(size));
+    if (! m_data) {
+        close(fd);
+        throw std::runtime_error("error: couldn't allocate memory to read file: " + filepath);
+    }
+
+#if defined(POSIX_FADV_SEQUENTIAL) && ! defined(__APPLE__)
+    posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+
+    // A file truncated meanwhile ends early, which is an error like any other failed read.
+    size_t offset = 0;
+    while (offset < size) {
+        ssize_t count = pread(fd, m_data + offset, size - offset, static_cast<off_t>(offset));
+        if (count < 0 && errno == EINTR) {
+            continue;
+        }
+        if (count <= 0) {
+            close(fd);
+            PixelArena::instance().release(m_data);
+            m_data = nullptr;
+            throw std::runtime_error("error: couldn't read file: " + filepath);
+        }
+        offset += static_cast<size_t>(count);
+    }
+    close(fd);
+    m_size = size;
+}
+
+FileContents::~FileContents() {
+    if (m_data) {
+        PixelArena::instance().release(m_data);
+        m_data = nullptr;
+    }
+}
+
+const uint8_t* FileContents::getData() const {
+    return m_data;
+}
+
+size_t FileContents::getSize() const {
+    return m_size;
+}
+
+void adviseWillNeed(const std::string& filepath) {
+    int fd = open(filepath.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return;
+    }
+
+#if defined(__APPLE__)
+    struct stat file_stat;
+    if (fstat(fd, &file_stat) == 0 && file_stat.st_size > 0) {
+        struct radvisory advisory;
+        advisory.ra_offset = 0;
+        advisory.ra_count = static_cast<int>(std::min<off_t>(file_stat.st_size, INT32_MAX));
+        fcntl(fd, F_RDADVISE, &advisory);
+    }
+#elif defined(POSIX_FADV_WILLNEED)
+    posix_fadvise(fd, 0, 0, POSIX_FADV_WILLNEED);
+#endif
+
+    close(fd);
+}
+
+void adviseDontNeed(const std::string& filepath) {
+#if defined(POSIX_FADV_DONTNEED) && ! defined(__APPLE__)
+    int fd = open(filepath.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return;
+    }
+    posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+    close(fd);
+#endif
+}
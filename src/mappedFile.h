@@ -0,0 +1,75 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+/**
+ * @brief A read-only memory mapping of a whole file.
+ *
+ * Readers read straight from the mapping, so file contents are never copied into an intermediate
+ * buffer. The mapping is hinted as sequentially accessed so that the kernel reads ahead aggressively.
+ *
+ * Only for files that are replaced by renaming over them (e.g. the application's caches): accessing
+ * the mapping of a file truncated in place raises SIGBUS. Files of the user are read with FileContents.
+ */
+class MappedFile {
+public:
+
+    /**
+     * @throws std::runtime_error if the file can't be opened or mapped (e.g. it is empty).
+     */
+    explicit MappedFile(const std::string& filepath);
+    ~MappedFile();
+
+    const uint8_t* getData() const;
+    size_t getSize() const;
+
+    // Total size of all live mappings.
+    static size_t getMappedBytes();
+
+    // Disable copying MappedFile objects.
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    // Enable move semantics.
+    MappedFile(MappedFile&& other) noexcept;
+    MappedFile& operator=(MappedFile&& other) noexcept;
+
+private:
+    uint8_t*        m_data{ nullptr };
+    size_t          m_size{ 0 };
+};
+
+/**
+ * @brief The contents of a whole file, read into a buffer of the pixel arena.
+ *
+ * For files of the user (e.g. source images), which may be truncated in place while they are decoded
+ * (copied over, saved by an editor): reading them then fails with an error instead of crashing.
+ */
+class FileContents {
+public:
+
+    /**
+     * @throws std::runtime_error if the file can't be opened or read in full (e.g. it is empty, or was truncated meanwhile).
+     */
+    explicit FileContents(const std::string& filepath);
+    ~FileContents();
+
+    const uint8_t* getData() const;
+    size_t getSize() const;
+
+    // Disable copying FileContents objects.
+    FileContents(const FileContents&) = delete;
+    FileContents& operator=(const FileContents&) = delete;
+
+private:
+    uint8_t*        m_data{ nullptr };
+    size_t          m_size{ 0 };
+};
+
+// Asks the kernel to start reading the file into the page cache (errors are ignored, it is only a hint).
+void adviseWillNeed(const std::string& filepath);
+
+// Tells the kernel that the file's cached pages won't be needed anymore (no-op where unsupported, e.g. macOS).
+void adviseDontNeed(const std::string& filepath);
@@ -0,0 +1,573 @@
+#include <algorithm>
+#include <cctype>
+#include <filesystem>
+#include <functional>
+#include <future>
+#include <limits>
+#include <numeric>
+#include <thread>
+#include "mediaIndex.h"
+
+namespace {
+
+    // Below this many elements, sorting on a single thread is faster than splitting the work.
+    const size_t PARALLEL_MIN_SIZE = 64 * 1024;
+
+    std::string toLower(std::string text) {
+        std::transform(text.begin(), text.end(), text.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+        return text;
+    }
+
+    size_t getWorkerCount(size_t size) {
+        if (size < PARALLEL_MIN_SIZE) {
+            return 1;
+        }
+        return std::max<size_t>(1, std::min<size_t>(std::thread::hardware_concurrency(), size / PARALLEL_MIN_SIZE));
+    }
+
+    // Calls `work(first, last)` over contiguous chunks of [0, size) on separate threads.
+    template<typename Work>
+    void parallelFor(size_t size, Work work) {
+        const size_t worker_count = getWorkerCount(size);
+        const size_t chunk_size = (size + worker_count - 1) / std::max<size_t>(worker_count, 1);
+
+        std::vector<std::future<void>> futures;
+        for (size_t first = chunk_size; first < size; first += chunk_size) {
+            futures.push_back(std::async(std::launch::async, work, first, std::min(first + chunk_size, size)));
+        }
+        work(0, std::min(chunk_size, size));
+        for (std::future<void>& future : futures) {
+            future.get();
+        }
+    }
+
+    /**
+     * @brief Sorts chunks of the values on separate threads, then merges them pairwise (the merges of
+     * a round in parallel as well).
+     */
+    template<typename Compare>
+    void parallelSort(std::vector<uint32_t>& values, Compare compare) {
+        const size_t worker_count = getWorkerCount(values.size());
+        if (worker_count <= 1) {
+            std::sort(values.begin(), values.end(), compare);
+            return;
+        }
+
+        std::vector<size_t> bounds;
+        for (size_t i = 0; i <= worker_count; i++) {
+            bounds.push_back(values.size() * i / worker_count);
+        }
+
+        std::vector<std::future<void>> futures;
+        for (size_t i = 0; i + 1 < bounds.size(); i++) {
+            futures.push_back(std::async(std::launch::async, [&values, &compare, first = bounds[i], last = bounds[i + 1]] {
+                std::sort(values.begin() + first, values.begin() + last, compare);
+            }));
+        }
+        for (std::future<void>& future : futures) {
+            future.get();
+        }
+
+        while (bounds.size() > 2) {
+            std::vector<size_t> merged_bounds;
+            futures.clear();
+            for (size_t i = 0; i + 2 < bounds.size(); i += 2) {
+                futures.push_back(std::async(std::launch::async, [&values, &compare, first = bounds[i], middle = bounds[i + 1], last = bounds[i + 2]] {
+                    std::inplace_merge(values.begin() + first, values.begin() + middle, values.begin() + last, compare);
+                }));
+                merged_bounds.push_back(bounds[i]);
+            }
+
+            // With an odd number of chunks, the last one is merged in the next round.
+            if (bounds.size() % 2 == 0) {
+                merged_bounds.push_back(bounds[bounds.size() - 2]);
+            }
+            merged_bounds.push_back(bounds.back());
+
+            for (std::future<void>& future : futures) {
+                future.get();
+            }
+            bounds.swap(merged_bounds);
+        }
+    }
+
+    // Orders rows by a value of theirs, ties broken by row so that the order doesn't depend on the sort algorithm.
+    template<typename Value>
+    auto orderBy(Value value) {
+        return [value](uint32_t a, uint32_t b) {
+            const auto& value_a = value(a);
+            const auto& value_b = value(b);
+            return value_a < value_b || (value_a == value_b && a < b);
+        };
+    }
+
+    // Parses a number with an optional size suffix (k, kb, m, mb, g, gb). Returns `std::nullopt` if it isn't one.
+    std::optional<int64_t> parseQuantity(const std::string& text) {
+        size_t digits = 0;
+        while (digits < text.size() && std::isdigit(static_cast<unsigned char>(text[digits]))) {
+            digits++;
+        }
+        if (digits == 0 || digits > 18) {
+            return std::nullopt;
+        }
+
+        int64_t value = std::stoll(text.substr(0, digits));
+        const std::string suffix = text.substr(digits);
+        int64_t multiplier;
+        if (suffix.empty() || suffix == "b") { multiplier = 1; }
+        else if (suffix == "k" || suffix == "kb") { multiplier = 1024; }
+        else if (suffix == "m" || suffix == "mb") { multiplier = 1024 * 1024; }
+        else if (suffix == "g" || suffix == "gb") { multiplier = 1024 * 1024 * 1024; }
+        else { return std::nullopt; }
+
+        // Quantities that do not fit are not a comparison, so the term is left to match names.
+        if (value > std::numeric_limits<int64_t>::max() / multiplier) {
+            return std::nullopt;
+        }
+        return value * multiplier;
+    }
+
+    // Applies `field <op> value` to the inclusive bounds of the field.
+    bool applyComparison(const std::string& op, int64_t value, int64_t& min, int64_t& max) {
+        if (op == "<")  { max = std::min(max, value - 1); return true; }
+        if (op == "<=") { max = std::min(max, value); return true; }
+        if (op == ">")  { min = std::max(min, value + 1); return true; }
+        if (op == ">=") { min = std::max(min, value); return true; }
+        if (op == "=")  { min = std::max(min, value); max = std::min(max, value); return true; }
+        return false;
+    }
+
+    void readFileStat(const std::string& filepath, uint64_t& file_size, int64_t& modification_time) {
+        namespace fs = std::filesystem;
+
+        std::error_code error;
+        fs::directory_entry entry(filepath, error);
+        if (! error) {
+            uintmax_t size = entry.file_size(error);
+            file_size = error ? 0 : size;
+            fs::file_time_type time = entry.last_write_time(error);
+            modification_time = error ? 0 : time.time_since_epoch().count();
+        }
+    }
+}
+
+const char* getMediaSortKeyName(MediaSortKey key) {
+    switch (key) {
+        case MediaSortKey::DirectoryOrder:      return "Directory Order";
+        case MediaSortKey::Name:                return "Name";
+        case MediaSortKey::Width:               return "Width";
+        case MediaSortKey::Height:              return "Height";
+        case MediaSortKey::PixelCount:          return "Pixel Count";
+        case MediaSortKey::FileSize:            return "File Size";
+        case MediaSortKey::ModificationTime:    return "Modification Time";
+        case MediaSortKey::Extension:           return "Extension";
+    }
+    return "Unknown";
+}
+
+bool MediaFilter::constrainsDimensions() const {
+    return min_width > 0 || max_width != std::numeric_limits<int64_t>::max()
+        || min_height > 0 || max_height != std::numeric_limits<int64_t>::max();
+}
+
+MediaFilter parseMediaFilter(const std::string& text) {
+    MediaFilter filter;
+    std::vector<std::string> name_terms;
+
+    size_t position = 0;
+    const std::string lowercase_text = toLower(text);
+    while (position < lowercase_text.size()) {
+        size_t begin = lowercase_text.find_first_not_of(" \t", position);
+        if (begin == std::string::npos) {
+            break;
+        }
+        size_t end = lowercase_text.find_first_of(" \t", begin);
+        if (end == std::string::npos) {
+            end = lowercase_text.size();
+        }
+        const std::string term = lowercase_text.substr(begin, end - begin);
+        position = end;
+
+        if (term.size() > 1 && term[0] == '.') {
+            filter.extensions.push_back(term);
+            continue;
+        }
+        if (term.rfind("ext:", 0) == 0 && term.size() > 4) {
+            filter.extensions.push_back("." + term.substr(4));
+            continue;
+        }
+
+        // field <op> value
+        size_t op_begin = term.find_first_of("<>=");
+        if (op_begin != std::string::npos && op_begin > 0) {
+            size_t op_end = term.find_first_not_of("<>=", op_begin);
+            const std::string field = term.substr(0, op_begin);
+            const std::string op = term.substr(op_begin, (op_end == std::string::npos ? term.size() : op_end) - op_begin);
+            std::optional<int64_t> value = op_end == std::string::npos ? std::nullopt : parseQuantity(term.substr(op_end));
+
+            bool applied = false;
+            if (value) {
+                if (field == "width" || field == "w") {
+                    applied = applyComparison(op, value.value(), filter.min_width, filter.max_width);
+                } else if (field == "height" || field == "h") {
+                    applied = applyComparison(op, value.value(), filter.min_height, filter.max_height);
+                } else if (field == "size") {
+                    applied = applyComparison(op, value.value(), filter.min_file_size, filter.max_file_size);
+                }
+            }
+            if (applied) {
+                continue;
+            }
+        }
+
+        name_terms.push_back(term);
+    }
+
+    // Name terms are matched as a single substring, so that names with spaces can be looked for.
+    for (size_t i = 0; i < name_terms.size(); i++) {
+        filter.name += (i > 0 ? " " : "") + name_terms[i];
+    }
+    return filter;
+}
+
+MediaFileStats readMediaFileStats(std::vector<std::string> filepaths) {
+    MediaFileStats stats;
+    stats.file_sizes.assign(filepaths.size(), 0);
+    stats.modification_times.assign(filepaths.size(), 0);
+    parallelFor(filepaths.size(), [&stats, &filepaths](size_t first, size_t last) {
+        for (size_t i = first; i < last; i++) {
+            readFileStat(filepaths[i], stats.file_sizes[i], stats.modification_times[i]);
+        }
+    });
+    stats.filepaths = std::move(filepaths);
+    return stats;
+}
+
+void MediaIndex::rebuild(const std::vector<std::string>& filepaths, const MediaProber& prober) {
+    reset(filepaths);
+    for (uint32_t row = 0; row < m_filepaths.size(); row++) {
+        readDimensions(row, prober);
+    }
+}
+
+void MediaIndex::rebuild(const std::vector<std::string>& filepaths, const std::vector<uint64_t>& file_sizes, const std::vector<int64_t>& modification_times, const MediaProber& prober) {
+    reset(filepaths);
+    const size_t row_count = m_filepaths.size();
+    std::copy_n(file_sizes.begin(), std::min(file_sizes.size(), row_count), m_file_sizes.begin());
+    std::copy_n(modification_times.begin(), std::min(modification_times.size(), row_count), m_modification_times.begin());
+    for (uint32_t row = 0; row < row_count; row++) {
+        readDimensions(row, prober);
+    }
+}
+
+void MediaIndex::insert(const std::string& filepath, const MediaProber& prober) {
+    uint32_t row = 0;
+    auto it = m_rows.find(filepath);
+    if (it != m_rows.end()) {
+        row = it->second;
+        if (m_erased[row]) {
+            m_erased[row] = 0;
+            m_erased_count--;
+        }
+    } else {
+        row = static_cast<uint32_t>(m_filepaths.size());
+        m_filepaths.push_back(filepath);
+        m_lowercase_filenames.emplace_back();
+        m_extension_ids.push_back(0);
+        m_widths.push_back(0);
+        m_heights.push_back(0);
+        m_file_sizes.push_back(0);
+        m_modification_times.push_back(0);
+        m_erased.push_back(0);
+        m_rows.emplace(filepath, row);
+        readName(row);
+    }
+    readFile(row, prober);
+    invalidateRow(row, COLUMN_DIMENSIONS | COLUMN_FILES);
+}
+
+bool MediaIndex::applyProbeResults(const std::vector<std::pair<std::string, MediaProbeResult>>& results) {
+    bool changed = false;
+    for (const auto& [filepath, result] : results) {
+        auto it = m_rows.find(filepath);
+        if (it == m_rows.end()) {
+            continue;
+        }
+        uint32_t row = it->second;
+        if (m_widths[row] != result.width || m_heights[row] != result.height) {
+            m_widths[row] = result.width;
+            m_heights[row] = result.height;
+            invalidateRow(row, COLUMN_DIMENSIONS);
+            changed = true;
+        }
+    }
+    return changed;
+}
+
+bool MediaIndex::applyFileStats(const MediaFileStats& stats) {
+    bool changed = false;
+    for (size_t i = 0; i < stats.filepaths.size(); i++) {
+        auto it = m_rows.find(stats.filepaths[i]);
+        if (it == m_rows.end()) {
+            continue;
+        }
+
+        // Rows read by insert() in the meantime are more recent than the stats.
+        uint32_t row = it->second;
+        if (m_file_sizes[row] != 0 || m_modification_times[row] != 0) {
+            continue;
+        }
+        m_file_sizes[row] = stats.file_sizes[i];
+        m_modification_times[row] = stats.modification_times[i];
+        invalidateRow(row, COLUMN_FILES);
+        changed = true;
+    }
+    return changed;
+}
+
+void MediaIndex::erase(const std::string& filepath) {
+    auto it = m_rows.find(filepath);
+    if (it == m_rows.end() || m_erased[it->second]) {
+        return;
+    }
+    m_erased[it->second] = 1;
+    m_erased_count++;
+
+    // Permutations still hold, only the query result has to skip the row.
+    m_last_query = std::nullopt;
+}
+
+void MediaIndex::clear() {
+    m_filepaths.clear();
+    m_lowercase_filenames.clear();
+    m_extension_ids.clear();
+    m_widths.clear();
+    m_heights.clear();
+    m_file_sizes.clear();
+    m_modification_times.clear();
+    m_erased.clear();
+    m_erased_count = 0;
+    m_extensions.clear();
+    m_rows.clear();
+    invalidate(COLUMN_DIMENSIONS | COLUMN_FILES);
+}
+
+std::pair<uint64_t, int64_t> MediaIndex::getFileStat(const std::string& filepath) const {
+    auto it = m_rows.find(filepath);
+    if (it == m_rows.end()) {
+        return {0, 0};
+    }
+    return {m_file_sizes[it->second], m_modification_times[it->second]};
+}
+
+size_t MediaIndex::size() const {
+    return m_filepaths.size();
+}
+
+size_t MediaIndex::getFileCount() const {
+    return m_filepaths.size() - m_erased_count;
+}
+
+const std::vector<std::string>& MediaIndex::getFilepaths() const {
+    return m_filepaths;
+}
+
+const std::vector<uint32_t>& MediaIndex::query(const MediaFilter& filter, MediaSortKey key, bool descending) {
+    if (m_last_query && m_last_query->filter == filter && m_last_query->key == key && m_last_query->descending == descending) {
+        return m_last_query_rows;
+    }
+
+    const std::vector<uint32_t>& permutation = getPermutation(key);
+
+    // Filtering is a single pass over the columns, split across threads for large indexes.
+    std::vector<uint8_t> matching(permutation.size());
+    parallelFor(permutation.size(), [this, &filter, &matching](size_t first, size_t last) {
+        for (size_t row = first; row < last; row++) {
+            matching[row] = ! m_erased[row] && matches(static_cast<uint32_t>(row), filter);
+        }
+    });
+
+    m_last_query_rows.clear();
+    if (descending) {
+        std::copy_if(permutation.rbegin(), permutation.rend(), std::back_inserter(m_last_query_rows), [&matching](uint32_t row) { return matching[row]; });
+    } else {
+        std::copy_if(permutation.begin(), permutation.end(), std::back_inserter(m_last_query_rows), [&matching](uint32_t row) { return matching[row]; });
+    }
+    m_last_query = Query{filter, key, descending};
+    return m_last_query_rows;
+}
+
+void MediaIndex::invalidate(uint32_t columns) {
+    for (int32_t key = 0; key < MEDIA_SORT_KEY_COUNT; key++) {
+        if (columns & getColumns(static_cast<MediaSortKey>(key))) {
+            m_permutations[key].clear();
+            m_stale_rows[key].clear();
+        }
+    }
+    m_last_query = std::nullopt;
+}
+
+void MediaIndex::invalidateRow(uint32_t row, uint32_t columns) {
+    for (int32_t key = 0; key < MEDIA_SORT_KEY_COUNT; key++) {
+        if (m_permutations[key].empty() || ! (columns & getColumns(static_cast<MediaSortKey>(key)))) {
+            continue;
+        }
+
+        // Once most rows have changed, sorting them all again is cheaper than merging.
+        if (m_stale_rows[key].size() >= m_filepaths.size() / 2) {
+            m_permutations[key].clear();
+            m_stale_rows[key].clear();
+        } else {
+            m_stale_rows[key].push_back(row);
+        }
+    }
+    m_last_query = std::nullopt;
+}
+
+uint32_t MediaIndex::getColumns(MediaSortKey key) {
+    switch (key) {
+        case MediaSortKey::Width:
+        case MediaSortKey::Height:
+        case MediaSortKey::PixelCount:
+            return COLUMN_DIMENSIONS | COLUMN_FILES;
+        default:
+            return COLUMN_FILES;
+    }
+}
+
+const std::vector<uint32_t>& MediaIndex::getPermutation(MediaSortKey key) {
+    std::vector<uint32_t>& permutation = m_permutations[static_cast<size_t>(key)];
+    std::vector<uint32_t>& stale_rows = m_stale_rows[static_cast<size_t>(key)];
+    if (permutation.empty()) {
+        permutation.resize(m_filepaths.size());
+        std::iota(permutation.begin(), permutation.end(), 0);
+        withRowOrder(key, [&permutation](auto compare) { parallelSort(permutation, compare); });
+        return permutation;
+    }
+    if (stale_rows.empty()) {
+        return permutation;
+    }
+
+    // The stale rows are taken out (new ones aren't in yet), sorted on their own, then merged back in.
+    std::sort(stale_rows.begin(), stale_rows.end());
+    stale_rows.erase(std::unique(stale_rows.begin(), stale_rows.end()), stale_rows.end());
+    std::vector<uint8_t> stale(m_filepaths.size(), 0);
+    for (uint32_t row : stale_rows) {
+        stale[row] = 1;
+    }
+    permutation.erase(std::remove_if(permutation.begin(), permutation.end(), [&stale](uint32_t row) { return stale[row]; }), permutation.end());
+
+    std::vector<uint32_t> merged(m_filepaths.size());
+    withRowOrder(key, [&permutation, &stale_rows, &merged](auto compare) {
+        std::sort(stale_rows.begin(), stale_rows.end(), compare);
+        std::merge(permutation.begin(), permutation.end(), stale_rows.begin(), stale_rows.end(), merged.begin(), compare);
+    });
+    permutation.swap(merged);
+    stale_rows.clear();
+    return permutation;
+}
+
+template<typename Work>
+void MediaIndex::withRowOrder(MediaSortKey key, Work work) const {
+    switch (key) {
+        case MediaSortKey::DirectoryOrder:
+            work(std::less<uint32_t>());
+            break;
+        case MediaSortKey::Name:
+            work(orderBy([this](uint32_t row) -> const std::string& { return m_lowercase_filenames[row]; }));
+            break;
+        case MediaSortKey::Width:
+            work(orderBy([this](uint32_t row) { return m_widths[row]; }));
+            break;
+        case MediaSortKey::Height:
+            work(orderBy([this](uint32_t row) { return m_heights[row]; }));
+            break;
+        case MediaSortKey::PixelCount:
+            work(orderBy([this](uint32_t row) { return static_cast<int64_t>(m_widths[row]) * m_heights[row]; }));
+            break;
+        case MediaSortKey::FileSize:
+            work(orderBy([this](uint32_t row) { return m_file_sizes[row]; }));
+            break;
+        case MediaSortKey::ModificationTime:
+            work(orderBy([this](uint32_t row) { return m_modification_times[row]; }));
+            break;
+        case MediaSortKey::Extension: {
+
+            // Extension ids are in order of appearance, so they are ranked by name first.
+            std::vector<uint32_t> ranks(m_extensions.size());
+            std::vector<uint32_t> by_name(m_extensions.size());
+            std::iota(by_name.begin(), by_name.end(), 0);
+            std::sort(by_name.begin(), by_name.end(), [this](uint32_t a, uint32_t b) { return m_extensions[a] < m_extensions[b]; });
+            for (uint32_t rank = 0; rank < by_name.size(); rank++) {
+                ranks[by_name[rank]] = rank;
+            }
+            work(orderBy([this, &ranks](uint32_t row) { return ranks[m_extension_ids[row]]; }));
+            break;
+        }
+    }
+}
+
+void MediaIndex::reset(const std::vector<std::string>& filepaths) {
+    clear();
+    const size_t row_count = filepaths.size();
+    m_filepaths = filepaths;
+    m_lowercase_filenames.resize(row_count);
+    m_extension_ids.resize(row_count);
+    m_widths.assign(row_count, 0);
+    m_heights.assign(row_count, 0);
+    m_file_sizes.assign(row_count, 0);
+    m_modification_times.assign(row_count, 0);
+    m_erased.assign(row_count, 0);
+
+    m_rows.reserve(row_count);
+    for (uint32_t row = 0; row < row_count; row++) {
+        readName(row);
+        m_rows.emplace(m_filepaths[row], row);
+    }
+}
+
+void MediaIndex::readName(uint32_t row) {
+    std::filesystem::path path(m_filepaths[row]);
+    m_lowercase_filenames[row] = toLower(path.filename().string());
+
+    const std::string extension = toLower(path.extension().string());
+    auto it = std::find(m_extensions.begin(), m_extensions.end(), extension);
+    if (it == m_extensions.end()) {
+        it = m_extensions.insert(m_extensions.end(), extension);
+    }
+    m_extension_ids[row] = static_cast<uint16_t>(it - m_extensions.begin());
+}
+
+void MediaIndex::readFile(uint32_t row, const MediaProber& prober) {
+    readFileStat(m_filepaths[row], m_file_sizes[row], m_modification_times[row]);
+    readDimensions(row, prober);
+}
+
+void MediaIndex::readDimensions(uint32_t row, const MediaProber& prober) {
+    std::optional<MediaProbeResult> result = prober.find(m_filepaths[row]);
+    m_widths[row] = result ? result->width : 0;
+    m_heights[row] = result ? result->height : 0;
+}
+
+bool MediaIndex::matches(uint32_t row, const MediaFilter& filter) const {
+    const int64_t file_size = static_cast<int64_t>(m_file_sizes[row]);
+    if (file_size < filter.min_file_size || file_size > filter.max_file_size) {
+        return false;
+    }
+    if (filter.constrainsDimensions()) {
+        if (m_widths[row] <= 0) {
+            return false;
+        }
+        if (m_widths[row] < filter.min_width || m_widths[row] > filter.max_width || m_heights[row] < filter.min_height || m_heights[row] > filter.max_height) {
+            return false;
+        }
+    }
+    if (! filter.extensions.empty()
+        && std::find(filter.extensions.begin(), filter.extensions.end(), m_extensions[m_extension_ids[row]]) == filter.extensions.end()) {
+        return false;
+    }
+    if (! filter.name.empty() && m_lowercase_filenames[row].find(filter.name) == std::string::npos) {
+        return false;
+    }
+    return true;
+}
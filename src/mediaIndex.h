@@ -0,0 +1,169 @@
+#pragma once
+
+#include <cstdint>
+#include <limits>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "mediaProbe.h"
+
+enum class MediaSortKey: int32_t {
+    DirectoryOrder = 0,
+    Name = 1,
+    Width = 2,
+    Height = 3,
+    PixelCount = 4,
+    FileSize = 5,
+    ModificationTime = 6,
+    Extension = 7
+};
+
+const int32_t MEDIA_SORT_KEY_COUNT = 8;
+
+const char* getMediaSortKeyName(MediaSortKey key);
+
+// Which files of a MediaIndex are shown. Bounds are inclusive; dimension bounds exclude files that haven't been probed yet.
+struct MediaFilter {
+    std::string                 name;                   // Lowercase substring of the file name.
+    std::vector<std::string>    extensions;             // Lowercase, with the dot. Empty means any.
+    int64_t                     min_width{ 0 };
+    int64_t                     max_width{ std::numeric_limits<int64_t>::max() };
+    int64_t                     min_height{ 0 };
+    int64_t                     max_height{ std::numeric_limits<int64_t>::max() };
+    int64_t                     min_file_size{ 0 };
+    int64_t                     max_file_size{ std::numeric_limits<int64_t>::max() };
+
+    bool operator==(const MediaFilter& other) const = default;
+
+    bool constrainsDimensions() const;
+};
+
+/**
+ * @brief Parses a filter typed by the user, made of whitespace separated terms that must all match:
+ *
+ * - `width<512`, `height>=1080`, `w=64`, `h<=100` (also `>`, `<`, `>=`, `<=`, `=`)
+ * - `size>2mb`, `size<500k` (bytes, with optional k/kb, m/mb, g/gb suffixes)
+ * - `.png` or `ext:png` (any of the listed extensions)
+ * - anything else matches as part of the file name (case insensitive)
+ */
+MediaFilter parseMediaFilter(const std::string& text);
+
+// Sizes and modification times of files, read off the UI thread and then applied to a MediaIndex.
+struct MediaFileStats {
+    std::vector<std::string>    filepaths;
+    std::vector<uint64_t>       file_sizes;             // 0 for files that couldn't be read.
+    std::vector<int64_t>        modification_times;     // In file clock ticks, 0 for files that couldn't be read.
+};
+
+// Reads the size and modification time of every file (in parallel, a stat per file dominates for large directories).
+MediaFileStats readMediaFileStats(std::vector<std::string> filepaths);
+
+/**
+ * @brief A columnar (struct of arrays) index of the files of a directory, for filtering and sorting them.
+ *
+ * Every column holds one value per file, so filtering touches only the columns it needs and sorting
+ * compares plain integers. Sorted permutations are computed (in parallel for large indexes) once per
+ * sort key and cached. Rows inserted or changed afterwards are sorted on their own and merged into the
+ * cached permutations on the next query that needs them, so files streaming in don't cost a full sort
+ * each. The result of the last query is cached as well. Not thread safe: guard it like the file list it
+ * mirrors.
+ */
+class MediaIndex {
+public:
+    // Replaces the indexed files, taking dimensions from the prober. Sizes and modification times stay zero until applyFileStats().
+    void rebuild(const std::vector<std::string>& filepaths, const MediaProber& prober);
+
+    // Same as above, with sizes and modification times already known (e.g. from a persisted directory index), so without touching the files.
+    void rebuild(const std::vector<std::string>& filepaths, const std::vector<uint64_t>& file_sizes, const std::vector<int64_t>& modification_times, const MediaProber& prober);
+
+    // Fills in the dimensions of the files among the given probe results. Returns whether any row changed.
+    bool applyProbeResults(const std::vector<std::pair<std::string, MediaProbeResult>>& results);
+
+    // Fills in the sizes and modification times of indexed files not read since (by insert()). Returns whether any row changed.
+    bool applyFileStats(const MediaFileStats& stats);
+
+    // Adds a file, or reads the size, modification time and dimensions of one already indexed again.
+    void insert(const std::string& filepath, const MediaProber& prober);
+
+    // Hides a file (e.g. once it has been labeled) without invalidating the cached permutations.
+    void erase(const std::string& filepath);
+
+    void clear();
+
+    // Size and modification time (in file clock ticks) of an indexed file, zeros if it isn't indexed.
+    std::pair<uint64_t, int64_t> getFileStat(const std::string& filepath) const;
+
+    // Number of rows, including erased ones.
+    size_t size() const;
+
+    // Number of files that haven't been erased.
+    size_t getFileCount() const;
+
+    // File paths of all rows, indexed by row (erased rows are kept, query() skips them).
+    const std::vector<std::string>& getFilepaths() const;
+
+    /**
+     * @brief Returns the rows of the files matching the filter, in sort order.
+     * The reference stays valid until the next call of a non-const method.
+     */
+    const std::vector<uint32_t>& query(const MediaFilter& filter, MediaSortKey key, bool descending);
+
+private:
+    enum Column: uint32_t {
+        COLUMN_DIMENSIONS = 1 << 0,
+        COLUMN_FILES = 1 << 1          // Everything read when the index is rebuilt.
+    };
+
+    // Marks the columns as changed, dropping permutations and query results depending on them.
+    void invalidate(uint32_t columns);
+
+    // Marks the columns of a row as changed: permutations depending on them move the row on their next use.
+    void invalidateRow(uint32_t row, uint32_t columns);
+
+    // Clears the index, then sizes the columns for the files and fills in the columns read from their paths.
+    void reset(const std::vector<std::string>& filepaths);
+
+    // Fill in the columns of a row from its file path, from the file itself, respectively from the prober.
+    void readName(uint32_t row);
+    void readFile(uint32_t row, const MediaProber& prober);
+    void readDimensions(uint32_t row, const MediaProber& prober);
+
+    // Columns the permutation of the key depends on.
+    static uint32_t getColumns(MediaSortKey key);
+
+    const std::vector<uint32_t>& getPermutation(MediaSortKey key);
+
+    // Calls `work(compare)` with the order of rows by the key, ties broken by row.
+    template<typename Work>
+    void withRowOrder(MediaSortKey key, Work work) const;
+
+    bool matches(uint32_t row, const MediaFilter& filter) const;
+
+    std::vector<std::string>                            m_filepaths;
+    std::vector<std::string>                            m_lowercase_filenames;
+    std::vector<uint16_t>                               m_extension_ids;
+    std::vector<int32_t>                                m_widths;           // 0 until probed.
+    std::vector<int32_t>                                m_heights;
+    std::vector<uint64_t>                               m_file_sizes;
+    std::vector<int64_t>                                m_modification_times;
+    std::vector<uint8_t>                                m_erased;
+    size_t                                              m_erased_count{ 0 };
+
+    std::vector<std::string>                            m_extensions;       // Lowercase, indexed by extension id.
+    std::unordered_map<std::string, uint32_t>           m_rows;
+
+    // Ascending permutations by sort key, empty until needed, and the rows each has yet to (re)place.
+    std::vector<std::vector<uint32_t>>                  m_permutations{ MEDIA_SORT_KEY_COUNT };
+    std::vector<std::vector<uint32_t>>                  m_stale_rows{ MEDIA_SORT_KEY_COUNT };
+
+    struct Query {
+        MediaFilter                                     filter;
+        MediaSortKey                                    key;
+        bool                                            descending;
+    };
+    std::optional<Query>                                m_last_query;
+    std::vector<uint32_t>                               m_last_query_rows;
+};
@@ -0,0 +1,246 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <stb_image.h>
+#include "mediaProbe.h"
+
+namespace {
+
+    // Bytes read from the end of a file to look for the marker its format ends with.
+    const long TRAILER_SEARCH_BYTES = 4096;
+
+    bool startsWith(const uint8_t* data, size_t size, const uint8_t* prefix, size_t prefix_size) {
+        return size >= prefix_size && std::memcmp(data, prefix, prefix_size) == 0;
+    }
+
+    bool contains(const std::vector<uint8_t>& data, const uint8_t* pattern, size_t pattern_size) {
+        return std::search(data.begin(), data.end(), pattern, pattern + pattern_size) != data.end();
+    }
+
+    /**
+     * @brief Checks that a JPEG ends with an end of image marker and a PNG with its IEND chunk.
+     * Other formats don't have a marker worth checking, so they always pass.
+     */
+    bool hasExpectedTrailer(FILE* file, uintmax_t file_size) {
+        const uint8_t JPEG_SIGNATURE[] = {0xFF, 0xD8};
+        const uint8_t JPEG_END_OF_IMAGE[] = {0xFF, 0xD9};
+        const uint8_t PNG_SIGNATURE[] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+        const uint8_t PNG_END[] = {'I', 'E', 'N', 'D'};
+
+        uint8_t signature[8] = {};
+        std::fseek(file, 0, SEEK_SET);
+        size_t signature_size = std::fread(signature, 1, sizeof(signature), file);
+
+        const bool jpeg = startsWith(signature, signature_size, JPEG_SIGNATURE, sizeof(JPEG_SIGNATURE));
+        const bool png = startsWith(signature, signature_size, PNG_SIGNATURE, sizeof(PNG_SIGNATURE));
+        if (! jpeg && ! png) {
+            return true;
+        }
+
+        // Some cameras append metadata after the end of the image, hence searching a few KiB rather than the last bytes.
+        const long trailer_size = static_cast<long>(std::min<uintmax_t>(file_size, TRAILER_SEARCH_BYTES));
+        std::vector<uint8_t> trailer(static_cast<size_t>(trailer_size));
+        std::fseek(file, -trailer_size, SEEK_END);
+        trailer.resize(std::fread(trailer.data(), 1, trailer.size(), file));
+
+        return jpeg ? contains(trailer, JPEG_END_OF_IMAGE, sizeof(JPEG_END_OF_IMAGE)) : contains(trailer, PNG_END, sizeof(PNG_END));
+    }
+}
+
+const char* getMediaProbeStatusDescription(MediaProbeStatus status) {
+    switch (status) {
+        case MediaProbeStatus::Valid:       return "Valid";
+        case MediaProbeStatus::Unreadable:  return "Unreadable (not a supported image)";
+        case MediaProbeStatus::Truncated:   return "Truncated (incomplete file)";
+        case MediaProbeStatus::Oversized:   return "Oversized (too large to decode)";
+    }
+    return "Unknown";
+}
+
+MediaProbeResult probeImageFile(const std::string& filepath, size_t max_pixel_count) {
+    MediaProbeResult result;
+
+    std::error_code error;
+    result.file_size = std::filesystem::file_size(filepath, error);
+    if (error || result.file_size == 0) {
+        result.file_size = 0;
+        result.status = MediaProbeStatus::Unreadable;
+        return result;
+    }
+
+    FILE* file = std::fopen(filepath.c_str(), "rb");
+    if (! file) {
+        result.status = MediaProbeStatus::Unreadable;
+        return result;
+    }
+
+    // stb_image only reads as much of the file as the header takes, and puts the file position back.
+    int width = 0;
+    int height = 0;
+    int channels = 0;
+    if (! stbi_info_from_file(file, &width, &height, &channels)) {
+        std::fclose(file);
+        result.status = MediaProbeStatus::Unreadable;
+        return result;
+    }
+    result.width = width;
+    result.height = height;
+    result.channels = channels;
+    result.bit_depth = stbi_is_hdr_from_file(file) ? 32 : (stbi_is_16_bit_from_file(file) ? 16 : 8);
+
+    if (static_cast<size_t>(width) * static_cast<size_t>(height) > max_pixel_count) {
+        result.status = MediaProbeStatus::Oversized;
+    } else if (! hasExpectedTrailer(file, result.file_size)) {
+        result.status = MediaProbeStatus::Truncated;
+    }
+
+    std::fclose(file);
+    return result;
+}
+
+MediaProber::MediaProber(ThreadPool& thread_pool, size_t batch_size, size_t max_pixel_count)
+    : m_thread_pool(thread_pool), m_batch_size(std::max<size_t>(batch_size, 1)), m_max_pixel_count(max_pixel_count),
+      m_state(std::make_shared<State>()), m_cancelled(std::make_shared<std::atomic<bool>>(false)) {}
+
+MediaProber::~MediaProber() {
+    m_cancelled->store(true);
+}
+
+void MediaProber::probe(const std::vector<std::string>& filepaths) {
+    std::shared_ptr<State> state;
+    std::shared_ptr<std::atomic<bool>> cancelled;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        state = m_state;
+        cancelled = m_cancelled;
+    }
+
+    std::vector<std::string> unprobed;
+    {
+        std::lock_guard<std::mutex> lock(state->mutex);
+        for (const std::string& filepath : filepaths) {
+            if (! state->results.contains(filepath) && state->pending.insert(filepath).second) {
+                unprobed.push_back(filepath);
+            }
+        }
+    }
+
+    // Batches amortize the task overhead, many of them keep every worker busy.
+    const size_t max_pixel_count = m_max_pixel_count;
+    for (size_t first = 0; first < unprobed.size(); first += m_batch_size) {
+        size_t last = std::min(first + m_batch_size, unprobed.size());
+        std::vector<std::string> batch(unprobed.begin() + first, unprobed.begin() + last);
+
+        m_thread_pool.submit([batch = std::move(batch), state, cancelled, max_pixel_count] {
+            for (const std::string& filepath : batch) {
+                if (cancelled->load()) {
+                    return;
+                }
+                MediaProbeResult result = probeImageFile(filepath, max_pixel_count);
+
+                // Files invalidated while being probed are left for the next probe().
+                std::lock_guard<std::mutex> lock(state->mutex);
+                if (state->pending.erase(filepath)) {
+                    state->results[filepath] = result;
+                    state->completed.emplace_back(filepath, result);
+                    if (result.isFlagged()) {
+                        state->flagged_count++;
+                    }
+                }
+            }
+        });
+    }
+}
+
+std::optional<MediaProbeResult> MediaProber::find(const std::string& filepath) const {
+    std::shared_ptr<State> state;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        state = m_state;
+    }
+
+    std::lock_guard<std::mutex> lock(state->mutex);
+    auto it = state->results.find(filepath);
+    if (it == state->results.end()) {
+        return std::nullopt;
+    }
+    return it->second;
+}
+
+bool MediaProber::isFlagged(const std::string& filepath) const {
+    std::optional<MediaProbeResult> result = find(filepath);
+    return result && result->isFlagged();
+}
+
+std::vector<std::pair<std::string, MediaProbeResult>> MediaProber::takeCompleted() {
+    std::shared_ptr<State> state;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        state = m_state;
+    }
+
+    std::vector<std::pair<std::string, MediaProbeResult>> completed;
+    std::lock_guard<std::mutex> lock(state->mutex);
+    completed.swap(state->completed);
+    return completed;
+}
+
+void MediaProber::seed(const std::vector<std::pair<std::string, MediaProbeResult>>& results) {
+    std::shared_ptr<State> state;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        state = m_state;
+    }
+
+    std::lock_guard<std::mutex> lock(state->mutex);
+    state->results.reserve(state->results.size() + results.size());
+    for (const auto& [filepath, result] : results) {
+        if (! state->pending.contains(filepath) && state->results.emplace(filepath, result).second && result.isFlagged()) {
+            state->flagged_count++;
+        }
+    }
+}
+
+void MediaProber::invalidate(const std::string& filepath) {
+    std::shared_ptr<State> state;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        state = m_state;
+    }
+
+    std::lock_guard<std::mutex> lock(state->mutex);
+    state->pending.erase(filepath);
+    auto it = state->results.find(filepath);
+    if (it != state->results.end()) {
+        if (it->second.isFlagged()) {
+            state->flagged_count--;
+        }
+        state->results.erase(it);
+    }
+}
+
+void MediaProber::clear() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_cancelled->store(true);
+    m_cancelled = std::make_shared<std::atomic<bool>>(false);
+    m_state = std::make_shared<State>();
+}
+
+size_t MediaProber::getProbedCount() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    std::lock_guard<std::mutex> state_lock(m_state->mutex);
+    return m_state->results.size();
+}
+
+size_t MediaProber::getPendingCount() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    std::lock_guard<std::mutex> state_lock(m_state->mutex);
+    return m_state->pending.size();
+}
+
+size_t MediaProber::getFlaggedCount() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    std::lock_guard<std::mutex> state_lock(m_state->mutex);
+    return m_state->flagged_count;
+}
@@ -0,0 +1,103 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "threadPool.h"
+
+enum class MediaProbeStatus: int32_t {
+    Valid = 0,
+    Unreadable = 1,     // Missing, empty or not a supported image (its header can't be parsed).
+    Truncated = 2,      // The header is fine but the file doesn't end the way its format requires.
+    Oversized = 3       // Decoding it would take more memory than allowed (e.g. a decompression bomb).
+};
+
+// Human readable description of a probe status, e.g. for tooltips.
+const char* getMediaProbeStatusDescription(MediaProbeStatus status);
+
+// What is known about a media file without decoding it.
+struct MediaProbeResult {
+    MediaProbeStatus    status{ MediaProbeStatus::Valid };
+    int32_t             width{ 0 };
+    int32_t             height{ 0 };
+    int32_t             channels{ 0 };
+    int32_t             bit_depth{ 0 };     // Bits per channel: 8, 16 or 32 (HDR, floating point).
+    uintmax_t           file_size{ 0 };
+
+    bool isFlagged() const { return status != MediaProbeStatus::Valid; }
+};
+
+/**
+ * @brief Reads the header (and the last few bytes) of an image file to check that it can be decoded.
+ *
+ * @param max_pixel_count Images with more pixels than this are reported as oversized.
+ */
+MediaProbeResult probeImageFile(const std::string& filepath, size_t max_pixel_count);
+
+/**
+ * @brief Probes media files in the background, so that unreadable or oversized ones are known before
+ * anything tries to decode them.
+ *
+ * Files are probed in batches on the given thread pool, and the results are kept (keyed by file
+ * path) for as long as the file list they came from. All methods are thread safe.
+ */
+class MediaProber {
+public:
+    MediaProber(ThreadPool& thread_pool, size_t batch_size, size_t max_pixel_count);
+    ~MediaProber();
+
+    // Schedules the files that haven't been probed yet (e.g. after a directory has been (re)loaded).
+    void probe(const std::vector<std::string>& filepaths);
+
+    // Takes results known from a previous run (e.g. a persisted directory index) for files not probed yet.
+    void seed(const std::vector<std::pair<std::string, MediaProbeResult>>& results);
+
+    // Returns the result for the file, `std::nullopt` if it hasn't been probed yet.
+    std::optional<MediaProbeResult> find(const std::string& filepath) const;
+
+    // Whether the file has been probed and found not to be decodable.
+    bool isFlagged(const std::string& filepath) const;
+
+    // Returns the results that came in since the last call (for a single consumer, e.g. an index of the files).
+    std::vector<std::pair<std::string, MediaProbeResult>> takeCompleted();
+
+    // Forgets the result for a file that changed on disk, so that the next probe() covers it again.
+    void invalidate(const std::string& filepath);
+
+    // Cancels outstanding work and forgets every result.
+    void clear();
+
+    size_t getProbedCount() const;
+    size_t getPendingCount() const;
+    size_t getFlaggedCount() const;
+
+    // Disable copying MediaProber objects.
+    MediaProber(const MediaProber&) = delete;
+    MediaProber& operator=(const MediaProber&) = delete;
+
+private:
+
+    // Shared with the probing tasks, which may outlive the prober.
+    struct State {
+        std::unordered_map<std::string, MediaProbeResult>           results;
+        std::unordered_set<std::string>                             pending;
+        std::vector<std::pair<std::string, MediaProbeResult>>       completed;      // Not taken yet.
+        size_t                                                      flagged_count{ 0 };
+        mutable std::mutex                                          mutex;
+    };
+
+    ThreadPool&                             m_thread_pool;
+    size_t                                  m_batch_size;
+    size_t                                  m_max_pixel_count;
+
+    std::shared_ptr<State>                  m_state;
+    std::shared_ptr<std::atomic<bool>>      m_cancelled;
+    mutable std::mutex                      m_mutex;
+};
@@ -0,0 +1,74 @@
+#include <algorithm>
+#include "memoryBudget.h"
+
+const char* getMemoryTierName(MemoryTier tier) {
+    switch (tier) {
+        case MemoryTier::Compressed:    return "Compressed";
+        case MemoryTier::DecodedPixels: return "Decoded Pixels";
+        case MemoryTier::GPUTextures:   return "GPU Textures";
+    }
+    return "Unknown";
+}
+
+MemoryBudget::MemoryBudget(size_t compressed_budget, size_t decoded_pixels_budget, size_t gpu_textures_budget) {
+    setBudget(MemoryTier::Compressed, compressed_budget);
+    setBudget(MemoryTier::DecodedPixels, decoded_pixels_budget);
+    setBudget(MemoryTier::GPUTextures, gpu_textures_budget);
+}
+
+void MemoryBudget::registerConsumer(MemoryConsumer consumer) {
+    m_consumers.push_back(std::move(consumer));
+
+    // Keep consumers in eviction order.
+    std::stable_sort(m_consumers.begin(), m_consumers.end(), [](const MemoryConsumer& a, const MemoryConsumer& b) {
+        return a.priority < b.priority;
+    });
+}
+
+void MemoryBudget::setBudget(MemoryTier tier, size_t budget) {
+    m_tier_stats.at(static_cast<size_t>(tier)).budget = budget;
+}
+
+size_t MemoryBudget::getBudget(MemoryTier tier) const {
+    return m_tier_stats.at(static_cast<size_t>(tier)).budget;
+}
+
+void MemoryBudget::enforce() {
+    for (TierStats& tier_stats : m_tier_stats) {
+        tier_stats.used_bytes = 0;
+    }
+
+    std::vector<size_t> usages;
+    usages.reserve(m_consumers.size());
+    for (const MemoryConsumer& consumer : m_consumers) {
+        usages.push_back(consumer.usage());
+        m_tier_stats.at(static_cast<size_t>(consumer.tier)).used_bytes += usages.back();
+    }
+
+    for (size_t i = 0; i < m_consumers.size(); i++) {
+        const MemoryConsumer& consumer = m_consumers[i];
+        TierStats& tier_stats = m_tier_stats.at(static_cast<size_t>(consumer.tier));
+        if (tier_stats.used_bytes <= tier_stats.budget || ! consumer.release || usages[i] == 0) {
+            continue;
+        }
+
+        size_t released_bytes = std::min(consumer.release(tier_stats.used_bytes - tier_stats.budget), usages[i]);
+        usages[i] -= released_bytes;
+        tier_stats.used_bytes -= released_bytes;
+        tier_stats.released_bytes += released_bytes;
+    }
+
+    m_consumer_stats.clear();
+    for (size_t i = 0; i < m_consumers.size(); i++) {
+        const MemoryConsumer& consumer = m_consumers[i];
+        m_consumer_stats.push_back(ConsumerStats{consumer.name, consumer.tier, consumer.priority, usages[i], static_cast<bool>(consumer.release)});
+    }
+}
+
+const MemoryBudget::TierStats& MemoryBudget::getTierStats(MemoryTier tier) const {
+    return m_tier_stats.at(static_cast<size_t>(tier));
+}
+
+const std::vector<MemoryBudget::ConsumerStats>& MemoryBudget::getConsumerStats() const {
+    return m_consumer_stats;
+}
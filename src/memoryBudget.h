@@ -0,0 +1,79 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+enum class MemoryTier: int32_t {
+    Compressed = 0,         // Encoded file contents held in memory (memory-mapped files).
+    DecodedPixels = 1,      // Decoded pixels in CPU memory.
+    GPUTextures = 2         // Textures in GPU memory.
+};
+
+const size_t MEMORY_TIER_COUNT = 3;
+
+const char* getMemoryTierName(MemoryTier tier);
+
+/**
+ * @brief A cache (or anything else holding on to memory) accounted for by the MemoryBudget.
+ */
+struct MemoryConsumer {
+    std::string                         name;
+    MemoryTier                          tier;
+
+    // Consumers with lower priorities are asked to release memory first.
+    int32_t                             priority;
+
+    // Returns the number of bytes currently held.
+    std::function<size_t()>             usage;
+
+    // Releases about the given number of bytes (least valuable data first) and returns how many were
+    // actually released. Null for memory that is accounted for but can't be released on demand.
+    std::function<size_t(size_t)>       release;
+};
+
+/**
+ * @brief Bounds the memory used by all registered consumers, per tier.
+ *
+ * Every frame, enforce() sums the usage of each tier and, for tiers over their budget, asks the
+ * consumers of that tier to release memory in order of increasing priority until the tier fits.
+ * Must only be used on the OpenGL thread (since GPU consumers release textures).
+ */
+class MemoryBudget {
+public:
+    struct TierStats {
+        size_t      budget;
+        size_t      used_bytes;
+        size_t      released_bytes;     // In total, by enforce().
+    };
+
+    struct ConsumerStats {
+        std::string name;
+        MemoryTier  tier;
+        int32_t     priority;
+        size_t      used_bytes;
+        bool        releasable;
+    };
+
+    MemoryBudget(size_t compressed_budget, size_t decoded_pixels_budget, size_t gpu_textures_budget);
+
+    void registerConsumer(MemoryConsumer consumer);
+
+    void setBudget(MemoryTier tier, size_t budget);
+    size_t getBudget(MemoryTier tier) const;
+
+    // Brings every tier back within its budget, as far as the consumers allow. Call once per frame.
+    void enforce();
+
+    // Usage as of the last call to enforce().
+    const TierStats& getTierStats(MemoryTier tier) const;
+    const std::vector<ConsumerStats>& getConsumerStats() const;
+
+private:
+    std::vector<MemoryConsumer>                     m_consumers;
+    std::array<TierStats, MEMORY_TIER_COUNT>        m_tier_stats{};
+    std::vector<ConsumerStats>                      m_consumer_stats;
+};
@@ -0,0 +1,164 @@
+#include <algorithm>
+#include <bit>
+#include <cstdlib>
+#include <cstring>
+#include "pixelArena.h"
+#include "constants.h"
+
+namespace {
+
+    // Allocations up to this size aren't pixel buffers worth recycling.
+    const size_t    SMALL_ALLOCATION_SIZE   = 64 * 1024;
+}
+
+PixelArena::PixelArena(size_t cache_byte_budget)
+    : m_cache_byte_budget(cache_byte_budget) {}
+
+PixelArena::~PixelArena() {
+    trim();
+}
+
+PixelArena& PixelArena::instance() {
+    static PixelArena arena(PIXEL_ARENA_CACHE_BYTE_BUDGET);
+    return arena;
+}
+
+void* PixelArena::allocate(size_t size) {
+    if (size <= SMALL_ALLOCATION_SIZE) {
+        Header* header = static_cast<Header*>(std::malloc(sizeof(Header) + size));
+        if (! header) {
+            return nullptr;
+        }
+        header->capacity = 0;
+        header->size = size;
+        return header + 1;
+    }
+
+    const size_t capacity = roundUpToSizeClass(size);
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    Header* header = nullptr;
+    auto it = m_cache.find(capacity);
+    if (it != m_cache.end() && ! it->second.empty()) {
+        header = it->second.back();
+        it->second.pop_back();
+        m_stats.cached_bytes -= capacity;
+        m_stats.reuse_count++;
+    } else {
+        header = static_cast<Header*>(std::malloc(sizeof(Header) + capacity));
+        if (! header) {
+            return nullptr;
+        }
+        header->capacity = capacity;
+        m_stats.system_allocation_count++;
+    }
+
+    header->size = size;
+    m_stats.used_bytes += capacity;
+    m_stats.peak_used_bytes = std::max(m_stats.peak_used_bytes, m_stats.used_bytes);
+    return header + 1;
+}
+
+void* PixelArena::reallocate(void* pointer, size_t size) {
+    if (! pointer) {
+        return allocate(size);
+    }
+
+    Header* header = static_cast<Header*>(pointer) - 1;
+    if (header->capacity == 0 && size <= SMALL_ALLOCATION_SIZE) {
+        Header* reallocated = static_cast<Header*>(std::realloc(header, sizeof(Header) + size));
+        if (! reallocated) {
+            return nullptr;
+        }
+        reallocated->size = size;
+        return reallocated + 1;
+    }
+    if (size <= header->capacity) {
+        header->size = size;
+        return pointer;
+    }
+
+    // Growing past the size class (or out of the small allocations) moves the buffer.
+    void* reallocated = allocate(size);
+    if (! reallocated) {
+        return nullptr;
+    }
+    std::memcpy(reallocated, pointer, std::min(size, header->size));
+    release(pointer);
+    return reallocated;
+}
+
+void PixelArena::release(void* pointer) {
+    if (! pointer) {
+        return;
+    }
+
+    Header* header = static_cast<Header*>(pointer) - 1;
+    if (header->capacity == 0) {
+        std::free(header);
+        return;
+    }
+
+    const size_t capacity = header->capacity;
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_stats.used_bytes -= capacity;
+    if (m_stats.cached_bytes + capacity > m_cache_byte_budget) {
+        std::free(header);
+        return;
+    }
+
+    m_cache[capacity].push_back(header);
+    m_stats.cached_bytes += capacity;
+}
+
+void PixelArena::trim() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (auto& [capacity, headers] : m_cache) {
+        for (Header* header : headers) {
+            std::free(header);
+        }
+    }
+    m_cache.clear();
+    m_stats.cached_bytes = 0;
+}
+
+size_t PixelArena::trim(size_t bytes) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    size_t freed_bytes = 0;
+    for (auto it = m_cache.rbegin(); it != m_cache.rend() && freed_bytes < bytes; it++) {
+        auto& [capacity, headers] = *it;
+        while (! headers.empty() && freed_bytes < bytes) {
+            std::free(headers.back());
+            headers.pop_back();
+            freed_bytes += capacity;
+        }
+    }
+    m_stats.cached_bytes -= freed_bytes;
+    return freed_bytes;
+}
+
+PixelArena::Stats PixelArena::getStats() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_stats;
+}
+
+size_t PixelArena::roundUpToSizeClass(size_t size) {
+
+    // Classes are 4/4, 5/4, 6/4 and 7/4 of each power of two.
+    const size_t power = std::bit_floor(size);
+    const size_t step = power / 4;
+    const size_t capacity = (size + step - 1) / step * step;
+    return capacity;
+}
+
+void* pixelArenaAllocate(size_t size) {
+    return PixelArena::instance().allocate(size);
+}
+
+void* pixelArenaReallocate(void* pointer, size_t size) {
+    return PixelArena::instance().reallocate(pointer, size);
+}
+
+void pixelArenaFree(void* pointer) {
+    PixelArena::instance().release(pointer);
+}
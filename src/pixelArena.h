@@ -0,0 +1,75 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <vector>
+
+/**
+ * @brief Recycles the large buffers that decoded pixels live in, grouped into size classes.
+ *
+ * Decoding a stream of images (previews, prefetches, thumbnails) allocates and frees buffers of
+ * a handful of sizes over and over, which fragments the heap over a long session. Instead, freed
+ * buffers are kept, up to a byte budget, and handed out again for requests of the same size class.
+ * Size classes are spaced a quarter of a power of two apart, so a buffer wastes at most 25%.
+ * Small allocations (e.g. stb_image's internal tables) go straight to malloc().
+ *
+ * stb_image allocates through the arena (see vendors/stb/stb_image.cpp), so every pixel buffer
+ * handed to ImageData must come from it too. All methods are thread safe.
+ */
+class PixelArena {
+public:
+    struct Stats {
+        size_t      used_bytes;                 // Held by live buffers (including size class rounding).
+        size_t      peak_used_bytes;
+        size_t      cached_bytes;               // Held by freed buffers waiting for reuse.
+        size_t      system_allocation_count;    // Buffers obtained from malloc().
+        size_t      reuse_count;                // Buffers served from the cache instead.
+    };
+
+    explicit PixelArena(size_t cache_byte_budget);
+    ~PixelArena();
+
+    // The arena shared by all decoders.
+    static PixelArena& instance();
+
+    void* allocate(size_t size);
+    void* reallocate(void* pointer, size_t size);
+    void release(void* pointer);
+
+    // Frees every cached buffer (e.g. once a set of directories is closed).
+    void trim();
+
+    // Frees cached buffers, largest first, until at least `bytes` are freed. Returns the bytes freed.
+    size_t trim(size_t bytes);
+
+    Stats getStats() const;
+
+    // Disable copying PixelArena objects.
+    PixelArena(const PixelArena&) = delete;
+    PixelArena& operator=(const PixelArena&) = delete;
+
+private:
+
+    // Precedes every buffer, recording the capacity it was allocated with (zero for small allocations).
+    struct alignas(16) Header {
+        size_t      capacity;
+        size_t      size;       // Requested size.
+    };
+
+    static size_t roundUpToSizeClass(size_t size);
+
+    size_t                                      m_cache_byte_budget;
+    Stats                                       m_stats{};
+
+    // Cached buffers (pointing at their header) by capacity.
+    std::map<size_t, std::vector<Header*>>      m_cache;
+
+    mutable std::mutex                          m_mutex;
+};
+
+// Allocation hooks for stb_image (STBI_MALLOC, STBI_REALLOC and STBI_FREE), forwarding to PixelArena::instance().
+void* pixelArenaAllocate(size_t size);
+void* pixelArenaReallocate(void* pointer, size_t size);
+void pixelArenaFree(void* pointer);
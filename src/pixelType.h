@@ -0,0 +1,20 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Type of the channels of decoded pixels.
+enum class PixelType: int32_t {
+    UInt8 = 0,
+    UInt16 = 1,         // 16-bit images (e.g. sensor PNGs), normalized to [0, 1] on the GPU.
+    Float32 = 2         // HDR images, stored as half floats on the GPU.
+};
+
+inline size_t getBytesPerChannel(PixelType type) {
+    switch (type) {
+        case PixelType::UInt8:      return 1;
+        case PixelType::UInt16:     return 2;
+        case PixelType::Float32:    return 4;
+    }
+    return 1;
+}
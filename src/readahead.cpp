@@ -0,0 +1,26 @@
+#include "readahead.h"
+#include "mappedFile.h"
+
+void Readahead::update(const std::vector<std::string>& upcoming_filepaths) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    std::unordered_set<std::string> hinted_filepaths;
+    for (const std::string& filepath : upcoming_filepaths) {
+        if (! m_hinted_filepaths.contains(filepath)) {
+            m_thread_pool.submit([filepath]() { adviseWillNeed(filepath); });
+        }
+        hinted_filepaths.insert(filepath);
+    }
+    m_hinted_filepaths = std::move(hinted_filepaths);
+}
+
+void Readahead::release(const std::string& filepath) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_hinted_filepaths.erase(filepath);
+    m_thread_pool.submit([filepath]() { adviseDontNeed(filepath); });
+}
+
+void Readahead::clear() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_hinted_filepaths.clear();
+}
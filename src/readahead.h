@@ -0,0 +1,34 @@
+#pragma once
+
+#include <mutex>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+#include "threadPool.h"
+
+/**
+ * @brief Hints the kernel about which files are read next and which ones are done with.
+ *
+ * On slow volumes (spinning disks, network shares) a cold read dominates the cost of an image, so the
+ * upcoming files are asked to be read into the page cache well before they are decoded. The hints are
+ * issued on a dedicated I/O thread, since even opening a file may block on such volumes. All methods
+ * are thread safe.
+ */
+class Readahead {
+public:
+    // Hints the upcoming files that haven't been hinted yet.
+    void update(const std::vector<std::string>& upcoming_filepaths);
+
+    // Hints that a file (e.g. one that has been labeled and moved) won't be read again.
+    void release(const std::string& filepath);
+
+    void clear();
+
+private:
+    ThreadPool                          m_thread_pool{ 1 };
+
+    // Files hinted by the last update(), so that they aren't hinted again on every update.
+    std::unordered_set<std::string>     m_hinted_filepaths;
+    std::mutex                          m_mutex;
+};
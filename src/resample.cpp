@@ -0,0 +1,145 @@
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <type_traits>
+#include <vector>
+#include "resample.h"
+
+namespace {
+
+    // Source pixels covered by each destination pixel along one axis, with their normalized weights.
+    struct AxisContributions {
+        std::vector<int32_t>    first;
+        std::vector<int32_t>    count;
+        std::vector<int32_t>    offset;     // Into weights.
+        std::vector<float>      weights;
+    };
+
+    AxisContributions computeAxisContributions(int32_t src_size, int32_t dst_size) {
+        AxisContributions contributions;
+        contributions.first.resize(dst_size);
+        contributions.count.resize(dst_size);
+        contributions.offset.resize(dst_size);
+
+        const double scale = static_cast<double>(src_size) / static_cast<double>(dst_size);
+        for (int32_t i = 0; i < dst_size; i++) {
+            const double begin = i * scale;
+            const double end = std::min((i + 1) * scale, static_cast<double>(src_size));
+            const int32_t first = static_cast<int32_t>(std::floor(begin));
+            const int32_t last = std::min(static_cast<int32_t>(std::ceil(end)), src_size);
+
+            contributions.first[i] = first;
+            contributions.count[i] = last - first;
+            contributions.offset[i] = static_cast<int32_t>(contributions.weights.size());
+            for (int32_t j = first; j < last; j++) {
+                const double coverage = std::min<double>(j + 1, end) - std::max<double>(j, begin);
+                contributions.weights.push_back(static_cast<float>(coverage / scale));
+            }
+        }
+        return contributions;
+    }
+
+    template<typename T>
+    void filterRow(const T* src_row, float* dst_row, int32_t dst_width, int32_t channels, const AxisContributions& horizontal) {
+        for (int32_t x = 0; x < dst_width; x++) {
+            const T* src_pixel = src_row + static_cast<size_t>(horizontal.first[x]) * channels;
+            const float* weights = horizontal.weights.data() + horizontal.offset[x];
+            float* dst_pixel = dst_row + static_cast<size_t>(x) * channels;
+
+            std::fill(dst_pixel, dst_pixel + channels, 0.0f);
+            for (int32_t k = 0; k < horizontal.count[x]; k++) {
+                const float weight = weights[k];
+                for (int32_t c = 0; c < channels; c++) {
+                    dst_pixel[c] += weight * src_pixel[c];
+                }
+                src_pixel += channels;
+            }
+        }
+    }
+
+    // Integer channels are rounded and clamped to their range, floating point ones are stored as they are.
+    template<typename T>
+    T fromAccumulator(float value) {
+        if constexpr (std::is_floating_point_v<T>) {
+            return static_cast<T>(value);
+        } else {
+            return static_cast<T>(std::clamp(value + 0.5f, 0.0f, static_cast<float>(std::numeric_limits<T>::max())));
+        }
+    }
+
+    template<typename T>
+    void downscaleAreaImpl(
+        const T* src, int32_t src_width, int32_t src_height,
+        T* dst, int32_t dst_width, int32_t dst_height,
+        int32_t channels
+    ) {
+        const AxisContributions horizontal = computeAxisContributions(src_width, dst_width);
+        const AxisContributions vertical = computeAxisContributions(src_height, dst_height);
+
+        const size_t src_stride = static_cast<size_t>(src_width) * channels;
+        const size_t dst_stride = static_cast<size_t>(dst_width) * channels;
+
+        std::vector<float> filtered_row(dst_stride);
+        std::vector<float> accumulator(dst_stride);
+
+        for (int32_t y = 0; y < dst_height; y++) {
+            std::fill(accumulator.begin(), accumulator.end(), 0.0f);
+
+            const float* weights = vertical.weights.data() + vertical.offset[y];
+            for (int32_t k = 0; k < vertical.count[y]; k++) {
+                const T* src_row = src + static_cast<size_t>(vertical.first[y] + k) * src_stride;
+                filterRow(src_row, filtered_row.data(), dst_width, channels, horizontal);
+
+                const float weight = weights[k];
+                float* __restrict acc = accumulator.data();
+                const float* __restrict row = filtered_row.data();
+                for (size_t i = 0; i < dst_stride; i++) {
+                    acc[i] += weight * row[i];
+                }
+            }
+
+            T* dst_row = dst + static_cast<size_t>(y) * dst_stride;
+            const float* acc = accumulator.data();
+            for (size_t i = 0; i < dst_stride; i++) {
+                dst_row[i] = fromAccumulator<T>(acc[i]);
+            }
+        }
+    }
+}
+
+void downscaleArea(
+    const uint8_t* src, int32_t src_width, int32_t src_height,
+    uint8_t* dst, int32_t dst_width, int32_t dst_height,
+    int32_t channels
+) {
+    downscaleAreaImpl(src, src_width, src_height, dst, dst_width, dst_height, channels);
+}
+
+void downscaleArea(
+    const uint16_t* src, int32_t src_width, int32_t src_height,
+    uint16_t* dst, int32_t dst_width, int32_t dst_height,
+    int32_t channels
+) {
+    downscaleAreaImpl(src, src_width, src_height, dst, dst_width, dst_height, channels);
+}
+
+void downscaleArea(
+    const float* src, int32_t src_width, int32_t src_height,
+    float* dst, int32_t dst_width, int32_t dst_height,
+    int32_t channels
+) {
+    downscaleAreaImpl(src, src_width, src_height, dst, dst_width, dst_height, channels);
+}
+
+void fitWithin(int32_t width, int32_t height, int32_t max_width, int32_t max_height, int32_t& fitted_width, int32_t& fitted_height) {
+    double scale = 1.0;
+    if (max_width > 0) {
+        scale = std::min(scale, static_cast<double>(max_width) / width);
+    }
+    if (max_height > 0) {
+        scale = std::min(scale, static_cast<double>(max_height) / height);
+    }
+
+    fitted_width = std::max(1, static_cast<int32_t>(std::lround(width * scale)));
+    fitted_height = std::max(1, static_cast<int32_t>(std::lround(height * scale)));
+}
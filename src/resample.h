@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstdint>
+
+/**
+ * @brief Downscales interleaved pixels using an area-averaging (box) filter.
+ *
+ * Every destination pixel is the coverage-weighted average of the source pixels it overlaps, which
+ * avoids the aliasing of nearest/bilinear sampling at large reduction factors. The filter is separable
+ * and its inner loops run over contiguous rows so that the compiler can vectorize them.
+ *
+ * @param src Source pixels (`src_width * src_height * channels` bytes).
+ * @param dst Destination pixels (`dst_width * dst_height * channels` bytes). Must not alias `src`.
+ * The destination size must not be larger than the source size in either dimension.
+ */
+void downscaleArea(
+    const uint8_t* src, int32_t src_width, int32_t src_height,
+    uint8_t* dst, int32_t dst_width, int32_t dst_height,
+    int32_t channels
+);
+
+// Same as above, for 16-bit pixels.
+void downscaleArea(
+    const uint16_t* src, int32_t src_width, int32_t src_height,
+    uint16_t* dst, int32_t dst_width, int32_t dst_height,
+    int32_t channels
+);
+
+// Same as above, for floating point (e.g. HDR) pixels.
+void downscaleArea(
+    const float* src, int32_t src_width, int32_t src_height,
+    float* dst, int32_t dst_width, int32_t dst_height,
+    int32_t channels
+);
+
+/**
+ * @brief Computes the largest size that fits within `max_width` x `max_height` while preserving the
+ * aspect ratio of `width` x `height`. Images that already fit are left unchanged (never upscaled).
+ * A maximum of zero means that dimension is unbounded.
+ */
+void fitWithin(int32_t width, int32_t height, int32_t max_width, int32_t max_height, int32_t& fitted_width, int32_t& fitted_height);
@@ -0,0 +1,479 @@
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <numbers>
+#include <glad/glad.h>
+#include <SFML/Audio/InputSoundFile.hpp>
+#include "spectrogram.h"
+#include "util.h"
+
+namespace {
+    const char      CACHE_MAGIC[8]      = {'M', 'L', 'B', 'C', 'S', 'P', 'E', 'C'};
+    const uint32_t  CACHE_VERSION       = 2;
+
+    struct CacheHeader {
+        char        magic[8];
+        uint32_t    version;
+        int32_t     column_count;
+        int32_t     bin_count;
+        uint32_t    reserved;
+        uint64_t    file_size;
+        int64_t     modification_time;
+    };
+
+    /**
+     * @brief Radix-2 complex FFT of a fixed size.
+     *
+     * Real and imaginary parts live in separate arrays, and the twiddle factors of each stage are stored
+     * contiguously, so that the butterflies of a stage are plain loops over contiguous floats that
+     * compilers vectorize.
+     */
+    class Fft {
+    public:
+        explicit Fft(int32_t size)
+            : m_size(size), m_bit_reversal(size) {
+            int32_t bits = 0;
+            while ((1 << bits) < size) {
+                bits++;
+            }
+            for (int32_t i = 0; i < size; i++) {
+                int32_t reversed = 0;
+                for (int32_t bit = 0; bit < bits; bit++) {
+                    reversed |= ((i >> bit) & 1) << (bits - 1 - bit);
+                }
+                m_bit_reversal[i] = reversed;
+            }
+            for (int32_t half = 1; half < size; half *= 2) {
+                for (int32_t k = 0; k < half; k++) {
+                    double angle = -std::numbers::pi * k / half;
+                    m_twiddle_real.push_back(static_cast<float>(std::cos(angle)));
+                    m_twiddle_imaginary.push_back(static_cast<float>(std::sin(angle)));
+                }
+            }
+        }
+
+        void transform(float* real, float* imaginary) const {
+            for (int32_t i = 0; i < m_size; i++) {
+                int32_t j = m_bit_reversal[i];
+                if (i < j) {
+                    std::swap(real[i], real[j]);
+                    std::swap(imaginary[i], imaginary[j]);
+                }
+            }
+
+            size_t twiddle_offset = 0;
+            for (int32_t half = 1; half < m_size; half *= 2) {
+                const float* twiddle_real = m_twiddle_real.data() + twiddle_offset;
+                const float* twiddle_imaginary = m_twiddle_imaginary.data() + twiddle_offset;
+                for (int32_t start = 0; start < m_size; start += 2 * half) {
+                    float* a_real = real + start;
+                    float* a_imaginary = imaginary + start;
+                    float* b_real = a_real + half;
+                    float* b_imaginary = a_imaginary + half;
+                    for (int32_t k = 0; k < half; k++) {
+                        float t_real = b_real[k] * twiddle_real[k] - b_imaginary[k] * twiddle_imaginary[k];
+                        float t_imaginary = b_real[k] * twiddle_imaginary[k] + b_imaginary[k] * twiddle_real[k];
+                        b_real[k] = a_real[k] - t_real;
+                        b_imaginary[k] = a_imaginary[k] - t_imaginary;
+                        a_real[k] += t_real;
+                        a_imaginary[k] += t_imaginary;
+                    }
+                }
+                twiddle_offset += static_cast<size_t>(half);
+            }
+        }
+
+    private:
+        int32_t                 m_size;
+        std::vector<int32_t>    m_bit_reversal;
+        std::vector<float>      m_twiddle_real;
+        std::vector<float>      m_twiddle_imaginary;
+    };
+
+    // Dark to bright perceptual color map (close to matplotlib's "inferno"), 256 RGBA entries.
+    const std::array<uint32_t, 256>& getColorMap() {
+        static const std::array<uint32_t, 256> color_map = [] {
+            const float stops[][3] = {
+                {0, 0, 4}, {40, 11, 84}, {101, 21, 110}, {159, 42, 99},
+                {212, 72, 66}, {245, 125, 21}, {250, 193, 39}, {252, 255, 164}
+            };
+            const int32_t stop_count = static_cast<int32_t>(sizeof(stops) / sizeof(stops[0]));
+
+            std::array<uint32_t, 256> entries{};
+            for (int32_t i = 0; i < 256; i++) {
+                float position = i / 255.0f * (stop_count - 1);
+                int32_t stop = std::min(static_cast<int32_t>(position), stop_count - 2);
+                float t = position - stop;
+                uint32_t entry = 0xFF000000;
+                for (int32_t channel = 0; channel < 3; channel++) {
+                    float value = stops[stop][channel] + (stops[stop + 1][channel] - stops[stop][channel]) * t;
+                    entry |= static_cast<uint32_t>(std::lround(value)) << (8 * channel);
+                }
+                entries[i] = entry;
+            }
+            return entries;
+        }();
+        return color_map;
+    }
+}
+
+SpectrogramCache::SpectrogramCache(const std::string& directory, size_t max_size_in_bytes)
+    : m_entries(directory, ".spectrogram", max_size_in_bytes) {}
+
+bool SpectrogramCache::find(const TextureCache::Key& key, int32_t column_count, int32_t bin_count, std::vector<uint8_t>& intensities) const {
+    const std::string entry_filepath = m_entries.getEntryFilepath(hashPath(key.filepath));
+    std::ifstream file(entry_filepath, std::ios::binary);
+    if (! file) {
+        return false;
+    }
+
+    CacheHeader header{};
+    if (! file.read(reinterpret_cast<char*>(&header), sizeof(CacheHeader))
+        || std::memcmp(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC)) != 0
+        || header.version != CACHE_VERSION
+        || header.column_count != column_count
+        || header.bin_count != bin_count
+        || header.file_size != key.file_size
+        || header.modification_time != key.modification_time.time_since_epoch().count()) {
+        return false;
+    }
+
+    intensities.resize(static_cast<size_t>(column_count) * bin_count);
+    if (! file.read(reinterpret_cast<char*>(intensities.data()), static_cast<std::streamsize>(intensities.size()))) {
+        return false;
+    }
+    m_entries.touch(entry_filepath);
+    return true;
+}
+
+void SpectrogramCache::add(const TextureCache::Key& key, int32_t column_count, int32_t bin_count, const std::vector<uint8_t>& intensities) const {
+    CacheHeader header{};
+    std::memcpy(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC));
+    header.version = CACHE_VERSION;
+    header.column_count = column_count;
+    header.bin_count = bin_count;
+    header.file_size = key.file_size;
+    header.modification_time = key.modification_time.time_since_epoch().count();
+
+    m_entries.write(m_entries.getEntryFilepath(hashPath(key.filepath)), [&header, &intensities](std::ostream& file) {
+        file.write(reinterpret_cast<const char*>(&header), sizeof(CacheHeader));
+        file.write(reinterpret_cast<const char*>(intensities.data()), static_cast<std::streamsize>(intensities.size()));
+    });
+}
+
+std::shared_ptr<SpectrogramData> SpectrogramData::compute(const std::string& filepath, ThreadPool& thread_pool, std::shared_ptr<const SpectrogramCache> cache, const Parameters& parameters) {
+    auto data = std::make_shared<SpectrogramData>(filepath, std::move(cache), parameters);
+    thread_pool.submit([data, &thread_pool] { data->start(thread_pool); }, true);
+    return data;
+}
+
+SpectrogramData::SpectrogramData(const std::string& filepath, std::shared_ptr<const SpectrogramCache> cache, const Parameters& parameters)
+    : m_filepath(filepath), m_cache(std::move(cache)), m_parameters(parameters) {}
+
+void SpectrogramData::cancel() {
+    m_cancelled.store(true);
+}
+
+bool SpectrogramData::isReady() const {
+    return m_ready.load(std::memory_order_acquire);
+}
+
+bool SpectrogramData::hasFailed() const {
+    return m_failed.load();
+}
+
+int32_t SpectrogramData::getColumnCount() const {
+    return m_column_count;
+}
+
+int32_t SpectrogramData::getBinCount() const {
+    return m_parameters.bin_count;
+}
+
+float SpectrogramData::getDuration() const {
+    return m_sample_rate > 0 ? static_cast<float>(static_cast<double>(m_frame_count) / m_sample_rate) : 0.0f;
+}
+
+float SpectrogramData::getMinFrequency() const {
+    return m_parameters.min_frequency;
+}
+
+float SpectrogramData::getMaxFrequency() const {
+    return m_sample_rate * 0.5f;
+}
+
+size_t SpectrogramData::getChunkCount() const {
+    return static_cast<size_t>((m_column_count + m_parameters.chunk_column_count - 1) / m_parameters.chunk_column_count);
+}
+
+int32_t SpectrogramData::getChunkColumnCount() const {
+    return m_parameters.chunk_column_count;
+}
+
+bool SpectrogramData::isChunkComplete(size_t chunk) const {
+    return m_completed_chunks[chunk].load(std::memory_order_acquire);
+}
+
+size_t SpectrogramData::getCompletedChunkCount() const {
+    return m_completed_chunk_count.load();
+}
+
+const uint8_t* SpectrogramData::getColumn(int32_t column) const {
+    return m_intensities.data() + static_cast<size_t>(column) * m_parameters.bin_count;
+}
+
+size_t SpectrogramData::getSizeInBytes() const {
+    return isReady() ? m_intensities.size() : 0;
+}
+
+void SpectrogramData::start(ThreadPool& thread_pool) {
+    if (m_cancelled.load()) {
+        return;
+    }
+
+    sf::InputSoundFile file;
+    if (! file.openFromFile(m_filepath)) {
+        m_failed.store(true);
+        return;
+    }
+    const uint32_t channel_count = std::max<uint32_t>(file.getChannelCount(), 1);
+    m_sample_rate = file.getSampleRate();
+    m_frame_count = file.getSampleCount() / channel_count;
+
+    // Columns are at least a quarter window apart, further for recordings too long to fit the column budget.
+    const int64_t max_column_count = std::max(m_parameters.max_column_count, 1);
+    m_hop_frame_count = std::max<int64_t>(m_parameters.fft_size / 4, (static_cast<int64_t>(m_frame_count) + max_column_count - 1) / max_column_count);
+    m_column_count = static_cast<int32_t>(std::max<int64_t>(1, (static_cast<int64_t>(m_frame_count) + m_hop_frame_count - 1) / m_hop_frame_count));
+
+    const size_t chunk_count = getChunkCount();
+    m_completed_chunks = std::make_unique<std::atomic<bool>[]>(chunk_count);
+    m_key = TextureCache::Key::fromFile(m_filepath);
+    bool cached = m_cache && m_key && m_cache->find(m_key.value(), m_column_count, m_parameters.bin_count, m_intensities);
+    if (! cached) {
+        m_intensities.assign(static_cast<size_t>(m_column_count) * m_parameters.bin_count, 0);
+    }
+    m_ready.store(true, std::memory_order_release);
+
+    if (cached) {
+        for (size_t chunk = 0; chunk < chunk_count; chunk++) {
+            m_completed_chunks[chunk].store(true, std::memory_order_release);
+        }
+        m_completed_chunk_count.store(chunk_count);
+        return;
+    }
+
+    std::shared_ptr<SpectrogramData> self = shared_from_this();
+    for (size_t chunk = 0; chunk < chunk_count; chunk++) {
+        thread_pool.submit([self, chunk] { self->computeChunk(chunk); });
+    }
+}
+
+void SpectrogramData::computeChunk(size_t chunk) {
+    if (m_cancelled.load()) {
+        return;
+    }
+
+    // Every chunk decodes its own part of the file, so that chunks don't wait on each other.
+    sf::InputSoundFile file;
+    if (! file.openFromFile(m_filepath)) {
+        m_failed.store(true);
+        return;
+    }
+    const uint32_t channel_count = std::max<uint32_t>(file.getChannelCount(), 1);
+
+    const int32_t fft_size = m_parameters.fft_size;
+    const int32_t bin_count = m_parameters.bin_count;
+    Fft fft(fft_size);
+
+    std::vector<float> window(fft_size);
+    for (int32_t i = 0; i < fft_size; i++) {
+        window[i] = 0.5f - 0.5f * static_cast<float>(std::cos(2.0 * std::numbers::pi * i / fft_size));
+    }
+
+    // FFT bins covered by each (logarithmically spaced) output bin.
+    const double max_frequency = m_sample_rate * 0.5;
+    const double min_frequency = std::min<double>(m_parameters.min_frequency, max_frequency * 0.5);
+    const double frequency_ratio = max_frequency / min_frequency;
+    const int32_t half_size = fft_size / 2;
+    std::vector<std::pair<int32_t, int32_t>> bin_ranges(bin_count);
+    for (int32_t bin = 0; bin < bin_count; bin++) {
+        double low = min_frequency * std::pow(frequency_ratio, static_cast<double>(bin) / bin_count);
+        double high = min_frequency * std::pow(frequency_ratio, static_cast<double>(bin + 1) / bin_count);
+        int32_t first = std::clamp(static_cast<int32_t>(std::lround(low * fft_size / m_sample_rate)), 1, half_size);
+        int32_t last = std::clamp(static_cast<int32_t>(std::lround(high * fft_size / m_sample_rate)) - 1, first, half_size);
+        bin_ranges[bin] = {first, last};
+    }
+
+    // A full scale sine through a Hann window peaks at a quarter of the window size.
+    const float reference_power = static_cast<float>(fft_size) * fft_size / 16.0f;
+    const float dynamic_range = std::max(m_parameters.dynamic_range, 1.0f);
+
+    const int32_t first_column = static_cast<int32_t>(chunk) * m_parameters.chunk_column_count;
+    const int32_t last_column = std::min(first_column + m_parameters.chunk_column_count, m_column_count);
+
+    // Windows of a column are half a window apart (Hann windows overlapping by half weigh every frame),
+    // the last one reaching into the next column's frames when the hop isn't a multiple of that step.
+    const int64_t window_step = std::max(half_size, 1);
+    const int64_t windows_per_column = std::max<int64_t>(1, (m_hop_frame_count + window_step - 1) / window_step);
+
+    std::vector<int16_t> samples;
+    std::vector<float> mono;                    // Frames from `mono_start` on, mixed down.
+    uint64_t mono_start = static_cast<uint64_t>(first_column) * m_hop_frame_count;
+    file.seek(mono_start * channel_count);
+
+    std::vector<float> real(fft_size);
+    std::vector<float> imaginary(fft_size);
+    std::vector<float> power(half_size + 1);
+    for (int32_t column = first_column; column < last_column; column++) {
+        if (m_cancelled.load()) {
+            return;
+        }
+
+        std::fill(power.begin(), power.end(), 0.0f);
+        const uint64_t column_start = static_cast<uint64_t>(column) * m_hop_frame_count;
+        for (int64_t window_index = 0; window_index < windows_per_column; window_index++) {
+            const uint64_t window_start = column_start + static_cast<uint64_t>(window_index * window_step);
+            if (window_start >= m_frame_count && window_index > 0) {
+                break;
+            }
+            if (window_start >= mono_start + mono.size()) {
+                if (window_start > mono_start + mono.size()) {
+                    file.seek(window_start * channel_count);
+                }
+                mono.clear();
+            } else {
+                mono.erase(mono.begin(), mono.begin() + static_cast<ptrdiff_t>(window_start - mono_start));
+            }
+            mono_start = window_start;
+
+            while (mono.size() < static_cast<size_t>(fft_size)) {
+                samples.resize((fft_size - mono.size()) * channel_count);
+                uint64_t read_count = file.read(samples.data(), samples.size());
+                if (read_count == 0) {
+                    break;
+                }
+                const float scale = 1.0f / (32768.0f * channel_count);
+                for (uint64_t frame = 0; frame < read_count / channel_count; frame++) {
+                    float sum = 0.0f;
+                    for (uint32_t channel = 0; channel < channel_count; channel++) {
+                        sum += samples[frame * channel_count + channel];
+                    }
+                    mono.push_back(sum * scale);
+                }
+            }
+
+            // The end of the file is padded with silence.
+            const size_t available = std::min(mono.size(), static_cast<size_t>(fft_size));
+            for (size_t i = 0; i < available; i++) {
+                real[i] = mono[i] * window[i];
+            }
+            std::fill(real.begin() + static_cast<ptrdiff_t>(available), real.end(), 0.0f);
+            std::fill(imaginary.begin(), imaginary.end(), 0.0f);
+
+            fft.transform(real.data(), imaginary.data());
+            for (int32_t k = 0; k <= half_size; k++) {
+                power[k] = std::max(power[k], real[k] * real[k] + imaginary[k] * imaginary[k]);
+            }
+        }
+
+        uint8_t* intensities = m_intensities.data() + static_cast<size_t>(column) * bin_count;
+        for (int32_t bin = 0; bin < bin_count; bin++) {
+            auto [first, last] = bin_ranges[bin];
+            float bin_power = *std::max_element(power.begin() + first, power.begin() + last + 1);
+            float decibels = 10.0f * std::log10(bin_power / reference_power + 1e-20f);
+            float intensity = std::clamp((decibels + dynamic_range) / dynamic_range, 0.0f, 1.0f);
+            intensities[bin] = static_cast<uint8_t>(intensity * 255.0f + 0.5f);
+        }
+    }
+
+    completeChunk(chunk);
+}
+
+void SpectrogramData::completeChunk(size_t chunk) {
+    m_completed_chunks[chunk].store(true, std::memory_order_release);
+
+    // Whoever completes the last chunk sees every other chunk's columns, and caches the whole spectrogram.
+    if (m_completed_chunk_count.fetch_add(1) + 1 == getChunkCount() && m_cache && m_key && ! m_cancelled.load()) {
+        m_cache->add(m_key.value(), m_column_count, m_parameters.bin_count, m_intensities);
+    }
+}
+
+Spectrogram::Spectrogram(std::shared_ptr<SpectrogramData> data)
+    : m_data(std::move(data)) {}
+
+Spectrogram::~Spectrogram() {
+    m_data->cancel();
+    if (m_texture) {
+        glDeleteTextures(1, &m_texture);
+        m_texture = 0;
+    }
+}
+
+void Spectrogram::update(size_t max_chunk_uploads) {
+    if (! m_data->isReady()) {
+        return;
+    }
+
+    const int32_t column_count = m_data->getColumnCount();
+    const int32_t bin_count = m_data->getBinCount();
+    if (! m_texture) {
+
+        // Columns that aren't computed yet show as silence.
+        std::vector<uint32_t> silence(static_cast<size_t>(column_count) * bin_count, getColorMap()[0]);
+        glGenTextures(1, &m_texture);
+        glBindTexture(GL_TEXTURE_2D, m_texture);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, column_count, bin_count, 0, GL_RGBA, GL_UNSIGNED_BYTE, silence.data());
+        glBindTexture(GL_TEXTURE_2D, 0);
+        m_uploaded_chunks.assign(m_data->getChunkCount(), false);
+    }
+
+    // Chunks are colored and transposed (texture rows are bins) as they are uploaded.
+    const std::array<uint32_t, 256>& color_map = getColorMap();
+    size_t upload_count = 0;
+    for (size_t chunk = 0; chunk < m_uploaded_chunks.size() && upload_count < max_chunk_uploads; chunk++) {
+        if (m_uploaded_chunks[chunk] || ! m_data->isChunkComplete(chunk)) {
+            continue;
+        }
+
+        const int32_t first_column = static_cast<int32_t>(chunk) * m_data->getChunkColumnCount();
+        const int32_t width = std::min(m_data->getChunkColumnCount(), column_count - first_column);
+        m_upload_buffer.resize(static_cast<size_t>(width) * bin_count * 4);
+        uint32_t* texels = reinterpret_cast<uint32_t*>(m_upload_buffer.data());
+        for (int32_t x = 0; x < width; x++) {
+            const uint8_t* intensities = m_data->getColumn(first_column + x);
+            for (int32_t bin = 0; bin < bin_count; bin++) {
+                texels[static_cast<size_t>(bin) * width + x] = color_map[intensities[bin]];
+            }
+        }
+
+        glBindTexture(GL_TEXTURE_2D, m_texture);
+        glTexSubImage2D(GL_TEXTURE_2D, 0, first_column, 0, width, bin_count, GL_RGBA, GL_UNSIGNED_BYTE, m_upload_buffer.data());
+        glBindTexture(GL_TEXTURE_2D, 0);
+
+        m_uploaded_chunks[chunk] = true;
+        m_uploaded_chunk_count++;
+        upload_count++;
+    }
+}
+
+const SpectrogramData& Spectrogram::getData() const {
+    return *m_data;
+}
+
+ImTextureID Spectrogram::getTexture() const {
+    return reinterpret_cast<ImTextureID>(static_cast<uintptr_t>(m_texture));
+}
+
+float Spectrogram::getProgress() const {
+    return m_uploaded_chunks.empty() ? 0.0f : static_cast<float>(m_uploaded_chunk_count) / m_uploaded_chunks.size();
+}
+
+size_t Spectrogram::getSizeInBytes() const {
+    return m_texture ? static_cast<size_t>(m_data->getColumnCount()) * m_data->getBinCount() * 4 : 0;
+}
@@ -0,0 +1,158 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include <imgui.h>
+
+#include "cacheDirectory.h"
+#include "textureCache.h"
+#include "threadPool.h"
+
+/**
+ * @brief Keeps computed spectrograms on disk, one file per audio file, so that a recording is only
+ * analyzed once. Keyed and bounded in size like WaveformCache. Safe to use from any thread.
+ */
+class SpectrogramCache {
+public:
+    SpectrogramCache(const std::string& directory, size_t max_size_in_bytes);
+
+    /**
+     * @brief Reads the cached spectrogram of the file into `intensities` if there is one matching the
+     * dimensions. Returns whether it did.
+     */
+    bool find(const TextureCache::Key& key, int32_t column_count, int32_t bin_count, std::vector<uint8_t>& intensities) const;
+
+    // Stores the spectrogram of the file. Failures are ignored, the file is just analyzed again next time.
+    void add(const TextureCache::Key& key, int32_t column_count, int32_t bin_count, const std::vector<uint8_t>& intensities) const;
+
+private:
+    CacheDirectory      m_entries;
+};
+
+/**
+ * @brief The log-frequency spectrogram of an audio file, computed in chunks of columns on a thread pool.
+ *
+ * Each column is the short-time Fourier transform of `fft_size` frames (mixed to mono, Hann windowed),
+ * its power resampled onto `bin_count` logarithmically spaced frequency bins and mapped to an 8-bit
+ * intensity over a fixed decibel range. Columns are spaced so that the whole file takes at most
+ * `max_column_count` of them. When they are spaced further than half a window apart (long recordings),
+ * a column takes the peak power of each frequency over half-overlapping windows covering all of its
+ * frames, so that short sounds between two columns still show. Chunks are computed independently (each worker decodes its own part of
+ * the file), so they complete in any order and can be shown as soon as they are done.
+ */
+class SpectrogramData : public std::enable_shared_from_this<SpectrogramData> {
+public:
+    struct Parameters {
+        int32_t     fft_size{ 1024 };           // Power of two.
+        int32_t     bin_count{ 256 };           // Texture height, at most GL_MAX_TEXTURE_SIZE.
+        float       min_frequency{ 20.0f };
+        float       dynamic_range{ 90.0f };     // In decibels, below full scale.
+        int32_t     max_column_count{ 8192 };   // Texture width, at most GL_MAX_TEXTURE_SIZE.
+        int32_t     chunk_column_count{ 128 };
+    };
+
+    /**
+     * @brief Starts computing the spectrogram of the file (or reading it from the cache) on the thread pool.
+     * Returns right away, see isReady() and isChunkComplete().
+     *
+     * @param cache May be `nullptr`, in which case nothing is cached.
+     */
+    static std::shared_ptr<SpectrogramData> compute(const std::string& filepath, ThreadPool& thread_pool, std::shared_ptr<const SpectrogramCache> cache, const Parameters& parameters);
+
+    // Stops outstanding work. Chunks that aren't complete yet stay empty.
+    void cancel();
+
+    // Whether the file has been opened, after which the dimensions are known.
+    bool isReady() const;
+
+    // Whether the file couldn't be opened or read as audio.
+    bool hasFailed() const;
+
+    // Only valid once isReady().
+    int32_t getColumnCount() const;
+    int32_t getBinCount() const;
+    float getDuration() const;
+    float getMinFrequency() const;
+    float getMaxFrequency() const;
+    size_t getChunkCount() const;
+    int32_t getChunkColumnCount() const;
+
+    bool isChunkComplete(size_t chunk) const;
+    size_t getCompletedChunkCount() const;
+
+    // Intensities of a complete chunk's columns, `getBinCount()` per column, lowest frequency first.
+    const uint8_t* getColumn(int32_t column) const;
+
+    size_t getSizeInBytes() const;
+
+    // Disable copying SpectrogramData objects.
+    SpectrogramData(const SpectrogramData&) = delete;
+    SpectrogramData& operator=(const SpectrogramData&) = delete;
+
+    // Use compute().
+    SpectrogramData(const std::string& filepath, std::shared_ptr<const SpectrogramCache> cache, const Parameters& parameters);
+
+private:
+
+    // Opens the file, then either reads the cache or schedules the chunks.
+    void start(ThreadPool& thread_pool);
+    void computeChunk(size_t chunk);
+    void completeChunk(size_t chunk);
+
+    std::string                                 m_filepath;
+    std::shared_ptr<const SpectrogramCache>     m_cache;
+    Parameters                                  m_parameters;
+    std::optional<TextureCache::Key>            m_key;
+
+    // Set once before m_ready is, read only afterwards.
+    int32_t                                     m_column_count{ 0 };
+    int64_t                                     m_hop_frame_count{ 0 };
+    uint32_t                                    m_sample_rate{ 0 };
+    uint64_t                                    m_frame_count{ 0 };
+    std::vector<uint8_t>                        m_intensities;
+    std::unique_ptr<std::atomic<bool>[]>        m_completed_chunks;
+
+    std::atomic<bool>                           m_ready{ false };
+    std::atomic<bool>                           m_failed{ false };
+    std::atomic<bool>                           m_cancelled{ false };
+    std::atomic<size_t>                         m_completed_chunk_count{ 0 };
+};
+
+/**
+ * @brief Shows a SpectrogramData through a texture, one texel per column and bin, filled in as chunks
+ * complete. Must only be used on the OpenGL thread.
+ */
+class Spectrogram {
+public:
+    explicit Spectrogram(std::shared_ptr<SpectrogramData> data);
+    ~Spectrogram();
+
+    // Creates the texture once the dimensions are known and uploads up to `max_chunk_uploads` newly completed chunks. Call once per frame.
+    void update(size_t max_chunk_uploads);
+
+    const SpectrogramData& getData() const;
+
+    // 0 until the texture exists.
+    ImTextureID getTexture() const;
+
+    // Fraction of the columns shown so far.
+    float getProgress() const;
+
+    size_t getSizeInBytes() const;
+
+    // Disable copying Spectrogram objects.
+    Spectrogram(const Spectrogram&) = delete;
+    Spectrogram& operator=(const Spectrogram&) = delete;
+
+private:
+    std::shared_ptr<SpectrogramData>    m_data;
+    uint32_t                            m_texture{ 0 };
+    std::vector<bool>                   m_uploaded_chunks;
+    size_t                              m_uploaded_chunk_count{ 0 };
+    std::vector<uint8_t>                m_upload_buffer;
+};
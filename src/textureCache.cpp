@@ -0,0 +1,126 @@
+#include "textureCache.h"
+
+std::optional<TextureCache::Key> TextureCache::Key::fromFile(const std::string& filepath) {
+    namespace fs = std::filesystem;
+
+    std::error_code ec;
+    uintmax_t file_size = fs::file_size(filepath, ec);
+    if (ec) {
+        return std::nullopt;
+    }
+    fs::file_time_type modification_time = fs::last_write_time(filepath, ec);
+    if (ec) {
+        return std::nullopt;
+    }
+
+    return Key{filepath, file_size, modification_time};
+}
+
+size_t TextureCache::KeyHash::operator()(const Key& key) const {
+    size_t hash = std::hash<std::string>{}(key.filepath);
+    hash ^= std::hash<uintmax_t>{}(key.file_size) + 0x9e3779b9 + (hash << 6) + (hash >> 2);
+    hash ^= std::hash<int64_t>{}(key.modification_time.time_since_epoch().count()) + 0x9e3779b9 + (hash << 6) + (hash >> 2);
+    return hash;
+}
+
+TextureCache::TextureCache(size_t vram_budget)
+    : m_vram_budget(vram_budget) {}
+
+std::shared_ptr<const Image> TextureCache::find(const Key& key) {
+    auto it = m_lookup.find(key);
+    if (it == m_lookup.end()) {
+        m_miss_count++;
+        return nullptr;
+    }
+
+    m_hit_count++;
+    m_entries.splice(m_entries.begin(), m_entries, it->second);
+    return it->second->image;
+}
+
+std::shared_ptr<const Image> TextureCache::insert(const Key& key, Image image) {
+    auto it = m_lookup.find(key);
+    if (it != m_lookup.end()) {
+        erase(it->second);
+    }
+
+    auto shared_image = std::make_shared<const Image>(std::move(image));
+    m_used_bytes += shared_image->getSizeInBytes();
+    m_entries.push_front(Entry{key, shared_image});
+    m_lookup.emplace(key, m_entries.begin());
+
+    evictOverBudget();
+    return shared_image;
+}
+
+void TextureCache::invalidate(const std::string& filepath) {
+    std::lock_guard<std::mutex> lock(m_pending_invalidations_mutex);
+    m_pending_invalidations.push_back(filepath);
+}
+
+void TextureCache::processInvalidations() {
+    std::vector<std::string> pending_invalidations;
+    {
+        std::lock_guard<std::mutex> lock(m_pending_invalidations_mutex);
+        pending_invalidations.swap(m_pending_invalidations);
+    }
+
+    for (const std::string& filepath : pending_invalidations) {
+        for (auto it = m_entries.begin(); it != m_entries.end(); ) {
+            auto next = std::next(it);
+            if (it->key.filepath == filepath) {
+                erase(it);
+            }
+            it = next;
+        }
+    }
+}
+
+void TextureCache::clear() {
+    m_lookup.clear();
+    m_entries.clear();
+    m_used_bytes = 0;
+}
+
+size_t TextureCache::evict(size_t bytes) {
+    size_t released_bytes = 0;
+    while (released_bytes < bytes && ! m_entries.empty()) {
+        released_bytes += m_entries.back().image->getSizeInBytes();
+        erase(std::prev(m_entries.end()));
+    }
+    return released_bytes;
+}
+
+size_t TextureCache::getHitCount() const {
+    return m_hit_count;
+}
+
+size_t TextureCache::getMissCount() const {
+    return m_miss_count;
+}
+
+size_t TextureCache::getUsedBytes() const {
+    return m_used_bytes;
+}
+
+size_t TextureCache::getVRAMBudget() const {
+    return m_vram_budget;
+}
+
+size_t TextureCache::getEntryCount() const {
+    return m_entries.size();
+}
+
+void TextureCache::evictOverBudget() {
+
+    // Always keep the most recently used entry, even if it alone exceeds the budget.
+    while (m_used_bytes > m_vram_budget && m_entries.size() > 1) {
+        erase(std::prev(m_entries.end()));
+    }
+}
+
+void TextureCache::erase(std::list<Entry>::iterator it) {
+    m_used_bytes -= it->image->getSizeInBytes();
+    m_lookup.erase(it->key);
+    m_entries.erase(it);
+}
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <filesystem>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "image.h"
+
+/**
+ * @brief A bounded least-recently-used cache of uploaded images.
+ *
+ * Entries are keyed by file path, size and modification time, so a file that has been rewritten
+ * never hits a stale texture. When the total (estimated) VRAM used by the cached textures exceeds
+ * the budget, the least recently used entries are dropped. Images are shared with their users,
+ * so an evicted image stays alive for as long as it is displayed.
+ *
+ * Except for invalidate(), all methods must be called on the OpenGL thread.
+ */
+class TextureCache {
+public:
+    struct Key {
+        std::string                         filepath;
+        uintmax_t                           file_size;
+        std::filesystem::file_time_type     modification_time;
+
+        bool operator==(const Key& other) const = default;
+
+        // Builds the key of a file as it currently is on disk, `std::nullopt` if it can't be stat'ed.
+        static std::optional<Key> fromFile(const std::string& filepath);
+    };
+
+    explicit TextureCache(size_t vram_budget);
+
+    // Looks up an image, marking it as most recently used. Counts a hit or a miss.
+    std::shared_ptr<const Image> find(const Key& key);
+
+    // Adds an image, replacing the one already cached under the same key (e.g. a downscaled preview
+    // by its full resolution version) and evicting the least recently used ones if over budget.
+    std::shared_ptr<const Image> insert(const Key& key, Image image);
+
+    /**
+     * @brief Schedules removal of every entry for the given file. Safe to call from any thread
+     * (e.g. file watcher callbacks); the entries are released by the next processInvalidations().
+     */
+    void invalidate(const std::string& filepath);
+
+    // Releases entries scheduled by invalidate().
+    void processInvalidations();
+
+    void clear();
+
+    // Drops least recently used entries until at least `bytes` are released (or the cache is empty). Returns the bytes released.
+    size_t evict(size_t bytes);
+
+    size_t getHitCount() const;
+    size_t getMissCount() const;
+    size_t getUsedBytes() const;
+    size_t getVRAMBudget() const;
+    size_t getEntryCount() const;
+
+private:
+    struct KeyHash {
+        size_t operator()(const Key& key) const;
+    };
+
+    struct Entry {
+        Key                                 key;
+        std::shared_ptr<const Image>        image;
+    };
+
+    void evictOverBudget();
+    void erase(std::list<Entry>::iterator it);
+
+    size_t                                                              m_vram_budget;
+    size_t                                                              m_used_bytes{ 0 };
+    size_t                                                              m_hit_count{ 0 };
+    size_t                                                              m_miss_count{ 0 };
+
+    // Most recently used entries are at the front.
+    std::list<Entry>                                                    m_entries;
+    std::unordered_map<Key, std::list<Entry>::iterator, KeyHash>        m_lookup;
+
+    std::vector<std::string>                                            m_pending_invalidations;
+    std::mutex                                                          m_pending_invalidations_mutex;
+};
@@ -0,0 +1,162 @@
+#include <algorithm>
+#include <glad/glad.h>
+#include "texturePool.h"
+#include "constants.h"
+
+TexturePool::TexturePool(size_t byte_budget)
+    : m_byte_budget(byte_budget) {}
+
+TexturePool::~TexturePool() {
+    clear();
+}
+
+TexturePool& TexturePool::instance() {
+    static TexturePool pool(TEXTURE_POOL_BYTE_BUDGET);
+    return pool;
+}
+
+uint32_t TexturePool::acquire(int32_t width, int32_t height, int32_t channels, PixelType type) {
+    auto bucket = m_buckets.find(Shape{width, height, channels, type});
+    if (bucket == m_buckets.end()) {
+        m_allocation_count++;
+        return allocate(width, height, channels, type);
+    }
+
+    uint32_t texture = bucket->second->texture;
+    m_pooled_bytes -= estimateSizeInBytes(width, height, channels, type);
+    m_entries.erase(bucket->second);
+    m_buckets.erase(bucket);
+
+    m_reuse_count++;
+    return texture;
+}
+
+void TexturePool::release(uint32_t texture, int32_t width, int32_t height, int32_t channels, PixelType type) {
+    if (! texture) {
+        return;
+    }
+
+    m_entries.push_front(Entry{texture, Shape{width, height, channels, type}});
+    m_buckets.emplace(Shape{width, height, channels, type}, m_entries.begin());
+    m_pooled_bytes += estimateSizeInBytes(width, height, channels, type);
+
+    evictOverBudget();
+}
+
+void TexturePool::clear() {
+    for (const Entry& entry : m_entries) {
+        glDeleteTextures(1, &entry.texture);
+    }
+    m_entries.clear();
+    m_buckets.clear();
+    m_pooled_bytes = 0;
+}
+
+size_t TexturePool::trim(size_t bytes) {
+    size_t released_bytes = 0;
+    while (released_bytes < bytes && ! m_entries.empty()) {
+        released_bytes += evictLeastRecentlyReleased();
+    }
+    return released_bytes;
+}
+
+size_t TexturePool::getReuseCount() const {
+    return m_reuse_count;
+}
+
+size_t TexturePool::getAllocationCount() const {
+    return m_allocation_count;
+}
+
+size_t TexturePool::getPooledBytes() const {
+    return m_pooled_bytes;
+}
+
+size_t TexturePool::getPooledTextureCount() const {
+    return m_entries.size();
+}
+
+size_t TexturePool::estimateSizeInBytes(int32_t width, int32_t height, int32_t channels, PixelType type) {
+
+    // Drivers generally pad RGB to four channels, and floats are stored as half floats. Textures are
+    // sampled with GL_LINEAR and have no mipmaps, so the base level is all there is.
+    size_t bytes_per_channel = (type == PixelType::UInt8) ? 1 : 2;
+    size_t bytes_per_texel = ((channels == 3) ? 4 : static_cast<size_t>(channels)) * bytes_per_channel;
+    return static_cast<size_t>(width) * static_cast<size_t>(height) * bytes_per_texel;
+}
+
+uint32_t TexturePool::getPixelFormat(int32_t channels) {
+    switch (channels) {
+        case 1:     return GL_RED;
+        case 2:     return GL_RG;
+        case 3:     return GL_RGB;
+        default:    return GL_RGBA;
+    }
+}
+
+uint32_t TexturePool::getPixelDataType(PixelType type) {
+    switch (type) {
+        case PixelType::UInt8:      return GL_UNSIGNED_BYTE;
+        case PixelType::UInt16:     return GL_UNSIGNED_SHORT;
+        case PixelType::Float32:    return GL_FLOAT;
+    }
+    return GL_UNSIGNED_BYTE;
+}
+
+uint32_t TexturePool::allocate(int32_t width, int32_t height, int32_t channels, PixelType type) {
+    uint32_t texture;
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_2D, texture);
+
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+
+    // Gray (+ alpha) textures are read as RGB(A) by the shaders drawing them.
+    if (channels == 1) {
+        const GLint swizzle[] = {GL_RED, GL_RED, GL_RED, GL_ONE};
+        glTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_RGBA, swizzle);
+    } else if (channels == 2) {
+        const GLint swizzle[] = {GL_RED, GL_RED, GL_RED, GL_GREEN};
+        glTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_RGBA, swizzle);
+    }
+
+    // The storage is defined once and only ever refilled afterwards, so it is never reallocated
+    // (glTexStorage2D would make that explicit but requires OpenGL 4.2).
+    const GLint internal_formats[3][4] = {
+        {GL_R8, GL_RG8, GL_RGB8, GL_RGBA8},
+        {GL_R16, GL_RG16, GL_RGB16, GL_RGBA16},
+        {GL_R16F, GL_RG16F, GL_RGB16F, GL_RGBA16F}
+    };
+    const GLint internal_format = internal_formats[static_cast<size_t>(type)][std::clamp(channels, 1, 4) - 1];
+    glTexImage2D(GL_TEXTURE_2D, 0, internal_format, width, height, 0, getPixelFormat(channels), getPixelDataType(type), nullptr);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    return texture;
+}
+
+void TexturePool::evictOverBudget() {
+    while (m_pooled_bytes > m_byte_budget && ! m_entries.empty()) {
+        evictLeastRecentlyReleased();
+    }
+}
+
+size_t TexturePool::evictLeastRecentlyReleased() {
+    const Entry& entry = m_entries.back();
+
+    auto range = m_buckets.equal_range(entry.shape);
+    for (auto it = range.first; it != range.second; it++) {
+        if (it->second == std::prev(m_entries.end())) {
+            m_buckets.erase(it);
+            break;
+        }
+    }
+
+    const auto& [width, height, channels, type] = entry.shape;
+    const size_t bytes = estimateSizeInBytes(width, height, channels, type);
+    glDeleteTextures(1, &entry.texture);
+    m_pooled_bytes -= bytes;
+    m_entries.pop_back();
+    return bytes;
+}
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <map>
+#include <tuple>
+
+#include "pixelType.h"
+
+/**
+ * @brief Recycles OpenGL textures of released images, bucketed by size and channel count.
+ *
+ * Labeling usually goes through long runs of same-sized images (e.g. camera frames, or previews
+ * downscaled to the same preview window), so instead of deleting a released texture and allocating
+ * storage for the next one, the texture is kept and its storage is refilled with glTexSubImage2D.
+ * Released textures are kept up to a byte budget; the least recently released ones are deleted first.
+ *
+ * Textures keep the channel count of the decoded pixels (R8, RG8, RGB8 or RGBA8), so grayscale images
+ * upload a quarter of the bytes. Single and dual channel textures are swizzled to read as gray (+ alpha).
+ * High bit depth pixels get 16-bit normalized (UInt16) or half float (Float32) textures.
+ *
+ * Must only be used on the OpenGL thread.
+ */
+class TexturePool {
+public:
+    explicit TexturePool(size_t byte_budget);
+    ~TexturePool();
+
+    // The pool shared by all images.
+    static TexturePool& instance();
+
+    // Returns a texture with storage of the given size, channel count (1 to 4) and type, reusing a released one if possible.
+    uint32_t acquire(int32_t width, int32_t height, int32_t channels, PixelType type = PixelType::UInt8);
+
+    // Hands a texture obtained from acquire() back to the pool.
+    void release(uint32_t texture, int32_t width, int32_t height, int32_t channels, PixelType type = PixelType::UInt8);
+
+    // Deletes every pooled texture. Must be called before the OpenGL context is destroyed.
+    void clear();
+
+    // Deletes least recently released textures until at least `bytes` are released (or the pool is empty). Returns the bytes released.
+    size_t trim(size_t bytes);
+
+    size_t getReuseCount() const;
+    size_t getAllocationCount() const;
+    size_t getPooledBytes() const;
+    size_t getPooledTextureCount() const;
+
+    // Estimated GPU memory used by a texture of the given size, channel count and type (a single level, pooled textures have no mipmaps).
+    static size_t estimateSizeInBytes(int32_t width, int32_t height, int32_t channels, PixelType type = PixelType::UInt8);
+
+    // Pixel format (GL_RED, GL_RG, GL_RGB or GL_RGBA) of client pixels with the given channel count.
+    static uint32_t getPixelFormat(int32_t channels);
+
+    // Data type (GL_UNSIGNED_BYTE, GL_UNSIGNED_SHORT or GL_FLOAT) of client pixels of the given type.
+    static uint32_t getPixelDataType(PixelType type);
+
+    // Disable copying TexturePool objects.
+    TexturePool(const TexturePool&) = delete;
+    TexturePool& operator=(const TexturePool&) = delete;
+
+private:
+    // Width, height, channel count and pixel type.
+    using Shape = std::tuple<int32_t, int32_t, int32_t, PixelType>;
+
+    struct Entry {
+        uint32_t        texture;
+        Shape           shape;
+    };
+
+    static uint32_t allocate(int32_t width, int32_t height, int32_t channels, PixelType type);
+    void evictOverBudget();
+    size_t evictLeastRecentlyReleased();
+
+    size_t                                                  m_byte_budget;
+    size_t                                                  m_pooled_bytes{ 0 };
+    size_t                                                  m_reuse_count{ 0 };
+    size_t                                                  m_allocation_count{ 0 };
+
+    // Most recently released textures are at the front.
+    std::list<Entry>                                        m_entries;
+    std::multimap<Shape, std::list<Entry>::iterator>        m_buckets;
+};
@@ -0,0 +1,185 @@
+#include <algorithm>
+#include <cstring>
+#include "textureUpload.h"
+#include "constants.h"
+#include "texturePool.h"
+
+namespace {
+    double millisecondsSince(std::chrono::time_point<std::chrono::steady_clock> start) {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+}
+
+PixelUnpackRing::PixelUnpackRing(size_t buffer_count)
+    : m_buffers(std::max<size_t>(buffer_count, 1)) {
+    for (Buffer& buffer : m_buffers) {
+        glGenBuffers(1, &buffer.id);
+    }
+}
+
+PixelUnpackRing::~PixelUnpackRing() {
+    for (Buffer& buffer : m_buffers) {
+        if (buffer.fence) {
+            glDeleteSync(buffer.fence);
+        }
+        glDeleteBuffers(1, &buffer.id);
+    }
+}
+
+PixelUnpackRing::Buffer* PixelUnpackRing::acquire() {
+    Buffer& buffer = m_buffers.at(m_next);
+    if (buffer.fence) {
+        GLenum status = glClientWaitSync(buffer.fence, 0, 0);
+        if (status == GL_TIMEOUT_EXPIRED) {
+            return nullptr;
+        }
+        glDeleteSync(buffer.fence);
+        buffer.fence = nullptr;
+    }
+    return &buffer;
+}
+
+void PixelUnpackRing::release(Buffer* buffer) {
+    buffer->fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    m_next = (m_next + 1) % m_buffers.size();
+}
+
+TextureUpload::TextureUpload(ImageData data, TextureUploadMode mode, PixelUnpackRing& ring)
+    : m_data(std::move(data)), m_mode(mode), m_ring(ring), m_start_time(std::chrono::steady_clock::now()) {
+    m_stats = TextureUploadStats{
+        mode,
+        m_data.getWidth(),
+        m_data.getHeight(),
+        m_data.getSizeInBytes(),
+        0,
+        0.0,
+        0.0
+    };
+}
+
+TextureUpload::~TextureUpload() {
+    if (m_texture) {
+        Image::releaseTexture(m_texture, m_data.getWidth(), m_data.getHeight(), m_data.getChannelCount(), m_data.getPixelType());
+        m_texture = 0;
+    }
+}
+
+bool TextureUpload::step(size_t byte_budget) {
+    if (m_complete) {
+        return true;
+    }
+
+    auto step_start_time = std::chrono::steady_clock::now();
+
+    if (m_mode == TextureUploadMode::Synchronous) {
+        uploadSynchronously();
+    } else {
+        uploadSlices(byte_budget);
+    }
+
+    m_stats.frames++;
+    m_stats.max_step_milliseconds = std::max(m_stats.max_step_milliseconds, millisecondsSince(step_start_time));
+    if (m_complete) {
+        m_stats.total_milliseconds = millisecondsSince(m_start_time);
+    }
+    return m_complete;
+}
+
+bool TextureUpload::isComplete() const {
+    return m_complete;
+}
+
+Image TextureUpload::finish() {
+    if (! m_complete) {
+        throw std::logic_error("error: texture upload hasn't completed yet");
+    }
+
+    uint32_t texture = m_texture;
+    m_texture = 0;
+    return Image(
+        reinterpret_cast<ImTextureID>(static_cast<uintptr_t>(texture)),
+        m_data.getWidth(),
+        m_data.getHeight(),
+        m_data.getChannelCount(),
+        m_data.getPixelType(),
+        m_data.getSourceWidth(),
+        m_data.getSourceHeight()
+    );
+}
+
+const TextureUploadStats& TextureUpload::getStats() const {
+    return m_stats;
+}
+
+void TextureUpload::uploadSynchronously() {
+    m_texture = Image::createTexture(m_data.getPixels(), m_data.getWidth(), m_data.getHeight(), m_data.getChannelCount(), m_data.getPixelType());
+    m_next_row = m_data.getHeight();
+    m_complete = true;
+}
+
+void TextureUpload::uploadSlices(size_t byte_budget) {
+    if (! m_texture) {
+        m_texture = Image::allocateTexture(m_data.getWidth(), m_data.getHeight(), m_data.getChannelCount(), m_data.getPixelType());
+    }
+
+    const size_t row_bytes = static_cast<size_t>(m_data.getWidth()) * m_data.getChannelCount() * getBytesPerChannel(m_data.getPixelType());
+    const size_t slice_bytes = std::min(byte_budget, TEXTURE_UPLOAD_SLICE_BYTES);
+    const int32_t rows_per_slice = std::max<int32_t>(1, static_cast<int32_t>(slice_bytes / row_bytes));
+
+    glBindTexture(GL_TEXTURE_2D, m_texture);
+
+    // Rows of 1 to 3 channel pixels aren't necessarily 4-byte aligned.
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+    size_t uploaded_bytes = 0;
+    while (m_next_row < m_data.getHeight() && uploaded_bytes < byte_budget) {
+
+        // Stop for this frame rather than stall if the GPU is still reading every buffer.
+        PixelUnpackRing::Buffer* buffer = m_ring.acquire();
+        if (! buffer) {
+            break;
+        }
+
+        const int32_t rows = std::min(rows_per_slice, m_data.getHeight() - m_next_row);
+        const size_t bytes = static_cast<size_t>(rows) * row_bytes;
+
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, buffer->id);
+        if (buffer->capacity < bytes) {
+            glBufferData(GL_PIXEL_UNPACK_BUFFER, static_cast<GLsizeiptr>(bytes), nullptr, GL_STREAM_DRAW);
+            buffer->capacity = bytes;
+        }
+
+        const uint8_t* pixels = m_data.getPixels() + static_cast<size_t>(m_next_row) * row_bytes;
+        bool staged = false;
+        void* mapped = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, static_cast<GLsizeiptr>(bytes), GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+        if (mapped) {
+            std::memcpy(mapped, pixels, bytes);
+            staged = glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER) == GL_TRUE;
+        }
+
+        const GLenum format = TexturePool::getPixelFormat(m_data.getChannelCount());
+        const GLenum type = TexturePool::getPixelDataType(m_data.getPixelType());
+        if (staged) {
+
+            // With a pixel unpack buffer bound, the data pointer is an offset into that buffer.
+            glTexSubImage2D(GL_TEXTURE_2D, 0, 0, m_next_row, m_data.getWidth(), rows, format, type, nullptr);
+            m_ring.release(buffer);
+        } else {
+
+            // Mapping can keep failing (e.g. when the driver is short on memory), so rather than leave the
+            // upload pending the slice is copied from client memory, at the cost of a stall.
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+            glTexSubImage2D(GL_TEXTURE_2D, 0, 0, m_next_row, m_data.getWidth(), rows, format, type, pixels);
+        }
+
+        m_next_row += rows;
+        uploaded_bytes += bytes;
+    }
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+    if (m_next_row == m_data.getHeight()) {
+        m_complete = true;
+    }
+    glBindTexture(GL_TEXTURE_2D, 0);
+}
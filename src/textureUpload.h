@@ -0,0 +1,103 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+#include <glad/glad.h>
+
+#include "image.h"
+
+enum class TextureUploadMode: int32_t {
+    Synchronous = 0,    // One glTexSubImage2D from client memory into a pooled texture, within a single frame.
+    Streamed = 1        // Slices staged in pixel unpack buffers, spread across frames.
+};
+
+struct TextureUploadStats {
+    TextureUploadMode   mode;
+    int32_t             width;
+    int32_t             height;
+    size_t              bytes;
+    int32_t             frames;                 // Number of step() calls it took.
+    double              total_milliseconds;     // From the start of the upload until it completed.
+    double              max_step_milliseconds;  // Longest time spent in a single step() (i.e. frame).
+};
+
+/**
+ * @brief A ring of pixel unpack buffers (PBOs) shared by streamed uploads.
+ *
+ * Each buffer is guarded by a fence so that it is only rewritten once the GPU has finished
+ * copying its previous contents into a texture. Must be used on the OpenGL thread.
+ */
+class PixelUnpackRing {
+public:
+    explicit PixelUnpackRing(size_t buffer_count);
+    ~PixelUnpackRing();
+
+    struct Buffer {
+        uint32_t        id{ 0 };
+        size_t          capacity{ 0 };
+        GLsync          fence{ nullptr };
+    };
+
+    // Returns the next buffer if the GPU is done with it, `nullptr` otherwise (never blocks).
+    Buffer* acquire();
+
+    // Fences the buffer returned by acquire() after the commands reading from it have been issued.
+    void release(Buffer* buffer);
+
+    // Disable copying PixelUnpackRing objects.
+    PixelUnpackRing(const PixelUnpackRing&) = delete;
+    PixelUnpackRing& operator=(const PixelUnpackRing&) = delete;
+
+private:
+    std::vector<Buffer>     m_buffers;
+    size_t                  m_next{ 0 };
+};
+
+/**
+ * @brief Uploads decoded pixels into a new Image, either at once or in slices across frames.
+ *
+ * Call step() once per frame on the OpenGL thread until it returns `true`, then finish() to
+ * obtain the Image. Destroying an unfinished upload hands its texture back to the texture pool.
+ * A streamed slice that can't be staged (the buffer fails to map) is uploaded from client memory.
+ */
+class TextureUpload {
+public:
+    TextureUpload(ImageData data, TextureUploadMode mode, PixelUnpackRing& ring);
+    ~TextureUpload();
+
+    /**
+     * @brief Uploads the next rows, at most about `byte_budget` bytes (at least one row).
+     * In synchronous mode the whole image is uploaded regardless of the budget.
+     *
+     * @return `true` once the whole image has been uploaded.
+     */
+    bool step(size_t byte_budget);
+
+    bool isComplete() const;
+
+    // Hands the texture over to an Image. Only valid once step() has returned `true`.
+    Image finish();
+
+    const TextureUploadStats& getStats() const;
+
+    // Disable copying TextureUpload objects.
+    TextureUpload(const TextureUpload&) = delete;
+    TextureUpload& operator=(const TextureUpload&) = delete;
+
+private:
+    void uploadSynchronously();
+    void uploadSlices(size_t byte_budget);
+
+    ImageData                                               m_data;
+    TextureUploadMode                                       m_mode;
+    PixelUnpackRing&                                        m_ring;
+
+    uint32_t                                                m_texture{ 0 };
+    int32_t                                                 m_next_row{ 0 };
+    bool                                                    m_complete{ false };
+
+    std::chrono::time_point<std::chrono::steady_clock>      m_start_time;
+    TextureUploadStats                                      m_stats;
+};
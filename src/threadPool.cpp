@@ -0,0 +1,57 @@
+#include <algorithm>
+#include "threadPool.h"
+
+ThreadPool::ThreadPool(size_t thread_count) {
+    thread_count = std::max<size_t>(thread_count, 1);
+    m_workers.reserve(thread_count);
+    for (size_t i = 0; i < thread_count; i++) {
+        m_workers.emplace_back(&ThreadPool::workerLoop, this);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+
+        // Drop tasks that haven't started yet.
+        m_tasks.clear();
+    }
+    m_condition.notify_all();
+
+    for (auto& worker : m_workers) {
+        worker.join();
+    }
+}
+
+size_t ThreadPool::getThreadCount() const {
+    return m_workers.size();
+}
+
+void ThreadPool::enqueue(std::function<void()> task, bool high_priority) {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (high_priority) {
+            m_tasks.push_front(std::move(task));
+        } else {
+            m_tasks.push_back(std::move(task));
+        }
+    }
+    m_condition.notify_one();
+}
+
+void ThreadPool::workerLoop() {
+    while (true) {
+        std::function<void()> task;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_condition.wait(lock, [this] { return m_stopping || !m_tasks.empty(); });
+            if (m_stopping) {
+                return;
+            }
+            task = std::move(m_tasks.front());
+            m_tasks.pop_front();
+        }
+        task();
+    }
+}
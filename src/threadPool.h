@@ -0,0 +1,51 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+/**
+ * @brief A fixed set of worker threads that execute submitted tasks in FIFO order.
+ *
+ * Tasks submitted with `high_priority` set are placed at the front of the queue so that
+ * work the user is waiting on (e.g. the image currently being previewed) overtakes
+ * speculative background work. Tasks still queued when the pool is destroyed are discarded
+ * and their futures report `std::future_errc::broken_promise`.
+ */
+class ThreadPool {
+public:
+    explicit ThreadPool(size_t thread_count);
+    ~ThreadPool();
+
+    template <typename F>
+    auto submit(F&& task, bool high_priority = false) -> std::future<std::invoke_result_t<std::decay_t<F>>> {
+        using Result = std::invoke_result_t<std::decay_t<F>>;
+
+        auto packaged_task = std::make_shared<std::packaged_task<Result()>>(std::forward<F>(task));
+        std::future<Result> future = packaged_task->get_future();
+        enqueue([packaged_task]() { (*packaged_task)(); }, high_priority);
+        return future;
+    }
+
+    size_t getThreadCount() const;
+
+    // Disable copying ThreadPool objects.
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+private:
+    void enqueue(std::function<void()> task, bool high_priority);
+    void workerLoop();
+
+    std::vector<std::thread>                m_workers;
+    std::deque<std::function<void()>>       m_tasks;
+    std::mutex                              m_mutex;
+    std::condition_variable                 m_condition;
+    bool                                    m_stopping{ false };
+};
@@ -0,0 +1,177 @@
+#include <algorithm>
+#include <glad/glad.h>
+#include "thumbnailAtlas.h"
+
+ThumbnailAtlas::ThumbnailAtlas(int32_t page_size, int32_t cell_size, size_t max_page_count)
+    : m_page_size(page_size), m_cell_size(std::min(cell_size, page_size)), m_max_page_count(std::max<size_t>(max_page_count, 1)), m_page_limit(m_max_page_count) {}
+
+ThumbnailAtlas::~ThumbnailAtlas() {
+    clear();
+}
+
+const ThumbnailAtlas::Cell* ThumbnailAtlas::find(const std::string& filepath) {
+    auto it = m_lookup.find(filepath);
+    if (it == m_lookup.end()) {
+        return nullptr;
+    }
+
+    m_entries.splice(m_entries.begin(), m_entries, it->second);
+    m_page_use_times[it->second->slot.page] = ++m_use_time;
+    return &it->second->cell;
+}
+
+const ThumbnailAtlas::Cell* ThumbnailAtlas::insert(const std::string& filepath, const uint8_t* pixels, int32_t width, int32_t height) {
+    erase(filepath);
+
+    width = std::min(width, m_cell_size);
+    height = std::min(height, m_cell_size);
+
+    Slot slot = allocateSlot();
+    glBindTexture(GL_TEXTURE_2D, m_pages.at(slot.page));
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, width);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, slot.x, slot.y, width, height, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    // Texture coordinates are inset by half a texel so that filtering never picks up a neighboring cell.
+    const float page_size = static_cast<float>(m_page_size);
+    Cell cell{
+        reinterpret_cast<ImTextureID>(static_cast<uintptr_t>(m_pages.at(slot.page))),
+        ImVec2((slot.x + 0.5f) / page_size, (slot.y + 0.5f) / page_size),
+        ImVec2((slot.x + width - 0.5f) / page_size, (slot.y + height - 0.5f) / page_size),
+        width,
+        height
+    };
+
+    m_page_use_times[slot.page] = ++m_use_time;
+    m_entries.push_front(Entry{filepath, slot, cell});
+    m_lookup.emplace(filepath, m_entries.begin());
+    return &m_entries.front().cell;
+}
+
+void ThumbnailAtlas::erase(const std::string& filepath) {
+    auto it = m_lookup.find(filepath);
+    if (it == m_lookup.end()) {
+        return;
+    }
+
+    m_free_slots.push_back(it->second->slot);
+    m_entries.erase(it->second);
+    m_lookup.erase(it);
+}
+
+size_t ThumbnailAtlas::evict(size_t bytes) {
+    size_t released_bytes = 0;
+    while (released_bytes < bytes && m_page_count > 1) {
+        size_t least_recently_used = m_pages.size();
+        for (size_t page = 0; page < m_pages.size(); page++) {
+            if (m_pages[page] != 0 && (least_recently_used == m_pages.size() || m_page_use_times[page] < m_page_use_times[least_recently_used])) {
+                least_recently_used = page;
+            }
+        }
+        deletePage(least_recently_used);
+        released_bytes += getPageSizeInBytes();
+    }
+    m_page_limit = std::min(m_page_limit, std::max<size_t>(m_page_count, 1));
+    return released_bytes;
+}
+
+void ThumbnailAtlas::restorePageLimit() {
+    m_page_limit = m_max_page_count;
+}
+
+void ThumbnailAtlas::clear() {
+    for (uint32_t page : m_pages) {
+        if (page != 0) {
+            glDeleteTextures(1, &page);
+        }
+    }
+    m_pages.clear();
+    m_page_use_times.clear();
+    m_page_count = 0;
+    m_free_slots.clear();
+    m_entries.clear();
+    m_lookup.clear();
+}
+
+size_t ThumbnailAtlas::getPageCount() const {
+    return m_page_count;
+}
+
+size_t ThumbnailAtlas::getThumbnailCount() const {
+    return m_entries.size();
+}
+
+size_t ThumbnailAtlas::getSizeInBytes() const {
+    return m_page_count * getPageSizeInBytes();
+}
+
+ThumbnailAtlas::Slot ThumbnailAtlas::allocateSlot() {
+    if (m_free_slots.empty()) {
+        if (m_page_count < m_page_limit) {
+            addPage();
+        } else {
+            const Entry& least_recently_used = m_entries.back();
+            m_free_slots.push_back(least_recently_used.slot);
+            m_lookup.erase(least_recently_used.filepath);
+            m_entries.pop_back();
+        }
+    }
+
+    Slot slot = m_free_slots.back();
+    m_free_slots.pop_back();
+    return slot;
+}
+
+void ThumbnailAtlas::addPage() {
+    uint32_t texture;
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_2D, texture);
+
+    // Clamped so that sampling at the edge of a cell doesn't bleed in the opposite edge of the page.
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, m_page_size, m_page_size, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    size_t page = std::find(m_pages.begin(), m_pages.end(), 0u) - m_pages.begin();
+    if (page == m_pages.size()) {
+        m_pages.push_back(texture);
+        m_page_use_times.push_back(0);
+    } else {
+        m_pages[page] = texture;
+    }
+    m_page_use_times[page] = m_use_time;
+    m_page_count++;
+
+    // Hand out the cells of the new page in reading order.
+    int32_t cells_per_row = m_page_size / m_cell_size;
+    for (int32_t row = cells_per_row - 1; row >= 0; row--) {
+        for (int32_t column = cells_per_row - 1; column >= 0; column--) {
+            m_free_slots.push_back(Slot{page, column * m_cell_size, row * m_cell_size});
+        }
+    }
+}
+
+void ThumbnailAtlas::deletePage(size_t page) {
+    for (auto it = m_entries.begin(); it != m_entries.end();) {
+        if (it->slot.page == page) {
+            m_lookup.erase(it->filepath);
+            it = m_entries.erase(it);
+        } else {
+            it++;
+        }
+    }
+    std::erase_if(m_free_slots, [page](const Slot& slot) { return slot.page == page; });
+
+    glDeleteTextures(1, &m_pages[page]);
+    m_pages[page] = 0;
+    m_page_count--;
+}
+
+size_t ThumbnailAtlas::getPageSizeInBytes() const {
+    return static_cast<size_t>(m_page_size) * static_cast<size_t>(m_page_size) * 4;
+}
@@ -0,0 +1,97 @@
+#pragma once
+
+#include <cstdint>
+#include <list>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <imgui.h>
+
+/**
+ * @brief Packs thumbnails into a few large textures so a grid of them is drawn in a handful of draw calls.
+ *
+ * Each page is a square texture divided into equally sized cells, one thumbnail per cell. Pages are
+ * added on demand up to a maximum, after which the cells of the least recently used thumbnails are
+ * reused. Must only be used on the OpenGL thread.
+ */
+class ThumbnailAtlas {
+public:
+    struct Cell {
+        ImTextureID     texture;
+        ImVec2          uv_min;
+        ImVec2          uv_max;
+        int32_t         width;      // Of the thumbnail, in pixels.
+        int32_t         height;
+    };
+
+    ThumbnailAtlas(int32_t page_size, int32_t cell_size, size_t max_page_count);
+    ~ThumbnailAtlas();
+
+    // Looks up the cell of a thumbnail, marking it as most recently used.
+    const Cell* find(const std::string& filepath);
+
+    // Copies RGBA pixels (at most `cell_size` x `cell_size`) into a cell, evicting the least recently used one if full.
+    const Cell* insert(const std::string& filepath, const uint8_t* pixels, int32_t width, int32_t height);
+
+    void erase(const std::string& filepath);
+
+    /**
+     * @brief Deletes the pages whose thumbnails were used the longest ago until at least `bytes` are
+     * released, always keeping one page. The atlas then doesn't grow back past the pages left until
+     * restorePageLimit(), so that it isn't refilled only to be evicted again.
+     *
+     * @return The bytes released.
+     */
+    size_t evict(size_t bytes);
+
+    // Lets the atlas grow up to its maximum page count again.
+    void restorePageLimit();
+
+    // Deletes every page. Must be called before the OpenGL context is destroyed.
+    void clear();
+
+    size_t getPageCount() const;
+    size_t getThumbnailCount() const;
+
+    // GPU memory used by the pages.
+    size_t getSizeInBytes() const;
+
+    // Disable copying ThumbnailAtlas objects.
+    ThumbnailAtlas(const ThumbnailAtlas&) = delete;
+    ThumbnailAtlas& operator=(const ThumbnailAtlas&) = delete;
+
+private:
+    struct Slot {
+        size_t          page;
+        int32_t         x;
+        int32_t         y;
+    };
+
+    struct Entry {
+        std::string     filepath;
+        Slot            slot;
+        Cell            cell;
+    };
+
+    // Returns a free slot, adding a page or evicting the least recently used thumbnail if needed.
+    Slot allocateSlot();
+    void addPage();
+    void deletePage(size_t page);
+    size_t getPageSizeInBytes() const;
+
+    int32_t                                                             m_page_size;
+    int32_t                                                             m_cell_size;
+    size_t                                                              m_max_page_count;
+    size_t                                                              m_page_limit;           // Lowered by evict().
+
+    std::vector<uint32_t>                                               m_pages;                // 0 for deleted pages, whose index is reused.
+    std::vector<uint64_t>                                               m_page_use_times;       // Of the most recently used thumbnail of each page.
+    uint64_t                                                            m_use_time{ 0 };
+    size_t                                                              m_page_count{ 0 };
+    std::vector<Slot>                                                   m_free_slots;
+
+    // Most recently used thumbnails are at the front.
+    std::list<Entry>                                                    m_entries;
+    std::unordered_map<std::string, std::list<Entry>::iterator>         m_lookup;
+};
@@ -0,0 +1,234 @@
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <stdexcept>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "thumbnailPack.h"
+#include "util.h"
+
+namespace {
+    const char      PACK_MAGIC[8]   = {'M', 'L', 'B', 'C', 'T', 'H', 'M', 'B'};
+    const uint32_t  PACK_VERSION    = 1;
+
+    // Writes the whole buffer at the given offset, retrying short writes.
+    bool writeFully(int fd, const void* data, size_t size, size_t offset) {
+        const uint8_t* bytes = static_cast<const uint8_t*>(data);
+        while (size > 0) {
+            ssize_t written = pwrite(fd, bytes, size, static_cast<off_t>(offset));
+            if (written <= 0) {
+                return false;
+            }
+            bytes += written;
+            size -= static_cast<size_t>(written);
+            offset += static_cast<size_t>(written);
+        }
+        return true;
+    }
+}
+
+ThumbnailPack::ThumbnailPack(const std::string& filepath, size_t max_size_in_bytes)
+    : m_filepath(filepath), m_max_size_in_bytes(max_size_in_bytes) {
+    namespace fs = std::filesystem;
+
+    std::error_code ec;
+    fs::create_directories(fs::path(filepath).parent_path(), ec);
+
+    m_fd = open(filepath.c_str(), O_RDWR | O_CREAT, 0644);
+    if (m_fd < 0) {
+        throw std::runtime_error("error: couldn't open thumbnail pack: " + filepath);
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    struct stat file_stat;
+    if (fstat(m_fd, &file_stat) != 0) {
+        close(m_fd);
+        throw std::runtime_error("error: couldn't stat thumbnail pack: " + filepath);
+    }
+    m_file_size = static_cast<size_t>(file_stat.st_size);
+
+    Header header{};
+    bool valid = m_file_size >= sizeof(Header) && m_file_size <= m_max_size_in_bytes
+        && pread(m_fd, &header, sizeof(Header), 0) == static_cast<ssize_t>(sizeof(Header))
+        && std::memcmp(header.magic, PACK_MAGIC, sizeof(PACK_MAGIC)) == 0
+        && header.version == PACK_VERSION;
+
+    try {
+        if (! valid) {
+            reset();
+        }
+        loadIndex();
+    } catch (const std::runtime_error&) {
+        if (m_mapping) {
+            munmap(m_mapping, m_mapped_size);
+        }
+        close(m_fd);
+        throw;
+    }
+}
+
+ThumbnailPack::~ThumbnailPack() {
+    if (m_mapping) {
+        munmap(m_mapping, m_mapped_size);
+        m_mapping = nullptr;
+    }
+    if (m_fd >= 0) {
+        close(m_fd);
+        m_fd = -1;
+    }
+}
+
+std::optional<ThumbnailPack::Thumbnail> ThumbnailPack::find(const TextureCache::Key& key) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    auto it = m_index.find(hashPath(key.filepath));
+    if (it == m_index.end()) {
+        return std::nullopt;
+    }
+
+    const Location& location = it->second;
+    if (location.file_size != key.file_size || location.modification_time != key.modification_time.time_since_epoch().count()) {
+        return std::nullopt;
+    }
+
+    // Records added since the last lookup lie beyond the current mapping, which is of the previous file if the pack started over.
+    size_t end = location.offset + static_cast<size_t>(location.width) * location.height * 4;
+    if (m_mapping_stale || end > m_mapped_size) {
+        if (! remap() || end > m_mapped_size) {
+            return std::nullopt;
+        }
+    }
+
+    return Thumbnail{m_mapping + location.offset, location.width, location.height};
+}
+
+void ThumbnailPack::add(const TextureCache::Key& key, const uint8_t* pixels, int32_t width, int32_t height) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    size_t pixels_size = static_cast<size_t>(width) * height * 4;
+    if (sizeof(Header) + sizeof(RecordHeader) + pixels_size > m_max_size_in_bytes) {
+        return;
+    }
+    if (m_file_size + sizeof(RecordHeader) + pixels_size > m_max_size_in_bytes) {
+
+        // Full, mostly of thumbnails superseded or no longer looked at: start over rather than stop caching.
+        try {
+            reset();
+        } catch (const std::runtime_error& re) {
+            std::cerr << re.what() << std::endl;
+            return;
+        }
+    }
+
+    RecordHeader record{
+        hashPath(key.filepath),
+        key.file_size,
+        key.modification_time.time_since_epoch().count(),
+        static_cast<uint32_t>(width),
+        static_cast<uint32_t>(height)
+    };
+    size_t offset = m_file_size;
+    if (! writeFully(m_fd, &record, sizeof(RecordHeader), offset) || ! writeFully(m_fd, pixels, pixels_size, offset + sizeof(RecordHeader))) {
+
+        // Leave the partial record to be cut off by the next loadIndex().
+        return;
+    }
+
+    m_file_size = offset + sizeof(RecordHeader) + pixels_size;
+    m_index[record.path_hash] = Location{offset + sizeof(RecordHeader), record.file_size, record.modification_time, width, height};
+}
+
+size_t ThumbnailPack::getThumbnailCount() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_index.size();
+}
+
+size_t ThumbnailPack::getSizeInBytes() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_file_size;
+}
+
+void ThumbnailPack::reset() {
+
+    // A new file replaces the pack rather than truncating it, since truncating pages still mapped
+    // (e.g. a thumbnail find() just returned) would fault on the next read of them.
+    const std::string temporary_filepath = m_filepath + ".tmp";
+    int fd = open(temporary_filepath.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        throw std::runtime_error("error: couldn't create thumbnail pack: " + temporary_filepath);
+    }
+
+    Header header{};
+    std::memcpy(header.magic, PACK_MAGIC, sizeof(PACK_MAGIC));
+    header.version = PACK_VERSION;
+    if (! writeFully(fd, &header, sizeof(Header), 0) || rename(temporary_filepath.c_str(), m_filepath.c_str()) != 0) {
+        close(fd);
+        unlink(temporary_filepath.c_str());
+        throw std::runtime_error("error: couldn't write thumbnail pack: " + m_filepath);
+    }
+
+    // The mapping of the old file stays valid until the next find() remaps.
+    close(m_fd);
+    m_fd = fd;
+    m_file_size = sizeof(Header);
+    m_index.clear();
+    m_mapping_stale = true;
+}
+
+void ThumbnailPack::loadIndex() {
+    if (! remap()) {
+        throw std::runtime_error("error: couldn't map thumbnail pack: " + m_filepath);
+    }
+
+    size_t offset = sizeof(Header);
+    while (offset + sizeof(RecordHeader) <= m_mapped_size) {
+        RecordHeader record;
+        std::memcpy(&record, m_mapping + offset, sizeof(RecordHeader));
+
+        size_t pixels_size = static_cast<size_t>(record.width) * record.height * 4;
+        size_t end = offset + sizeof(RecordHeader) + pixels_size;
+        if (record.width == 0 || record.height == 0 || end > m_mapped_size) {
+            break;
+        }
+
+        // Later records supersede earlier ones for the same path.
+        m_index[record.path_hash] = Location{
+            offset + sizeof(RecordHeader),
+            record.file_size,
+            record.modification_time,
+            static_cast<int32_t>(record.width),
+            static_cast<int32_t>(record.height)
+        };
+        offset = end;
+    }
+
+    // Drop whatever follows the last complete record (e.g. a write interrupted by a crash).
+    if (offset < m_file_size) {
+        if (ftruncate(m_fd, static_cast<off_t>(offset)) != 0) {
+            throw std::runtime_error("error: couldn't truncate thumbnail pack: " + m_filepath);
+        }
+        m_file_size = offset;
+        if (! remap()) {
+            throw std::runtime_error("error: couldn't map thumbnail pack: " + m_filepath);
+        }
+    }
+}
+
+bool ThumbnailPack::remap() {
+    if (m_mapping) {
+        munmap(m_mapping, m_mapped_size);
+        m_mapping = nullptr;
+        m_mapped_size = 0;
+    }
+
+    void* mapping = mmap(nullptr, m_file_size, PROT_READ, MAP_SHARED, m_fd, 0);
+    if (mapping == MAP_FAILED) {
+        return false;
+    }
+    m_mapping = static_cast<uint8_t*>(mapping);
+    m_mapped_size = m_file_size;
+    m_mapping_stale = false;
+    return true;
+}
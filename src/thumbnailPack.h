@@ -0,0 +1,95 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+
+#include "textureCache.h"
+
+/**
+ * @brief A persistent, memory-mapped store of RGBA thumbnails.
+ *
+ * The pack is an append-only file: a header followed by records, each made of the hash of the
+ * image path, the size and modification time of the image file and the thumbnail pixels. The
+ * index of the records is rebuilt when the pack is opened, after which lookups read the pixels
+ * straight from the mapping. A rewritten image gets a new record; the stale one is simply ignored,
+ * and the pack is started over (in a new file, so that thumbnails returned by find() stay readable)
+ * once a record wouldn't fit within its size limit.
+ *
+ * add() is safe to call from any thread. find() must only be called from a single thread.
+ */
+class ThumbnailPack {
+public:
+    struct Thumbnail {
+        const uint8_t*      pixels;     // Valid until the next call to find().
+        int32_t             width;
+        int32_t             height;
+    };
+
+    /**
+     * @brief Opens (or creates) the pack at the given path.
+     *
+     * @throws std::runtime_error if the pack can't be created, opened or mapped.
+     */
+    ThumbnailPack(const std::string& filepath, size_t max_size_in_bytes);
+    ~ThumbnailPack();
+
+    // Looks up the thumbnail of the file identified by the key, if it is up to date.
+    std::optional<Thumbnail> find(const TextureCache::Key& key);
+
+    // Appends a thumbnail, starting the pack over first if it is full.
+    void add(const TextureCache::Key& key, const uint8_t* pixels, int32_t width, int32_t height);
+
+    size_t getThumbnailCount() const;
+    size_t getSizeInBytes() const;
+
+    // Disable copying ThumbnailPack objects.
+    ThumbnailPack(const ThumbnailPack&) = delete;
+    ThumbnailPack& operator=(const ThumbnailPack&) = delete;
+
+private:
+    struct Header {
+        char                magic[8];
+        uint32_t            version;
+        uint32_t            reserved;
+    };
+
+    struct RecordHeader {
+        uint64_t            path_hash;
+        uint64_t            file_size;
+        int64_t             modification_time;
+        uint32_t            width;
+        uint32_t            height;
+    };
+
+    struct Location {
+        size_t              offset;     // Of the pixels.
+        uint64_t            file_size;
+        int64_t             modification_time;
+        int32_t             width;
+        int32_t             height;
+    };
+
+    // Starts over with an empty pack in a new file. Expects m_mutex to be held.
+    void reset();
+
+    // Rebuilds the index from the records, dropping a truncated trailing record. Expects m_mutex to be held.
+    void loadIndex();
+
+    // Maps the file as it currently is, `false` on failure. Expects m_mutex to be held.
+    bool remap();
+
+    std::string                                     m_filepath;
+    size_t                                          m_max_size_in_bytes;
+    int                                             m_fd{ -1 };
+    uint8_t*                                        m_mapping{ nullptr };
+    size_t                                          m_mapped_size{ 0 };
+    size_t                                          m_file_size{ 0 };
+    bool                                            m_mapping_stale{ false };       // Maps a file the pack has replaced.
+    std::unordered_map<uint64_t, Location>          m_index;
+
+    mutable std::mutex                              m_mutex;
+};
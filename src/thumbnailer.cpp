@@ -0,0 +1,154 @@
+#include "thumbnailer.h"
+#include "constants.h"
+#include "util.h"
+
+Thumbnailer::Thumbnailer(ThreadPool& thread_pool, std::shared_ptr<ThumbnailPack> pack)
+    : m_thread_pool(thread_pool), m_pack(std::move(pack)),
+      m_atlas(THUMBNAIL_ATLAS_PAGE_SIZE, THUMBNAIL_SIZE, THUMBNAIL_ATLAS_MAX_PAGE_COUNT) {}
+
+const ThumbnailAtlas::Cell* Thumbnailer::request(const std::string& filepath) {
+    const ThumbnailAtlas::Cell* cell = m_atlas.find(filepath);
+    if (! cell && ! m_failed.contains(filepath)) {
+        m_requested.push_back(filepath);
+    }
+    return cell;
+}
+
+bool Thumbnailer::hasFailed(const std::string& filepath) const {
+    return m_failed.contains(filepath);
+}
+
+void Thumbnailer::update() {
+    {
+        std::vector<std::string> invalidations;
+        {
+            std::lock_guard<std::mutex> lock(m_pending_invalidations_mutex);
+            invalidations.swap(m_pending_invalidations);
+        }
+        for (const std::string& filepath : invalidations) {
+            m_atlas.erase(filepath);
+            m_failed.erase(filepath);
+            auto it = m_pending.find(filepath);
+            if (it != m_pending.end()) {
+                it->second.cancelled->store(true);
+                m_pending.erase(it);
+            }
+        }
+    }
+
+    if (m_atlas_release_time && std::chrono::steady_clock::now() - m_atlas_release_time.value() >= std::chrono::milliseconds(THUMBNAIL_ATLAS_REGROW_DELAY_MS)) {
+        m_atlas.restorePageLimit();
+        m_atlas_release_time = std::nullopt;
+    }
+
+    // Uploads are capped per frame so that scrolling through a cached folder doesn't stall a frame.
+    size_t upload_count = 0;
+    collectFinished(upload_count);
+
+    // Cancel decodes of files that are no longer in view.
+    std::unordered_set<std::string> requested(m_requested.begin(), m_requested.end());
+    for (auto it = m_pending.begin(); it != m_pending.end();) {
+        if (! requested.contains(it->first)) {
+            it->second.cancelled->store(true);
+            it = m_pending.erase(it);
+        } else {
+            it++;
+        }
+    }
+
+    for (const std::string& filepath : m_requested) {
+        schedule(filepath, upload_count);
+    }
+    m_requested.clear();
+}
+
+void Thumbnailer::invalidate(const std::string& filepath) {
+    std::lock_guard<std::mutex> lock(m_pending_invalidations_mutex);
+    m_pending_invalidations.push_back(filepath);
+}
+
+size_t Thumbnailer::getPendingCount() const {
+    return m_pending.size();
+}
+
+const ThumbnailAtlas& Thumbnailer::getAtlas() const {
+    return m_atlas;
+}
+
+size_t Thumbnailer::releaseAtlas(size_t bytes) {
+    m_atlas_release_time = std::chrono::steady_clock::now();
+    return m_atlas.evict(bytes);
+}
+
+void Thumbnailer::releaseGPUResources() {
+    for (auto& [filepath, pending] : m_pending) {
+        pending.cancelled->store(true);
+    }
+    m_pending.clear();
+    m_requested.clear();
+    m_atlas.clear();
+}
+
+void Thumbnailer::schedule(const std::string& filepath, size_t& upload_count) {
+    if (m_pending.contains(filepath) || m_failed.contains(filepath) || m_atlas.find(filepath)) {
+        return;
+    }
+    if (upload_count >= THUMBNAIL_UPLOADS_PER_FRAME) {
+        return;
+    }
+
+    std::optional<TextureCache::Key> key = TextureCache::Key::fromFile(filepath);
+    if (! key) {
+        m_failed.insert(filepath);
+        return;
+    }
+
+    if (m_pack) {
+        std::optional<ThumbnailPack::Thumbnail> thumbnail = m_pack->find(key.value());
+        if (thumbnail) {
+            m_atlas.insert(filepath, thumbnail->pixels, thumbnail->width, thumbnail->height);
+            upload_count++;
+            return;
+        }
+    }
+
+    if (m_pending.size() >= THUMBNAIL_MAX_PENDING_COUNT) {
+        return;
+    }
+
+    auto cancelled = std::make_shared<std::atomic<bool>>(false);
+    std::future<std::optional<ImageData>> future = m_thread_pool.submit(
+        [key = key.value(), pack = m_pack, cancelled]() -> std::optional<ImageData> {
+            if (cancelled->load()) {
+                return std::nullopt;
+            }
+
+            ImageData data = ImageData::decodeFromFile(key.filepath, {THUMBNAIL_SIZE, THUMBNAIL_SIZE, true, 4});
+            if (pack) {
+                pack->add(key, data.getPixels(), data.getWidth(), data.getHeight());
+            }
+            return data;
+        }
+    );
+    m_pending.emplace(filepath, Pending{cancelled, std::move(future)});
+}
+
+void Thumbnailer::collectFinished(size_t& upload_count) {
+    for (auto it = m_pending.begin(); it != m_pending.end() && upload_count < THUMBNAIL_UPLOADS_PER_FRAME;) {
+        if (! isFutureReady(it->second.future)) {
+            it++;
+            continue;
+        }
+
+        try {
+            std::optional<ImageData> data = it->second.future.get();
+            if (data) {
+                m_atlas.insert(it->first, data->getPixels(), data->getWidth(), data->getHeight());
+                upload_count++;
+            }
+        } catch (const std::runtime_error&) {
+            m_failed.insert(it->first);
+        }
+        it = m_pending.erase(it);
+    }
+}
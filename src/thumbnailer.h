@@ -0,0 +1,83 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "image.h"
+#include "textureCache.h"
+#include "threadPool.h"
+#include "thumbnailAtlas.h"
+#include "thumbnailPack.h"
+
+/**
+ * @brief Provides thumbnails for the files shown in a grid, generating the missing ones in the background.
+ *
+ * Thumbnails are looked up in the atlas first, then in the persistent pack (so reopening a folder
+ * doesn't decode anything again), and are otherwise decoded on the given thread pool and added to
+ * both. Only files requested during the last frame are worked on: decodes of files that scrolled out
+ * of view are cancelled.
+ *
+ * Except for invalidate(), all methods must be called on the OpenGL thread.
+ */
+class Thumbnailer {
+public:
+    /**
+     * @param pack Persistent store of thumbnails, may be null (thumbnails are then only kept in the atlas).
+     */
+    Thumbnailer(ThreadPool& thread_pool, std::shared_ptr<ThumbnailPack> pack);
+
+    // Returns the thumbnail of the file if it is ready, otherwise schedules it and returns `nullptr`.
+    const ThumbnailAtlas::Cell* request(const std::string& filepath);
+
+    // Whether the thumbnail of the file couldn't be generated (e.g. it isn't a valid image).
+    bool hasFailed(const std::string& filepath) const;
+
+    // Uploads finished thumbnails and schedules the ones requested since the last call. Call once per frame.
+    void update();
+
+    // Schedules removal of the thumbnail of a file that changed on disk. Safe to call from any thread.
+    void invalidate(const std::string& filepath);
+
+    size_t getPendingCount() const;
+    const ThumbnailAtlas& getAtlas() const;
+
+    /**
+     * @brief Deletes the atlas pages of the least recently shown thumbnails until about `bytes` are
+     * released, returning the bytes released. Thumbnails still in view are uploaded again from the
+     * pack. The atlas doesn't grow back until THUMBNAIL_ATLAS_REGROW_DELAY_MS have passed without
+     * another release, so that a budget kept over by other consumers doesn't drain it every frame.
+     */
+    size_t releaseAtlas(size_t bytes);
+
+    // Cancels outstanding work and deletes the atlas textures. Must be called before the OpenGL context is destroyed.
+    void releaseGPUResources();
+
+private:
+    struct Pending {
+        std::shared_ptr<std::atomic<bool>>      cancelled;
+        std::future<std::optional<ImageData>>   future;
+    };
+
+    void schedule(const std::string& filepath, size_t& upload_count);
+    void collectFinished(size_t& upload_count);
+
+    ThreadPool&                                              m_thread_pool;
+    std::shared_ptr<ThumbnailPack>                           m_pack;
+    ThumbnailAtlas                                           m_atlas;
+    std::optional<std::chrono::steady_clock::time_point>     m_atlas_release_time;
+
+    std::vector<std::string>                                 m_requested;
+    std::unordered_map<std::string, Pending>                 m_pending;
+    std::unordered_set<std::string>                          m_failed;
+
+    std::vector<std::string>                                 m_pending_invalidations;
+    std::mutex                                               m_pending_invalidations_mutex;
+};
@@ -0,0 +1,321 @@
+#include <algorithm>
+#include <cmath>
+#include <glad/glad.h>
+#include "tiledImage.h"
+#include "resample.h"
+#include "texturePool.h"
+
+TilePyramid::TilePyramid(ImageData base, int32_t tile_size)
+    : m_base(std::move(base)), m_width(m_base.getWidth()), m_height(m_base.getHeight()), m_channels(m_base.getChannelCount()), m_tile_size(tile_size) {
+    int32_t width = m_base.getWidth();
+    int32_t height = m_base.getHeight();
+    const uint8_t* pixels = m_base.getPixels();
+    const int32_t channels = m_base.getChannelCount();
+
+    while (width > m_tile_size || height > m_tile_size) {
+        int32_t reduced_width = std::max(1, (width + 1) / 2);
+        int32_t reduced_height = std::max(1, (height + 1) / 2);
+
+        std::vector<uint8_t> reduced_pixels(static_cast<size_t>(reduced_width) * reduced_height * channels);
+        downscaleArea(pixels, width, height, reduced_pixels.data(), reduced_width, reduced_height, channels);
+        m_reduced_levels.push_back(std::move(reduced_pixels));
+
+        width = reduced_width;
+        height = reduced_height;
+        pixels = m_reduced_levels.back().data();
+    }
+
+    // Level pointers are taken once all levels are built, since building moves the buffers around.
+    m_levels.push_back(Level{m_base.getPixels(), m_base.getWidth(), m_base.getHeight()});
+    width = m_base.getWidth();
+    height = m_base.getHeight();
+    for (const std::vector<uint8_t>& reduced_pixels : m_reduced_levels) {
+        width = std::max(1, (width + 1) / 2);
+        height = std::max(1, (height + 1) / 2);
+        m_levels.push_back(Level{reduced_pixels.data(), width, height});
+    }
+}
+
+int32_t TilePyramid::getTileSize() const {
+    return m_tile_size;
+}
+
+int32_t TilePyramid::getChannelCount() const {
+    return m_channels;
+}
+
+size_t TilePyramid::getLevelCount() const {
+    return m_levels.size();
+}
+
+const TilePyramid::Level& TilePyramid::getLevel(size_t level) const {
+    return m_levels.at(level);
+}
+
+int32_t TilePyramid::getWidth() const {
+    return m_width;
+}
+
+int32_t TilePyramid::getHeight() const {
+    return m_height;
+}
+
+size_t TilePyramid::getSizeInBytes() const {
+    size_t size = m_base.getSizeInBytes();
+    for (const std::vector<uint8_t>& reduced_pixels : m_reduced_levels) {
+        size += reduced_pixels.size();
+    }
+    return size;
+}
+
+size_t TilePyramid::getFinestLevel() const {
+    return m_finest_level;
+}
+
+size_t TilePyramid::release(size_t bytes) {
+    size_t released_bytes = 0;
+    while (released_bytes < bytes && m_finest_level + 1 < m_levels.size()) {
+        if (m_finest_level == 0) {
+            released_bytes += m_base.getSizeInBytes();
+            ImageData released = std::move(m_base);
+        } else {
+            std::vector<uint8_t>& reduced_pixels = m_reduced_levels[m_finest_level - 1];
+            released_bytes += reduced_pixels.size();
+            std::vector<uint8_t>().swap(reduced_pixels);
+        }
+        m_levels[m_finest_level].pixels = nullptr;
+        m_finest_level++;
+    }
+    return released_bytes;
+}
+
+size_t TiledImage::TileKeyHash::operator()(const TileKey& key) const {
+    size_t hash = std::hash<int32_t>{}(key.level);
+    hash ^= std::hash<int32_t>{}(key.x) + 0x9e3779b9 + (hash << 6) + (hash >> 2);
+    hash ^= std::hash<int32_t>{}(key.y) + 0x9e3779b9 + (hash << 6) + (hash >> 2);
+    return hash;
+}
+
+TiledImage::TiledImage(std::shared_ptr<TilePyramid> pyramid, size_t max_tile_count, size_t uploads_per_frame)
+    : m_pyramid(std::move(pyramid)), m_max_tile_count(std::max<size_t>(max_tile_count, 1)), m_uploads_per_frame(std::max<size_t>(uploads_per_frame, 1)) {}
+
+TiledImage::~TiledImage() {
+    const int32_t tile_size = m_pyramid->getTileSize();
+    for (const Tile& tile : m_tiles) {
+        TexturePool::instance().release(tile.texture, tile_size, tile_size, m_pyramid->getChannelCount());
+    }
+}
+
+int32_t TiledImage::getWidth() const {
+    return m_pyramid->getWidth();
+}
+
+int32_t TiledImage::getHeight() const {
+    return m_pyramid->getHeight();
+}
+
+const TilePyramid& TiledImage::getPyramid() const {
+    return *m_pyramid;
+}
+
+void TiledImage::draw(ImDrawList* draw_list, const ImVec2& image_min, const ImVec2& image_max, float framebuffer_scale) {
+    m_uploads_this_frame = 0;
+
+    const ImVec2 image_size = {image_max.x - image_min.x, image_max.y - image_min.y};
+    if (image_size.x <= 0.0f || image_size.y <= 0.0f) {
+        return;
+    }
+
+    // Visible part of the image, in normalized image coordinates.
+    const ImVec2 clip_min = draw_list->GetClipRectMin();
+    const ImVec2 clip_max = draw_list->GetClipRectMax();
+    const ImVec2 visible_min = {
+        std::clamp((clip_min.x - image_min.x) / image_size.x, 0.0f, 1.0f),
+        std::clamp((clip_min.y - image_min.y) / image_size.y, 0.0f, 1.0f)
+    };
+    const ImVec2 visible_max = {
+        std::clamp((clip_max.x - image_min.x) / image_size.x, 0.0f, 1.0f),
+        std::clamp((clip_max.y - image_min.y) / image_size.y, 0.0f, 1.0f)
+    };
+    if (visible_min.x >= visible_max.x || visible_min.y >= visible_max.y) {
+        return;
+    }
+
+    // The finest level needed is the one with at least one image pixel per framebuffer pixel.
+    const int32_t coarsest_level = static_cast<int32_t>(m_pyramid->getLevelCount()) - 1;
+    const float framebuffer_pixels_per_image_pixel = image_size.x * framebuffer_scale / m_pyramid->getWidth();
+    const int32_t level = std::clamp(static_cast<int32_t>(std::floor(std::log2(1.0f / framebuffer_pixels_per_image_pixel))), 0, coarsest_level);
+
+    // The coarsest level (a single tile) is always drawn first, so that tiles not uploaded yet are never blank.
+    const TileKey backdrop_key = {coarsest_level, 0, 0};
+    uint32_t backdrop_texture = findTile(backdrop_key);
+    if (! backdrop_texture) {
+        backdrop_texture = uploadTile(backdrop_key);
+    }
+    if (backdrop_texture) {
+        const TilePyramid::Level& backdrop_level = m_pyramid->getLevel(coarsest_level);
+        ImVec4 region = {0.0f, 0.0f, static_cast<float>(backdrop_level.width), static_cast<float>(backdrop_level.height)};
+        drawTile(draw_list, backdrop_key, backdrop_texture, region, image_min, image_max);
+    }
+    if (level == coarsest_level) {
+        return;
+    }
+
+    const TilePyramid::Level& level_info = m_pyramid->getLevel(level);
+    const int32_t tile_size = m_pyramid->getTileSize();
+    const int32_t first_x = static_cast<int32_t>(visible_min.x * level_info.width) / tile_size;
+    const int32_t first_y = static_cast<int32_t>(visible_min.y * level_info.height) / tile_size;
+    const int32_t last_x = std::min(static_cast<int32_t>(std::ceil(visible_max.x * level_info.width)) - 1, level_info.width - 1) / tile_size;
+    const int32_t last_y = std::min(static_cast<int32_t>(std::ceil(visible_max.y * level_info.height)) - 1, level_info.height - 1) / tile_size;
+
+    for (int32_t y = first_y; y <= last_y; y++) {
+        for (int32_t x = first_x; x <= last_x; x++) {
+            ImVec4 region = {
+                static_cast<float>(x * tile_size),
+                static_cast<float>(y * tile_size),
+                static_cast<float>(std::min((x + 1) * tile_size, level_info.width)),
+                static_cast<float>(std::min((y + 1) * tile_size, level_info.height))
+            };
+            ImVec2 screen_min = {image_min.x + region.x / level_info.width * image_size.x, image_min.y + region.y / level_info.height * image_size.y};
+            ImVec2 screen_max = {image_min.x + region.z / level_info.width * image_size.x, image_min.y + region.w / level_info.height * image_size.y};
+
+            TileKey key = {level, x, y};
+            uint32_t texture = findTile(key);
+            if (! texture) {
+                texture = uploadTile(key);
+            }
+            if (texture) {
+                drawTile(draw_list, key, texture, region, screen_min, screen_max);
+                continue;
+            }
+
+            // Stand in with the closest coarser level that is already uploaded (the backdrop otherwise). If
+            // the level has been released, the finest level still held is uploaded to stand in for good.
+            for (int32_t coarser_level = level + 1; coarser_level < coarsest_level; coarser_level++) {
+                const int32_t shift = coarser_level - level;
+                const float scale = 1.0f / static_cast<float>(1 << shift);
+                TileKey coarser_key = {coarser_level, x >> shift, y >> shift};
+                uint32_t coarser_texture = findTile(coarser_key);
+                if (! coarser_texture && coarser_level == static_cast<int32_t>(m_pyramid->getFinestLevel())) {
+                    coarser_texture = uploadTile(coarser_key);
+                }
+                if (coarser_texture) {
+                    ImVec4 coarser_region = {region.x * scale, region.y * scale, region.z * scale, region.w * scale};
+                    drawTile(draw_list, coarser_key, coarser_texture, coarser_region, screen_min, screen_max);
+                    break;
+                }
+            }
+        }
+    }
+}
+
+size_t TiledImage::getTileCount() const {
+    return m_tiles.size();
+}
+
+size_t TiledImage::getSizeInBytes() const {
+    const int32_t tile_size = m_pyramid->getTileSize();
+    return m_tiles.size() * TexturePool::estimateSizeInBytes(tile_size, tile_size, m_pyramid->getChannelCount());
+}
+
+size_t TiledImage::evict(size_t bytes) {
+    const int32_t tile_size = m_pyramid->getTileSize();
+    const size_t tile_bytes = TexturePool::estimateSizeInBytes(tile_size, tile_size, m_pyramid->getChannelCount());
+
+    size_t released_bytes = 0;
+    while (released_bytes < bytes && ! m_tiles.empty()) {
+        evictLeastRecentlyUsed();
+        released_bytes += tile_bytes;
+    }
+    return released_bytes;
+}
+
+size_t TiledImage::releasePyramid(size_t bytes) {
+    return m_pyramid->release(bytes);
+}
+
+uint32_t TiledImage::findTile(const TileKey& key) {
+    auto it = m_lookup.find(key);
+    if (it == m_lookup.end()) {
+        return 0;
+    }
+
+    m_tiles.splice(m_tiles.begin(), m_tiles, it->second);
+    return it->second->texture;
+}
+
+uint32_t TiledImage::uploadTile(const TileKey& key) {
+    const TilePyramid::Level& level = m_pyramid->getLevel(key.level);
+    if (m_uploads_this_frame >= m_uploads_per_frame || ! level.pixels) {
+        return 0;
+    }
+    m_uploads_this_frame++;
+
+    const int32_t tile_size = m_pyramid->getTileSize();
+    while (m_tiles.size() >= m_max_tile_count) {
+        evictLeastRecentlyUsed();
+    }
+
+    // Every tile uses a texture of the full tile size (so that they are all interchangeable in the
+    // texture pool); tiles at the right and bottom edges only fill part of it.
+    const int32_t x = key.x * tile_size;
+    const int32_t y = key.y * tile_size;
+    const int32_t width = std::min(tile_size, level.width - x);
+    const int32_t height = std::min(tile_size, level.height - y);
+    const int32_t channels = m_pyramid->getChannelCount();
+    const uint8_t* pixels = level.pixels + (static_cast<size_t>(y) * level.width + x) * channels;
+
+    uint32_t texture = TexturePool::instance().acquire(tile_size, tile_size, channels);
+    glBindTexture(GL_TEXTURE_2D, texture);
+
+    // Clamped so that the edges of neighboring tiles don't blend in the opposite edge of the tile.
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+    const GLenum format = TexturePool::getPixelFormat(channels);
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, level.width);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, width, height, format, GL_UNSIGNED_BYTE, pixels);
+
+    // The texels past a partial tile hold whatever the pooled texture held before, which linear filtering
+    // would blend in along the edge. The last column and row are repeated there, as clamping would.
+    const size_t row_stride = static_cast<size_t>(level.width) * channels;
+    if (width < tile_size) {
+        glTexSubImage2D(GL_TEXTURE_2D, 0, width, 0, 1, height, format, GL_UNSIGNED_BYTE, pixels + static_cast<size_t>(width - 1) * channels);
+    }
+    if (height < tile_size) {
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, height, width, 1, format, GL_UNSIGNED_BYTE, pixels + static_cast<size_t>(height - 1) * row_stride);
+    }
+    if (width < tile_size && height < tile_size) {
+        glTexSubImage2D(GL_TEXTURE_2D, 0, width, height, 1, 1, format, GL_UNSIGNED_BYTE, pixels + static_cast<size_t>(height - 1) * row_stride + static_cast<size_t>(width - 1) * channels);
+    }
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    m_tiles.push_front(Tile{key, texture});
+    m_lookup.emplace(key, m_tiles.begin());
+    return texture;
+}
+
+void TiledImage::evictLeastRecentlyUsed() {
+    const int32_t tile_size = m_pyramid->getTileSize();
+    const Tile& least_recently_used = m_tiles.back();
+    TexturePool::instance().release(least_recently_used.texture, tile_size, tile_size, m_pyramid->getChannelCount());
+    m_lookup.erase(least_recently_used.key);
+    m_tiles.pop_back();
+}
+
+void TiledImage::drawTile(ImDrawList* draw_list, const TileKey& key, uint32_t texture, const ImVec4& region, const ImVec2& screen_min, const ImVec2& screen_max) {
+    const float tile_size = static_cast<float>(m_pyramid->getTileSize());
+    const float origin_x = key.x * tile_size;
+    const float origin_y = key.y * tile_size;
+
+    draw_list->AddImage(
+        reinterpret_cast<ImTextureID>(static_cast<uintptr_t>(texture)),
+        screen_min,
+        screen_max,
+        ImVec2((region.x - origin_x) / tile_size, (region.y - origin_y) / tile_size),
+        ImVec2((region.z - origin_x) / tile_size, (region.w - origin_y) / tile_size)
+    );
+}
@@ -0,0 +1,137 @@
+#pragma once
+
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include <imgui.h>
+
+#include "image.h"
+
+/**
+ * @brief A multi-resolution pyramid of an image held in CPU memory, each level half the size of the previous one.
+ *
+ * Building the pyramid is CPU only and safe to do on any thread. The coarsest level fits in a single tile.
+ * The finest levels can be released afterwards to give back memory, the coarsest level is always kept.
+ */
+class TilePyramid {
+public:
+    struct Level {
+        const uint8_t*      pixels;     // getChannelCount() channels per pixel, nullptr once released.
+        int32_t             width;
+        int32_t             height;
+    };
+
+    // Builds the reduced levels of the given full resolution image.
+    TilePyramid(ImageData base, int32_t tile_size);
+
+    int32_t getTileSize() const;
+    int32_t getChannelCount() const;
+    size_t getLevelCount() const;
+    const Level& getLevel(size_t level) const;
+
+    // Dimensions of the full image (level 0).
+    int32_t getWidth() const;
+    int32_t getHeight() const;
+
+    size_t getSizeInBytes() const;
+
+    // Finest level whose pixels are still held.
+    size_t getFinestLevel() const;
+
+    // Releases the pixels of the finest levels until at least `bytes` are released (or only the coarsest level is left). Returns the bytes released.
+    size_t release(size_t bytes);
+
+    // Disable copying TilePyramid objects.
+    TilePyramid(const TilePyramid&) = delete;
+    TilePyramid& operator=(const TilePyramid&) = delete;
+
+private:
+    ImageData                               m_base;
+    int32_t                                 m_width;
+    int32_t                                 m_height;
+    int32_t                                 m_channels;
+    int32_t                                 m_tile_size;
+    std::vector<std::vector<uint8_t>>       m_reduced_levels;
+    std::vector<Level>                      m_levels;
+    size_t                                  m_finest_level{ 0 };
+};
+
+/**
+ * @brief Displays a TilePyramid through tiles uploaded on demand.
+ *
+ * Only the tiles covering the visible part of the image, at the level matching the current zoom,
+ * are uploaded (a few per frame), and at most `max_tile_count` of them are kept on the GPU with
+ * the least recently drawn ones released first. Tiles that aren't uploaded yet (or whose level has been
+ * released from the pyramid) are stood in for by coarser levels. Must only be used on the OpenGL thread.
+ */
+class TiledImage {
+public:
+    TiledImage(std::shared_ptr<TilePyramid> pyramid, size_t max_tile_count, size_t uploads_per_frame);
+    ~TiledImage();
+
+    int32_t getWidth() const;
+    int32_t getHeight() const;
+    const TilePyramid& getPyramid() const;
+
+    /**
+     * @brief Draws the image stretched over `image_min`-`image_max` (in screen coordinates), limited to
+     * the current clip rectangle of the draw list.
+     *
+     * @param framebuffer_scale Framebuffer pixels per screen coordinate, to pick the level of detail.
+     */
+    void draw(ImDrawList* draw_list, const ImVec2& image_min, const ImVec2& image_max, float framebuffer_scale);
+
+    size_t getTileCount() const;
+    size_t getSizeInBytes() const;
+
+    // Releases least recently drawn tiles until at least `bytes` are released (they are uploaded again when needed). Returns the bytes released.
+    size_t evict(size_t bytes);
+
+    // Releases the finest levels of the pyramid from CPU memory (see TilePyramid::release()). Their uploaded tiles are still drawn.
+    size_t releasePyramid(size_t bytes);
+
+    // Disable copying TiledImage objects.
+    TiledImage(const TiledImage&) = delete;
+    TiledImage& operator=(const TiledImage&) = delete;
+
+private:
+    struct TileKey {
+        int32_t         level;
+        int32_t         x;
+        int32_t         y;
+
+        bool operator==(const TileKey& other) const = default;
+    };
+
+    struct TileKeyHash {
+        size_t operator()(const TileKey& key) const;
+    };
+
+    struct Tile {
+        TileKey         key;
+        uint32_t        texture;
+    };
+
+    // Returns the texture of the tile if it is uploaded, marking it as most recently used.
+    uint32_t findTile(const TileKey& key);
+
+    // Uploads the tile if the per frame upload budget allows, evicting the least recently used ones if needed.
+    uint32_t uploadTile(const TileKey& key);
+
+    void evictLeastRecentlyUsed();
+
+    // Draws the part of a tile of the given level covering `region` (in level pixels) at the given screen rectangle.
+    void drawTile(ImDrawList* draw_list, const TileKey& key, uint32_t texture, const ImVec4& region, const ImVec2& screen_min, const ImVec2& screen_max);
+
+    std::shared_ptr<TilePyramid>                                        m_pyramid;
+    size_t                                                              m_max_tile_count;
+    size_t                                                              m_uploads_per_frame;
+    size_t                                                              m_uploads_this_frame{ 0 };
+
+    // Most recently used tiles are at the front.
+    std::list<Tile>                                                     m_tiles;
+    std::unordered_map<TileKey, std::list<Tile>::iterator, TileKeyHash> m_lookup;
+};
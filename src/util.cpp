@@ -5,6 +5,7 @@
 #include <string>
 #include <fstream>
 #include <sstream>
+#include <thread>
 
 #ifdef __APPLE__
 #include <mach-o/dyld.h> // For _NSGetExecutablePath on macOS
@@ -156,11 +157,12 @@ namespace ui {
 }
 
 std::vector<std::string> getValidExtensions(MediaType media_type) {
+    // Only what stb_image, respectively SFML's audio decoders, can read.
     if (media_type == MediaType::Image) {
-        return {".jpg", ".jpeg", ".png", ".bmp", ".gif", ".tiff"};
+        return {".jpg", ".jpeg", ".png", ".bmp", ".gif", ".pgm", ".ppm", ".hdr"};
     }
     if (media_type == MediaType::Audio) {
-        return {".mp3", ".wav", ".flac", ".aac", ".ogg", ".m4a"};
+        return {".mp3", ".wav", ".flac", ".ogg"};
     }
     throw std::invalid_argument("Unsupported media type");
 }
@@ -233,3 +235,43 @@ void moveFile(const std::string& filepath, const std::string& dest_directory, st
         error_callback(e.what());
     }
 }
+
+uint64_t hashPath(const std::string& filepath) {
+
+    // 64-bit FNV-1a.
+    uint64_t hash = 14695981039346656037ull;
+    for (unsigned char c : filepath) {
+        hash ^= c;
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+bool writeFileAtomically(const std::string& filepath, const std::function<void(std::ostream&)>& write) {
+    namespace fs = std::filesystem;
+
+    // Named after the writing thread, so that concurrent writers of the same file don't share it.
+    const std::string temporary_filepath = filepath + "." + std::to_string(std::hash<std::thread::id>{}(std::this_thread::get_id())) + ".tmp";
+    {
+        std::ofstream file(temporary_filepath, std::ios::binary | std::ios::trunc);
+        if (file) {
+            write(file);
+        }
+
+        // Closing flushes what is still buffered, which may fail (e.g. when the disk is full) as well.
+        file.close();
+        if (file.fail()) {
+            std::error_code ec;
+            fs::remove(temporary_filepath, ec);
+            return false;
+        }
+    }
+
+    std::error_code ec;
+    fs::rename(temporary_filepath, filepath, ec);
+    if (ec) {
+        fs::remove(temporary_filepath, ec);
+        return false;
+    }
+    return true;
+}
@@ -84,6 +84,17 @@ inline std::string joinPaths(const T&... path) {
     return result.string();
 }
 
+// Stable across runs (unlike std::hash), for naming or keying what is persisted by path.
+uint64_t hashPath(const std::string& filepath);
+
+/**
+ * @brief Writes a file through a temporary file renamed into place, so that readers only ever see a
+ * complete file, whichever thread wrote it. `write` fills the temporary file.
+ *
+ * @return Whether the file was written. On failure nothing is left behind.
+ */
+bool writeFileAtomically(const std::string& filepath, const std::function<void(std::ostream&)>& write);
+
 template<typename T>
 inline bool isFutureReady(std::future<T>& future) {
     return future.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
@@ -0,0 +1,238 @@
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <stdexcept>
+#include <SFML/Audio/InputSoundFile.hpp>
+#include "util.h"
+#include "waveform.h"
+
+namespace {
+    const char      CACHE_MAGIC[8]      = {'M', 'L', 'B', 'C', 'W', 'A', 'V', 'E'};
+    const uint32_t  CACHE_VERSION       = 1;
+
+    // Blocks of samples read from the decoder at a time.
+    const size_t    READ_BLOCK_COUNT    = 64;
+
+    struct CacheHeader {
+        char        magic[8];
+        uint32_t    version;
+        uint32_t    block_frame_count;
+        uint64_t    file_size;
+        int64_t     modification_time;
+        uint32_t    sample_rate;
+        uint32_t    channel_count;
+        uint64_t    frame_count;
+        uint64_t    peak_count;
+    };
+
+    const WaveformPeak EMPTY_PEAK = {std::numeric_limits<int16_t>::max(), std::numeric_limits<int16_t>::min()};
+
+    // Two independent reductions over contiguous samples, a loop shape compilers turn into packed min/max instructions.
+    WaveformPeak reducePeak(const int16_t* samples, size_t count, WaveformPeak peak) {
+        int16_t min = peak.min;
+        int16_t max = peak.max;
+        for (size_t i = 0; i < count; i++) {
+            min = std::min(min, samples[i]);
+            max = std::max(max, samples[i]);
+        }
+        return {min, max};
+    }
+
+    WaveformPeak mergePeaks(WaveformPeak a, WaveformPeak b) {
+        return {std::min(a.min, b.min), std::max(a.max, b.max)};
+    }
+}
+
+WaveformPyramid::WaveformPyramid(uint32_t sample_rate, uint32_t channel_count, uint64_t frame_count, uint32_t block_frame_count, std::vector<WaveformPeak> base_peaks)
+    : m_sample_rate(sample_rate), m_channel_count(channel_count), m_frame_count(frame_count), m_block_frame_count(std::max<uint32_t>(block_frame_count, 1)) {
+    m_levels.push_back(std::move(base_peaks));
+    while (m_levels.back().size() > 1) {
+        const std::vector<WaveformPeak>& previous = m_levels.back();
+        std::vector<WaveformPeak> level((previous.size() + 1) / 2);
+        for (size_t i = 0; i < previous.size() / 2; i++) {
+            level[i] = mergePeaks(previous[2 * i], previous[2 * i + 1]);
+        }
+        if (previous.size() % 2 != 0) {
+            level.back() = previous.back();
+        }
+        m_levels.push_back(std::move(level));
+    }
+}
+
+std::shared_ptr<const WaveformPyramid> WaveformPyramid::decodeFromFile(const std::string& filepath, uint32_t block_frame_count, const std::atomic<bool>& cancelled) {
+    sf::InputSoundFile file;
+    if (! file.openFromFile(filepath)) {
+        throw std::runtime_error("error: couldn't open audio file: " + filepath);
+    }
+
+    const uint32_t channel_count = std::max<uint32_t>(file.getChannelCount(), 1);
+    const size_t block_sample_count = static_cast<size_t>(std::max<uint32_t>(block_frame_count, 1)) * channel_count;
+
+    std::vector<WaveformPeak> peaks;
+    peaks.reserve(static_cast<size_t>(file.getSampleCount() / block_sample_count + 1));
+
+    // Reads don't necessarily end on block boundaries, so the block being filled carries over.
+    std::vector<int16_t> samples(block_sample_count * READ_BLOCK_COUNT);
+    WaveformPeak block_peak = EMPTY_PEAK;
+    size_t block_fill = 0;
+    uint64_t sample_count = 0;
+    while (uint64_t read_count = file.read(samples.data(), samples.size())) {
+        if (cancelled.load()) {
+            return nullptr;
+        }
+        sample_count += read_count;
+
+        size_t offset = 0;
+        while (offset < read_count) {
+            size_t count = std::min<size_t>(block_sample_count - block_fill, read_count - offset);
+            block_peak = reducePeak(samples.data() + offset, count, block_peak);
+            block_fill += count;
+            offset += count;
+            if (block_fill == block_sample_count) {
+                peaks.push_back(block_peak);
+                block_peak = EMPTY_PEAK;
+                block_fill = 0;
+            }
+        }
+    }
+    if (block_fill > 0) {
+        peaks.push_back(block_peak);
+    }
+
+    // The decoded length is trusted over the header's, which is only an estimate for some formats.
+    return std::make_shared<const WaveformPyramid>(file.getSampleRate(), channel_count, sample_count / channel_count, block_frame_count, std::move(peaks));
+}
+
+uint32_t WaveformPyramid::getSampleRate() const {
+    return m_sample_rate;
+}
+
+uint32_t WaveformPyramid::getChannelCount() const {
+    return m_channel_count;
+}
+
+uint64_t WaveformPyramid::getFrameCount() const {
+    return m_frame_count;
+}
+
+uint32_t WaveformPyramid::getBlockFrameCount() const {
+    return m_block_frame_count;
+}
+
+size_t WaveformPyramid::getLevelCount() const {
+    return m_levels.size();
+}
+
+const std::vector<WaveformPeak>& WaveformPyramid::getLevel(size_t level) const {
+    return m_levels.at(level);
+}
+
+float WaveformPyramid::getDuration() const {
+    return m_sample_rate > 0 ? static_cast<float>(static_cast<double>(m_frame_count) / m_sample_rate) : 0.0f;
+}
+
+void WaveformPyramid::getPeaks(double first_frame, double frames_per_span, std::vector<WaveformPeak>& peaks) const {
+    frames_per_span = std::max(frames_per_span, 1e-6);
+
+    // The coarsest level whose peaks still cover no more than a span, so a span merges at most three of them.
+    size_t level = 0;
+    while (level + 1 < m_levels.size() && static_cast<double>(m_block_frame_count) * std::ldexp(1.0, static_cast<int>(level + 1)) <= frames_per_span) {
+        level++;
+    }
+    const std::vector<WaveformPeak>& level_peaks = m_levels[level];
+    const double frames_per_peak = static_cast<double>(m_block_frame_count) * std::ldexp(1.0, static_cast<int>(level));
+    const int64_t peak_count = static_cast<int64_t>(level_peaks.size());
+
+    for (size_t i = 0; i < peaks.size(); i++) {
+        double span_start = first_frame + static_cast<double>(i) * frames_per_span;
+        double span_end = span_start + frames_per_span;
+        int64_t first = std::max<int64_t>(static_cast<int64_t>(std::floor(span_start / frames_per_peak)), 0);
+        int64_t last = std::min<int64_t>(static_cast<int64_t>(std::ceil(span_end / frames_per_peak)), peak_count);
+
+        WaveformPeak peak = EMPTY_PEAK;
+        for (int64_t j = first; j < last; j++) {
+            peak = mergePeaks(peak, level_peaks[static_cast<size_t>(j)]);
+        }
+        peaks[i] = first < last ? peak : WaveformPeak{0, 0};
+    }
+}
+
+size_t WaveformPyramid::getSizeInBytes() const {
+    size_t size = 0;
+    for (const std::vector<WaveformPeak>& level : m_levels) {
+        size += level.size() * sizeof(WaveformPeak);
+    }
+    return size;
+}
+
+WaveformCache::WaveformCache(const std::string& directory, size_t max_size_in_bytes)
+    : m_entries(directory, ".peaks", max_size_in_bytes) {}
+
+std::shared_ptr<const WaveformPyramid> WaveformCache::find(const TextureCache::Key& key, uint32_t block_frame_count) const {
+    const std::string entry_filepath = m_entries.getEntryFilepath(hashPath(key.filepath));
+    std::ifstream file(entry_filepath, std::ios::binary);
+    if (! file) {
+        return nullptr;
+    }
+
+    CacheHeader header{};
+    if (! file.read(reinterpret_cast<char*>(&header), sizeof(CacheHeader))
+        || std::memcmp(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC)) != 0
+        || header.version != CACHE_VERSION
+        || header.block_frame_count != block_frame_count
+        || header.file_size != key.file_size
+        || header.modification_time != key.modification_time.time_since_epoch().count()) {
+        return nullptr;
+    }
+
+    // A peak count that doesn't match the length means a damaged entry, caught before allocating for it.
+    const uint64_t expected_peak_count = (header.frame_count + block_frame_count - 1) / block_frame_count;
+    if (header.peak_count != expected_peak_count) {
+        return nullptr;
+    }
+    std::vector<WaveformPeak> peaks(static_cast<size_t>(header.peak_count));
+    if (! file.read(reinterpret_cast<char*>(peaks.data()), static_cast<std::streamsize>(peaks.size() * sizeof(WaveformPeak)))) {
+        return nullptr;
+    }
+
+    m_entries.touch(entry_filepath);
+    return std::make_shared<const WaveformPyramid>(header.sample_rate, header.channel_count, header.frame_count, block_frame_count, std::move(peaks));
+}
+
+void WaveformCache::add(const TextureCache::Key& key, const WaveformPyramid& pyramid) const {
+    CacheHeader header{};
+    std::memcpy(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC));
+    header.version = CACHE_VERSION;
+    header.block_frame_count = pyramid.getBlockFrameCount();
+    header.file_size = key.file_size;
+    header.modification_time = key.modification_time.time_since_epoch().count();
+    header.sample_rate = pyramid.getSampleRate();
+    header.channel_count = pyramid.getChannelCount();
+    header.frame_count = pyramid.getFrameCount();
+    header.peak_count = pyramid.getLevel(0).size();
+
+    // Only the finest level is stored. The others take a fraction of the time to rebuild than to read.
+    const std::vector<WaveformPeak>& peaks = pyramid.getLevel(0);
+    m_entries.write(m_entries.getEntryFilepath(hashPath(key.filepath)), [&header, &peaks](std::ostream& file) {
+        file.write(reinterpret_cast<const char*>(&header), sizeof(CacheHeader));
+        file.write(reinterpret_cast<const char*>(peaks.data()), static_cast<std::streamsize>(peaks.size() * sizeof(WaveformPeak)));
+    });
+}
+
+std::shared_ptr<const WaveformPyramid> loadWaveform(const std::string& filepath, const WaveformCache* cache, uint32_t block_frame_count, const std::atomic<bool>& cancelled) {
+    std::optional<TextureCache::Key> key = TextureCache::Key::fromFile(filepath);
+    if (cache && key) {
+        std::shared_ptr<const WaveformPyramid> pyramid = cache->find(key.value(), block_frame_count);
+        if (pyramid) {
+            return pyramid;
+        }
+    }
+
+    std::shared_ptr<const WaveformPyramid> pyramid = WaveformPyramid::decodeFromFile(filepath, block_frame_count, cancelled);
+    if (pyramid && cache && key) {
+        cache->add(key.value(), *pyramid);
+    }
+    return pyramid;
+}
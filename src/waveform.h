@@ -0,0 +1,98 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "cacheDirectory.h"
+#include "textureCache.h"
+
+// Lowest and highest sample over a span of audio, all channels together.
+struct WaveformPeak {
+    int16_t     min;
+    int16_t     max;
+};
+
+/**
+ * @brief A multi-resolution pyramid of the peaks of an audio file, for drawing its waveform at any zoom.
+ *
+ * Level 0 holds one peak per `block_frame_count` frames, each following level one peak per two of the
+ * previous level, down to a single peak. Drawing a waveform then reads the level whose peaks are just
+ * finer than a pixel, so it costs the same whether the view spans a second or an hour. Building the
+ * pyramid is CPU only and safe to do on any thread.
+ */
+class WaveformPyramid {
+public:
+    // Builds the reduced levels from the peaks of level 0.
+    WaveformPyramid(uint32_t sample_rate, uint32_t channel_count, uint64_t frame_count, uint32_t block_frame_count, std::vector<WaveformPeak> base_peaks);
+
+    /**
+     * @brief Decodes the whole file to compute its peaks.
+     *
+     * @return `nullptr` if cancelled before the end of the file.
+     * @throws std::runtime_error if the file can't be opened as audio.
+     */
+    static std::shared_ptr<const WaveformPyramid> decodeFromFile(const std::string& filepath, uint32_t block_frame_count, const std::atomic<bool>& cancelled);
+
+    uint32_t getSampleRate() const;
+    uint32_t getChannelCount() const;
+    uint64_t getFrameCount() const;
+    uint32_t getBlockFrameCount() const;
+    size_t getLevelCount() const;
+    const std::vector<WaveformPeak>& getLevel(size_t level) const;
+
+    // Duration in seconds.
+    float getDuration() const;
+
+    /**
+     * @brief Computes the peaks of `peaks.size()` consecutive spans of `frames_per_span` frames, the first
+     * one starting at `first_frame`. Spans outside the audio are silent. Takes time proportional to the
+     * number of spans only.
+     */
+    void getPeaks(double first_frame, double frames_per_span, std::vector<WaveformPeak>& peaks) const;
+
+    size_t getSizeInBytes() const;
+
+    // Disable copying WaveformPyramid objects.
+    WaveformPyramid(const WaveformPyramid&) = delete;
+    WaveformPyramid& operator=(const WaveformPyramid&) = delete;
+
+private:
+    uint32_t                                    m_sample_rate;
+    uint32_t                                    m_channel_count;
+    uint64_t                                    m_frame_count;
+    uint32_t                                    m_block_frame_count;
+    std::vector<std::vector<WaveformPeak>>      m_levels;
+};
+
+/**
+ * @brief Keeps the level 0 peaks of waveforms on disk, one small file per audio file, so that an audio
+ * file is decoded for its waveform only once.
+ *
+ * Entries are keyed like TextureCache entries (path, size and modification time), so a file that has
+ * been rewritten never gets a stale waveform. The entries take at most `max_size_in_bytes`, the least
+ * recently used ones are deleted past that (see CacheDirectory). Safe to use from any thread.
+ */
+class WaveformCache {
+public:
+    WaveformCache(const std::string& directory, size_t max_size_in_bytes);
+
+    // Returns the cached waveform of the file, `nullptr` if there is none (or it is stale or damaged).
+    std::shared_ptr<const WaveformPyramid> find(const TextureCache::Key& key, uint32_t block_frame_count) const;
+
+    // Stores the waveform of the file. Failures are ignored, the waveform is just decoded again next time.
+    void add(const TextureCache::Key& key, const WaveformPyramid& pyramid) const;
+
+private:
+    CacheDirectory      m_entries;
+};
+
+/**
+ * @brief Loads the waveform of an audio file from the cache, or decodes it (and caches it) on a miss.
+ *
+ * @param cache May be `nullptr`, in which case the file is always decoded.
+ */
+std::shared_ptr<const WaveformPyramid> loadWaveform(const std::string& filepath, const WaveformCache* cache, uint32_t block_frame_count, const std::atomic<bool>& cancelled);
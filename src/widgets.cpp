@@ -1,5 +1,9 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
 #include "widgets.h"
 #include "image.h"
+#include "tiledImage.h"
 
 namespace ui {
 namespace widget {
@@ -79,34 +83,272 @@ namespace widget {
         return value_changed;
     }
 
-    void ImageView(const Image& image) {
+    namespace {
+
+        /**
+         * @brief Lays out a zoomable and pannable view of an image of the given size, handling mouse
+         * input, then calls `draw` with the screen rectangle the image covers (clipped to the view).
+         * Whatever `draw` adds is drawn with the display adjustments.
+         */
+        void showImageView(
+            ImVec2 image_size,
+            ImageViewState& state,
+            DisplayAdjustmentRenderer& renderer,
+            const DisplayAdjustments& adjustments,
+            const std::function<void(ImDrawList*, ImVec2, ImVec2)>& draw
+        ) {
+            ImVec2 viewport_size = ImGui::GetContentRegionAvail();
+            if (viewport_size.x <= 0.0f || viewport_size.y <= 0.0f) {
+                return;
+            }
+
+            float image_aspect_ratio = image_size.x / image_size.y;
+            float viewport_aspect_ratio = viewport_size.x / viewport_size.y;
+
+            // Calculate the final display size.
+            ImVec2 display_size = image_size;
+
+            if (display_size.x > viewport_size.x || display_size.y > viewport_size.y) {
+                if (viewport_aspect_ratio > image_aspect_ratio) {
+                    display_size.y = viewport_size.y;
+                    display_size.x = display_size.y * image_aspect_ratio;
+                } else {
+                    display_size.x = viewport_size.x;
+                    display_size.y = display_size.x / image_aspect_ratio;
+                }
+            }
+
+            // The whole viewport handles mouse input.
+            ImVec2 viewport_min = ImGui::GetCursorScreenPos();
+            ImVec2 viewport_max = {viewport_min.x + viewport_size.x, viewport_min.y + viewport_size.y};
+            ImVec2 viewport_center = {viewport_min.x + viewport_size.x * 0.5f, viewport_min.y + viewport_size.y * 0.5f};
+            ImGui::InvisibleButton("##image-view", viewport_size);
+
+            const float MAX_ZOOM = 32.0f;
+            const float ZOOM_STEP = 1.2f;
+            ImGuiIO& io = ImGui::GetIO();
+
+            if (ImGui::IsItemHovered()) {
+                if (io.MouseWheel != 0.0f) {
+
+                    // Keep the image point under the mouse cursor fixed while zooming.
+                    ImVec2 mouse_offset = {io.MousePos.x - viewport_center.x, io.MousePos.y - viewport_center.y};
+                    ImVec2 point_under_cursor = {
+                        state.center.x + mouse_offset.x / (display_size.x * state.zoom),
+                        state.center.y + mouse_offset.y / (display_size.y * state.zoom)
+                    };
+                    state.zoom = std::clamp(state.zoom * std::pow(ZOOM_STEP, io.MouseWheel), 1.0f, MAX_ZOOM);
+                    state.center = {
+                        point_under_cursor.x - mouse_offset.x / (display_size.x * state.zoom),
+                        point_under_cursor.y - mouse_offset.y / (display_size.y * state.zoom)
+                    };
+                }
+                if (ImGui::IsMouseDoubleClicked(ImGuiMouseButton_Left)) {
+                    state = ImageViewState();
+                }
+            }
+            if (ImGui::IsItemActive() && ImGui::IsMouseDragging(ImGuiMouseButton_Left)) {
+                state.center.x -= io.MouseDelta.x / (display_size.x * state.zoom);
+                state.center.y -= io.MouseDelta.y / (display_size.y * state.zoom);
+            }
+
+            // Don't pan past the image edges. Along an axis where the zoomed image still fits, keep it centered.
+            ImVec2 zoomed_size = {display_size.x * state.zoom, display_size.y * state.zoom};
+            ImVec2 half_visible = {viewport_size.x * 0.5f / zoomed_size.x, viewport_size.y * 0.5f / zoomed_size.y};
+            state.center.x = (half_visible.x >= 0.5f) ? 0.5f : std::clamp(state.center.x, half_visible.x, 1.0f - half_visible.x);
+            state.center.y = (half_visible.y >= 0.5f) ? 0.5f : std::clamp(state.center.y, half_visible.y, 1.0f - half_visible.y);
+
+            // Display the image.
+            ImVec2 image_min = {viewport_center.x - state.center.x * zoomed_size.x, viewport_center.y - state.center.y * zoomed_size.y};
+            ImVec2 image_max = {image_min.x + zoomed_size.x, image_min.y + zoomed_size.y};
+
+            ImDrawList* draw_list = ImGui::GetWindowDrawList();
+            draw_list->PushClipRect(viewport_min, viewport_max, true);
+
+            // The default adjustments change nothing, so the backend's own shader is kept.
+            const bool adjusted = adjustments != DisplayAdjustments();
+            if (adjusted) {
+                renderer.begin(draw_list, adjustments);
+            }
+            draw(draw_list, image_min, image_max);
+            if (adjusted) {
+                renderer.end(draw_list);
+            }
+            draw_list->PopClipRect();
+        }
+    }
+
+    void ImageView(const Image& image, ImageViewState& state, DisplayAdjustmentRenderer& renderer, const DisplayAdjustments& adjustments) {
+
+        // Laid out at the size of the image file, so that downscaled previews and provisional thumbnails
+        // are displayed the same way as the full image.
+        ImVec2 image_size = {static_cast<float>(image.getSourceWidth()), static_cast<float>(image.getSourceHeight())};
+        showImageView(image_size, state, renderer, adjustments, [&image](ImDrawList* draw_list, ImVec2 image_min, ImVec2 image_max) {
+            draw_list->AddImage(image.getTexture(), image_min, image_max);
+        });
+    }
+
+    void TiledImageView(TiledImage& image, ImageViewState& state, DisplayAdjustmentRenderer& renderer, const DisplayAdjustments& adjustments) {
         ImVec2 image_size = {static_cast<float>(image.getWidth()), static_cast<float>(image.getHeight())};
-        ImVec2 viewport_size = ImGui::GetContentRegionAvail();
+        float framebuffer_scale = ImGui::GetIO().DisplayFramebufferScale.x;
+        showImageView(image_size, state, renderer, adjustments, [&image, framebuffer_scale](ImDrawList* draw_list, ImVec2 image_min, ImVec2 image_max) {
+            image.draw(draw_list, image_min, image_max, framebuffer_scale);
+        });
+    }
 
-        float image_aspect_ratio = image_size.x / image_size.y;
-        float viewport_aspect_ratio = viewport_size.x / viewport_size.y;
+    void AnimatedImageView(const AnimatedImage& image, ImageViewState& state, DisplayAdjustmentRenderer& renderer, const DisplayAdjustments& adjustments) {
+        ImVec2 image_size = {static_cast<float>(image.getWidth()), static_cast<float>(image.getHeight())};
+        showImageView(image_size, state, renderer, adjustments, [&image](ImDrawList* draw_list, ImVec2 image_min, ImVec2 image_max) {
+            draw_list->AddImage(image.getTexture(), image_min, image_max);
+        });
+    }
 
-        // Calculate the final display size.
-        ImVec2 display_size = image_size;
+    namespace {
 
-        if (display_size.x > viewport_size.x || display_size.y > viewport_size.y) {
-            if (viewport_aspect_ratio > image_aspect_ratio) {
-                display_size.y = viewport_size.y;
-                display_size.x = display_size.y * image_aspect_ratio;
-            } else {
-                display_size.x = viewport_size.x;
-                display_size.y = display_size.x / image_aspect_ratio;
+        /**
+         * @brief Lays out a view of a recording along time, zoomable and pannable horizontally, handling
+         * mouse input, then calls `draw` with the viewport rectangle and the visible time span (normalized).
+         * Draws the playback position on top.
+         *
+         * @param max_zoom Zoom at which a pixel column spans the finest detail there is to show.
+         * @return The position (in seconds) clicked to seek to, if any.
+         */
+        std::optional<float> showTimelineView(
+            float duration,
+            float max_zoom,
+            TimelineViewState& state,
+            float position,
+            const std::function<void(ImDrawList*, ImVec2, ImVec2, float, float)>& draw
+        ) {
+            ImVec2 viewport_size = ImGui::GetContentRegionAvail();
+            if (viewport_size.x <= 0.0f || viewport_size.y <= 0.0f || duration <= 0.0f) {
+                return std::nullopt;
+            }
+
+            ImVec2 viewport_min = ImGui::GetCursorScreenPos();
+            ImVec2 viewport_max = {viewport_min.x + viewport_size.x, viewport_min.y + viewport_size.y};
+            ImGui::InvisibleButton("##timeline-view", viewport_size);
+
+            const float ZOOM_STEP = 1.2f;
+            max_zoom = std::max(max_zoom, 1.0f);
+            ImGuiIO& io = ImGui::GetIO();
+
+            if (ImGui::IsItemHovered()) {
+                if (io.MouseWheel != 0.0f) {
+
+                    // Keep the time under the mouse cursor fixed while zooming.
+                    float mouse_offset = io.MousePos.x - (viewport_min.x + viewport_size.x * 0.5f);
+                    float time_under_cursor = state.center + mouse_offset / (viewport_size.x * state.zoom);
+                    state.zoom = std::clamp(state.zoom * std::pow(ZOOM_STEP, io.MouseWheel), 1.0f, max_zoom);
+                    state.center = time_under_cursor - mouse_offset / (viewport_size.x * state.zoom);
+                }
+                if (ImGui::IsMouseDoubleClicked(ImGuiMouseButton_Left)) {
+                    state = TimelineViewState();
+                }
+            }
+            if (ImGui::IsItemActive() && ImGui::IsMouseDragging(ImGuiMouseButton_Left)) {
+                state.center -= io.MouseDelta.x / (viewport_size.x * state.zoom);
+            }
+
+            // Don't pan past the start or the end.
+            const float half_visible = 0.5f / state.zoom;
+            state.center = std::clamp(state.center, half_visible, 1.0f - half_visible);
+            const float visible_start = state.center - half_visible;
+            const float visible_end = state.center + half_visible;
+
+            // A click (rather than the end of a drag) seeks to the clicked time.
+            std::optional<float> seek_position;
+            if (ImGui::IsItemDeactivated() && ! ImGui::IsMouseDragPastThreshold(ImGuiMouseButton_Left)) {
+                float time = visible_start + (io.MousePos.x - viewport_min.x) / (viewport_size.x * state.zoom);
+                seek_position = std::clamp(time, 0.0f, 1.0f) * duration;
+            }
+
+            ImDrawList* draw_list = ImGui::GetWindowDrawList();
+            draw_list->PushClipRect(viewport_min, viewport_max, true);
+            draw(draw_list, viewport_min, viewport_max, visible_start, visible_end);
+
+            // Playback position.
+            float position_x = viewport_min.x + (position / duration - visible_start) * viewport_size.x * state.zoom;
+            draw_list->AddLine({position_x, viewport_min.y}, {position_x, viewport_max.y}, ImGui::GetColorU32(ImGuiCol_PlotLinesHovered), 2.0f);
+            draw_list->PopClipRect();
+
+            return seek_position;
+        }
+    }
+
+    std::optional<float> WaveformView(const WaveformPyramid& waveform, TimelineViewState& state, float position) {
+        if (waveform.getFrameCount() == 0) {
+            return std::nullopt;
+        }
+
+        // Zooming stops once a pixel column spans a single frame.
+        const double frame_count = static_cast<double>(waveform.getFrameCount());
+        const float max_zoom = static_cast<float>(frame_count / std::max(ImGui::GetContentRegionAvail().x, 1.0f));
+
+        return showTimelineView(waveform.getDuration(), max_zoom, state, position, [&](ImDrawList* draw_list, ImVec2 viewport_min, ImVec2 viewport_max, float visible_start, float visible_end) {
+
+            // One peak per pixel column.
+            const int32_t column_count = static_cast<int32_t>(viewport_max.x - viewport_min.x);
+            std::vector<WaveformPeak> peaks(static_cast<size_t>(std::max(column_count, 0)));
+            const double frames_per_column = frame_count * (visible_end - visible_start) / std::max(column_count, 1);
+            waveform.getPeaks(static_cast<double>(visible_start) * frame_count, frames_per_column, peaks);
+
+            const float center_y = (viewport_min.y + viewport_max.y) * 0.5f;
+            const float half_height = (viewport_max.y - viewport_min.y) * 0.5f / 32768.0f;
+            const ImU32 waveform_color = ImGui::GetColorU32(ImGuiCol_PlotLines);
+            draw_list->AddLine({viewport_min.x, center_y}, {viewport_max.x, center_y}, ImGui::GetColorU32(ImGuiCol_Separator));
+            for (int32_t x = 0; x < column_count; x++) {
+                const WaveformPeak& peak = peaks[static_cast<size_t>(x)];
+                float top = center_y - static_cast<float>(peak.max) * half_height;
+                float bottom = center_y - static_cast<float>(peak.min) * half_height;
+                draw_list->AddRectFilled({viewport_min.x + x, top}, {viewport_min.x + x + 1.0f, std::max(bottom, top + 1.0f)}, waveform_color);
             }
+        });
+    }
+
+    std::optional<float> SpectrogramView(const Spectrogram& spectrogram, TimelineViewState& state, float position) {
+        const SpectrogramData& data = spectrogram.getData();
+        if (! spectrogram.getTexture() || data.getColumnCount() == 0) {
+            return std::nullopt;
         }
 
-        // Calculate padding to center the image.
-        ImVec2 padding = {(viewport_size.x - display_size.x) * 0.5f, (viewport_size.y - display_size.y) * 0.5f};
+        // Zooming stops once a column is a few pixels wide.
+        const float MAX_COLUMN_WIDTH = 8.0f;
+        const float max_zoom = data.getColumnCount() * MAX_COLUMN_WIDTH / std::max(ImGui::GetContentRegionAvail().x, 1.0f);
+
+        return showTimelineView(data.getDuration(), max_zoom, state, position, [&](ImDrawList* draw_list, ImVec2 viewport_min, ImVec2 viewport_max, float visible_start, float visible_end) {
+
+            // Texture rows go up in frequency, so the texture is flipped vertically. The last column may cover less than a hop.
+            draw_list->AddImage(spectrogram.getTexture(), viewport_min, viewport_max, {visible_start, 1.0f}, {visible_end, 0.0f});
+
+            // Labels at decades of the log frequency axis.
+            const float min_frequency = data.getMinFrequency();
+            const float max_frequency = data.getMaxFrequency();
+            const float height = viewport_max.y - viewport_min.y;
+            const ImU32 label_color = ImGui::GetColorU32(ImGuiCol_Text);
+            for (float frequency : {100.0f, 1000.0f, 10000.0f}) {
+                if (frequency <= min_frequency || frequency >= max_frequency) {
+                    continue;
+                }
+                float y = viewport_max.y - height * std::log(frequency / min_frequency) / std::log(max_frequency / min_frequency);
+                char label[16];
+                std::snprintf(label, sizeof(label), frequency >= 1000.0f ? "%.0f kHz" : "%.0f Hz", frequency >= 1000.0f ? frequency / 1000.0f : frequency);
+                draw_list->AddLine({viewport_min.x, y}, {viewport_min.x + 6.0f, y}, label_color);
+                draw_list->AddText({viewport_min.x + 8.0f, y - ImGui::GetTextLineHeight() * 0.5f}, label_color, label);
+            }
+        });
+    }
+
+    void Placeholder(const std::string& text) {
+        ImVec2 text_size = ImGui::CalcTextSize(text.c_str());
+        ImVec2 viewport_size = ImGui::GetContentRegionAvail();
+
+        // Calculate padding to center the text.
+        ImVec2 padding = {(viewport_size.x - text_size.x) * 0.5f, (viewport_size.y - text_size.y) * 0.5f};
 
-        // Apply padding.
         ImGui::SetCursorPosX(ImGui::GetCursorPosX() + padding.x);
         ImGui::SetCursorPosY(ImGui::GetCursorPosY() + padding.y);
 
-        // Display the image.
-        ImGui::Image(image.getTexture(), display_size);
+        ImGui::TextDisabled("%s", text.c_str());
     }
 }}
@@ -4,7 +4,12 @@
 #include <imgui.h>
 
 #include "util.h"
+#include "animatedImage.h"
+#include "displayAdjustments.h"
 #include "image.h"
+#include "spectrogram.h"
+#include "tiledImage.h"
+#include "waveform.h"
 
 namespace ui {
 namespace widget {
@@ -26,13 +31,60 @@ namespace widget {
         std::optional<float> horizontal_widget_sapcing = std::nullopt
     );
 
+    struct ImageViewState {
+        float   zoom{ 1.0f };               // 1 shows the whole image fitted to the viewport.
+        ImVec2  center{ 0.5f, 0.5f };       // Normalized image coordinates shown at the viewport center.
+    };
+
     /**
      * @brief Displays an image within the available ImGui content region, maintaining its aspect ratio.
      * This function scales down the image if necessary to fit within the available viewport while maintaining
      * the original aspect ratio. It also centers the image both vertically and horizontally within the viewport.
+     * The mouse wheel zooms in around the cursor, dragging pans and double clicking resets the view.
      *
      * @param image The Image object containing the texture to display, along with its width and height.
+     * @param state Zoom and pan of the view, updated by user interaction.
+     * @param renderer Draws the image with the adjustments (unless they are the defaults).
+     * @param adjustments Brightness, contrast, gamma, etc. applied on the GPU when drawing.
+     */
+    void ImageView(const Image& image, ImageViewState& state, DisplayAdjustmentRenderer& renderer, const DisplayAdjustments& adjustments);
+
+    /**
+     * @brief Same as ImageView(), for images too large for a single texture. Only the tiles visible at
+     * the current zoom and pan are uploaded.
+     */
+    void TiledImageView(TiledImage& image, ImageViewState& state, DisplayAdjustmentRenderer& renderer, const DisplayAdjustments& adjustments);
+
+    // Same as ImageView(), showing the current frame of an animation.
+    void AnimatedImageView(const AnimatedImage& image, ImageViewState& state, DisplayAdjustmentRenderer& renderer, const DisplayAdjustments& adjustments);
+
+    struct TimelineViewState {
+        float   zoom{ 1.0f };               // 1 shows the whole recording across the viewport.
+        float   center{ 0.5f };             // Normalized time shown at the viewport center.
+    };
+
+    /**
+     * @brief Draws the waveform of an audio file over the available ImGui content region, with a line at the
+     * playback position. The mouse wheel zooms in around the cursor, dragging pans and double clicking
+     * resets the view. Only as many peaks as there are pixel columns are read, at any zoom.
+     *
+     * @param position Playback position in seconds.
+     * @return The position (in seconds) clicked to seek to, if any.
+     */
+    std::optional<float> WaveformView(const WaveformPyramid& waveform, TimelineViewState& state, float position);
+
+    /**
+     * @brief Same as WaveformView(), showing a spectrogram (low frequencies at the bottom) as far as it has
+     * been computed, with a few frequency labels.
+     */
+    std::optional<float> SpectrogramView(const Spectrogram& spectrogram, TimelineViewState& state, float position);
+
+    /**
+     * @brief Displays text centered both vertically and horizontally within the available ImGui
+     * content region. Used in place of content that is not available yet (e.g. an image being decoded).
+     *
+     * @param text The text to display.
      */
-    void ImageView(const Image& image);
+    void Placeholder(const std::string& text);
 
 }}  // namespace widget, ui
@@ -1,2 +1,85 @@
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <utility>
+
+// Decoded pixels are allocated through the application's pixel arena (src/pixelArena.h), so that
+// their buffers are recycled instead of going back to the heap after every image.
+void* pixelArenaAllocate(size_t size);
+void* pixelArenaReallocate(void* pointer, size_t size);
+void pixelArenaFree(void* pointer);
+
+#define STBI_MALLOC(size)               pixelArenaAllocate(size)
+#define STBI_REALLOC(pointer, size)     pixelArenaReallocate(pointer, size)
+#define STBI_FREE(pointer)              pixelArenaFree(pointer)
+
 #define STB_IMAGE_IMPLEMENTATION
 #include "stb_image.h"
+
+// Incremental GIF decoding for src/gifDecoder.h. stb_image only exposes decoding every frame of an
+// animation at once, so this drives its internal GIF loader one frame at a time instead.
+struct GifStream {
+    stbi__context       context;
+    stbi__gif           gif;
+
+    // Copies of the previous two frames, the older one being what "restore to previous" disposal reverts to.
+    stbi_uc*            previous;
+    stbi_uc*            two_back;
+    int                 frame_count;
+};
+
+GifStream* gifStreamOpen(const unsigned char* data, int size, int* width, int* height) {
+    GifStream* stream = static_cast<GifStream*>(std::calloc(1, sizeof(GifStream)));
+    if (! stream) {
+        return nullptr;
+    }
+
+    stbi__start_mem(&stream->context, data, size);
+    int comp;
+    if (! stbi__gif_test(&stream->context) || ! stbi__gif_info_raw(&stream->context, width, height, &comp)) {
+        std::free(stream);
+        return nullptr;
+    }
+    stbi__rewind(&stream->context);
+    return stream;
+}
+
+int gifStreamNextFrame(GifStream* stream, const unsigned char** pixels, int* delay_milliseconds) {
+    int comp;
+    stbi_uc* frame = stbi__gif_load_next(&stream->context, &stream->gif, &comp, 4, stream->frame_count >= 2 ? stream->two_back : nullptr);
+    if (frame == reinterpret_cast<stbi_uc*>(&stream->context)) {
+        return 0;
+    }
+    if (! frame) {
+        return -1;
+    }
+
+    const size_t frame_size = static_cast<size_t>(stream->gif.w) * stream->gif.h * 4;
+    if (! stream->previous) {
+        stream->previous = static_cast<stbi_uc*>(std::malloc(frame_size));
+        stream->two_back = static_cast<stbi_uc*>(std::malloc(frame_size));
+        if (! stream->previous || ! stream->two_back) {
+            return -1;
+        }
+    } else {
+        std::swap(stream->previous, stream->two_back);
+    }
+    std::memcpy(stream->previous, frame, frame_size);
+    stream->frame_count++;
+
+    *pixels = frame;
+    *delay_milliseconds = stream->gif.delay;
+    return 1;
+}
+
+void gifStreamClose(GifStream* stream) {
+    if (! stream) {
+        return;
+    }
+    STBI_FREE(stream->gif.out);
+    STBI_FREE(stream->gif.history);
+    STBI_FREE(stream->gif.background);
+    std::free(stream->previous);
+    std::free(stream->two_back);
+    std::free(stream);
+}